@@ -34,6 +34,7 @@ extern "C"
 #include "luatables.h"
 
 #include "Model.h"
+#include "Profiler.h"
 #include "Animation.h"
 
 using namespace std;
@@ -505,8 +506,12 @@ void UpdateModelFromAnimation (MeshupModelPtr model, AnimationPtr animation, flo
 		animation->configuration = model->configuration;
 	}
 
-	KeyFrame keyframe = animation->getKeyFrameAtTime (time);
-	ModelApplyKeyFrame (model, keyframe);
+	{
+		ProfileScope profile_scope (ProfilePhaseAnimation);
+
+		KeyFrame keyframe = animation->getKeyFrameAtTime (time);
+		ModelApplyKeyFrame (model, keyframe);
+	}
 
 	model->updateFrames();
 	model->updateSegments();
@@ -1,58 +1,106 @@
 #include "Arrow.h"
 #include "GL/glew.h"
+#include "ShaderRenderer.h"
 
-ArrowCreator::ArrowCreator() {
-	arrow3d = CreateUnit3DArrow();
+ArrowCreator::ArrowCreator() :
+	arrow3d (CreateUnit3DArrow()),
+	circle_arrow3d (CreateUnit3DCircleArrow())
+{
 	arrow3d.colors.clear();
-
-	circle_arrow3d = CreateUnit3DCircleArrow();
 	circle_arrow3d.colors.clear();
 }
 
-void ArrowCreator::drawArrow(MeshVBO *basearrow, Arrow arrow, ArrowProperties properties) {
-	// Calculate need transformation values
-	double dir_norm = arrow.direction.norm();
-	double total_scale = dir_norm*properties.scale;
-	Vector3f vec_dir_normalized = arrow.direction.normalized();
-	Vector4f color(properties.color[0], properties.color[1], properties.color[2], properties.transparency);
-
-	Vector3f unit_axis_vec = Vector3f(0., 1., 0.);
-	Vector3f v = unit_axis_vec.cross(vec_dir_normalized);
-
-	double rot_angle_radian = SimpleMath::Fixed::calcAngleRadian(unit_axis_vec, vec_dir_normalized);
-	double rot_angle_degree = rot_angle_radian * 180 / M_PI;
-
-	if (v.norm() < 0.00001){
-		if (fabs(rot_angle_degree - 180.) < 0.1){
-			v = Vector3f(1., 0., 0.);
-			rot_angle_degree = 180.;
+Matrix44f calc_arrow_transform (const Vector3f &position, const Vector3f &direction, float scale) {
+	float length = direction.norm();
+	Matrix44f result (Matrix44f::Identity());
+
+	if (length == 0.f) {
+		result.setZero();
+		result(3,3) = 1.f;
+	} else {
+		Vector3f d = direction / length;
+
+		// Rotation of the y-axis onto d (row vector convention): with
+		// v = y x d and c = y . d it is I - [v]x + [v]x^2 / (1 + c).
+		Vector3f v (d[2], 0.f, -d[0]);
+		float c = d[1];
+
+		if (c < -0.99999f) {
+			// rotation by 180 degrees about the x-axis
+			result(1,1) = -1.f;
+			result(2,2) = -1.f;
+		} else {
+			float k = 1.f / (1.f + c);
+
+			result(0,0) = 1.f - (v[1] * v[1] + v[2] * v[2]) * k;
+			result(0,1) = v[2] + v[0] * v[1] * k;
+			result(0,2) = -v[1] + v[0] * v[2] * k;
+
+			result(1,0) = -v[2] + v[0] * v[1] * k;
+			result(1,1) = 1.f - (v[0] * v[0] + v[2] * v[2]) * k;
+			result(1,2) = v[0] + v[1] * v[2] * k;
+
+			result(2,0) = v[1] + v[0] * v[2] * k;
+			result(2,1) = -v[0] + v[1] * v[2] * k;
+			result(2,2) = 1.f - (v[0] * v[0] + v[1] * v[1]) * k;
 		}
-		else{
-			v = unit_axis_vec;
-			rot_angle_degree = 0.;
+
+		float total_scale = length * scale;
+		for (unsigned int i = 0; i < 3; i++) {
+			for (unsigned int j = 0; j < 3; j++) {
+				result(i,j) *= total_scale;
+			}
 		}
-	}	
-	v = v.normalize();
+	}
+
+	result(3,0) = position[0];
+	result(3,1) = position[1];
+	result(3,2) = position[2];
+
+	return result;
+}
 
-	// Add Transformation Matricies
+void ArrowCreator::drawArrow(MeshVBO *basearrow, Arrow arrow, ArrowProperties properties) {
 	glPushMatrix();
-		// Translate
-		glTranslatef(arrow.pos[0], arrow.pos[1], arrow.pos[2]);
-		// Rotate
-		glMultMatrixf(SimpleMath::GL::RotateMat44(rot_angle_degree, v[0], v[1], v[2]).data());
-		// Scale
-		glMultMatrixf(SimpleMath::GL::ScaleMat44(total_scale, total_scale, total_scale).data());
-		// Set Drawing Color 
-		glColor4f(color[0], color[1], color[2], color[3]);
-		// Draw Arrow
+		glMultMatrixf(calc_arrow_transform (arrow.pos, arrow.direction, properties.scale).data());
+		glColor4f(properties.color[0], properties.color[1], properties.color[2], properties.transparency);
 		basearrow->draw(GL_TRIANGLES);
 	glPopMatrix();
 }
 
+void ArrowCreator::clearArrows() {
+	transforms.clear();
+	colors.clear();
+}
+
+void ArrowCreator::addArrows(const ArrowList &arrows, const Matrix33f &base_change, const Vector3f &offset, float threshold, const ArrowProperties &properties) {
+	Matrix33f base_change_transposed = base_change.transpose();
+	Vector4f color (properties.color[0], properties.color[1], properties.color[2], properties.transparency);
+	float threshold_squared = threshold * threshold;
+
+	for (size_t i = 0; i < arrows.arrows.size(); i++) {
+		const Arrow &arrow = arrows.arrows[i];
+
+		// the base change is a rotation and does not alter the length
+		if (arrow.direction.squaredNorm() <= threshold_squared)
+			continue;
+
+		Vector3f position = base_change_transposed * arrow.pos + offset;
+		Vector3f direction = base_change_transposed * arrow.direction;
+
+		transforms.push_back (calc_arrow_transform (position, direction, properties.scale));
+		colors.push_back (color);
+	}
+}
+
+void ArrowCreator::drawArrows(MeshVBO *basearrow, ShaderRenderer *renderer) {
+	draw_mesh_instances (basearrow, transforms, colors, renderer);
+}
+
 void ArrowList::addArrow(const Vector3f pos, const Vector3f direction) {
-	Arrow *a = new Arrow();
-	a->pos = pos;
-	a->direction = direction;
+	Arrow a;
+	a.pos = pos;
+	a.direction = direction;
 	arrows.push_back(a);
 }
 
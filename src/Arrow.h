@@ -15,9 +15,9 @@ struct Arrow {
 
 struct ArrowList{
 	ArrowList() :
-		arrows (std::vector<Arrow*>())
+		arrows (std::vector<Arrow>())
 	{}
-	std::vector<Arrow*> arrows;
+	std::vector<Arrow> arrows;
 	void addArrow(const Vector3f pos,const Vector3f direction);
 };
 
@@ -33,12 +33,37 @@ struct ArrowProperties {
 	float transparency;
 };
 
+struct ShaderRenderer;
+
+/** \brief Returns the transformation of the unit arrow (pointing along the
+ * y-axis) to an arrow at position with the given direction.
+ *
+ * The arrow is scaled by the length of direction times scale. The rotation
+ * is computed directly from the normalized direction without evaluating
+ * any trigonometric functions.
+ */
+Matrix44f calc_arrow_transform (const Vector3f &position, const Vector3f &direction, float scale);
+
 struct ArrowCreator {
 	ArrowCreator();
 
 	MeshVBO arrow3d, circle_arrow3d;
 
+	/// Transformations of the arrows queued with addArrows()
+	std::vector<Matrix44f> transforms;
+	/// Colors of the arrows queued with addArrows()
+	std::vector<Vector4f> colors;
+
 	void drawArrow(MeshVBO *basearrow, Arrow arrow, ArrowProperties properties);
+
+	void clearArrows();
+	/// Queues all arrows whose direction is longer than threshold. The
+	/// base change is applied to the arrows which are then translated by
+	/// offset.
+	void addArrows(const ArrowList &arrows, const Matrix33f &base_change, const Vector3f &offset, float threshold, const ArrowProperties &properties);
+	/// Draws all queued arrows using basearrow. If renderer is not NULL
+	/// all arrows are drawn with a single instanced draw call.
+	void drawArrows(MeshVBO *basearrow, ShaderRenderer *renderer);
 };
 
 #endif // Arrow_h_INCLUDED
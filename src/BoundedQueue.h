@@ -0,0 +1,99 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_BOUNDEDQUEUE_H
+#define MESHUP_BOUNDEDQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/** \brief Thread safe first in first out queue with a maximum size.
+ *
+ * push() blocks while the queue is full and pop() blocks while it is empty
+ * such that a producer can only run capacity items ahead of its consumer.
+ * After close() no items can be pushed and pop() returns false once the
+ * remaining items were taken.
+ */
+template <typename T>
+struct BoundedQueue {
+	BoundedQueue (size_t capacity) :
+		capacity (capacity),
+		closed (false)
+	{}
+
+	/// Appends value, blocks while the queue is full. Returns false if the
+	/// queue was closed.
+	bool push (const T &value) {
+		std::unique_lock<std::mutex> lock (mutex);
+		not_full.wait (lock, [this] { return closed || items.size() < capacity; });
+
+		if (closed)
+			return false;
+
+		items.push_back (value);
+		not_empty.notify_one();
+
+		return true;
+	}
+
+	/// Removes the oldest item, blocks while the queue is empty. Returns
+	/// false if the queue is closed and empty.
+	bool pop (T &value) {
+		std::unique_lock<std::mutex> lock (mutex);
+		not_empty.wait (lock, [this] { return closed || !items.empty(); });
+
+		if (items.empty())
+			return false;
+
+		value = items.front();
+		items.pop_front();
+		not_full.notify_one();
+
+		return true;
+	}
+
+	/// Removes the oldest item if there is one, never blocks
+	bool tryPop (T &value) {
+		std::lock_guard<std::mutex> lock (mutex);
+
+		if (items.empty())
+			return false;
+
+		value = items.front();
+		items.pop_front();
+		not_full.notify_one();
+
+		return true;
+	}
+
+	/// Wakes up all waiting threads, remaining items can still be popped
+	void close () {
+		std::lock_guard<std::mutex> lock (mutex);
+		closed = true;
+		not_full.notify_all();
+		not_empty.notify_all();
+	}
+
+	size_t size () {
+		std::lock_guard<std::mutex> lock (mutex);
+		return items.size();
+	}
+
+	size_t capacity;
+
+	/// Protects items and closed
+	std::mutex mutex;
+	std::condition_variable not_full;
+	std::condition_variable not_empty;
+	std::deque<T> items;
+	bool closed;
+};
+
+#endif
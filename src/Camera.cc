@@ -26,7 +26,11 @@ Camera::Camera() :
 	fov (45.0f),
 	near (0.1f),
 	far (30.),
-	orthographic(false)
+	orthographic(false),
+	tile_left (0.f),
+	tile_bottom (0.f),
+	tile_width (1.f),
+	tile_height (1.f)
 	{
 	updateSphericalCoordinates();
 }
@@ -55,9 +59,12 @@ void Camera::update() {
 
 	up = right.cross (eye_normalized);
 
-	// setup of the projection
+	// setup of the projection, a tile uses its part of the view frustum
 	glMatrixMode (GL_PROJECTION);
-	glLoadIdentity ();
+	if (isTiled())
+		glLoadMatrixf (getTileMatrix().data());
+	else
+		glLoadIdentity ();
 
 	fov = 45;
 	GLfloat aspect = (GLfloat) width / (GLfloat) height;
@@ -149,6 +156,13 @@ void Camera::setSize (int width_, int height_) {
 	height = height_;
 }
 
+void Camera::setTile (float left, float bottom, float width_, float height_) {
+	tile_left = left;
+	tile_bottom = bottom;
+	tile_width = width_;
+	tile_height = height_;
+}
+
 void Camera::move (float screen_x, float screen_y) {
 		// move
 		Vector3f eye_normalized (poi - eye);
@@ -223,4 +237,14 @@ Matrix44f Camera::getViewMatrix() const {
 	return result;
 }
 
+Matrix44f Camera::getTileMatrix() const {
+	// the sub-frustum of a tile is the projection of the whole image
+	// scaled and shifted in normalized device coordinates
+	Matrix44f result (Matrix44f::Identity());
+	result(0,0) = 1.f / tile_width;
+	result(1,1) = 1.f / tile_height;
+	result(3,0) = (1.f - 2.f * tile_left - tile_width) / tile_width;
+	result(3,1) = (1.f - 2.f * tile_bottom - tile_height) / tile_height;
 
+	return result;
+}
@@ -35,6 +35,14 @@ struct Camera {
 
 	bool orthographic;
 
+	/// Part of the image that is drawn, as fractions of width and height
+	/// from the lower left corner. Large images are drawn in tiles that
+	/// each use the part of the view frustum of the tile.
+	float tile_left;
+	float tile_bottom;
+	float tile_width;
+	float tile_height;
+
 	Camera();
 	void update();
 	void updateSphericalCoordinates();
@@ -43,6 +51,10 @@ struct Camera {
 	void setSideView();
 	void setTopView();
 	void setSize (int width_, int height_);
+	void setTile (float left, float bottom, float width_, float height_);
+	bool isTiled() const {
+		return tile_width != 1.f || tile_height != 1.f;
+	}
 
 	void move (float screen_x, float screen_y);
 	void zoom (float screen_y);
@@ -50,6 +62,9 @@ struct Camera {
 
 	Matrix44f getProjectionMatrix() const;
 	Matrix44f getViewMatrix() const;
+	/// Maps the normalized device coordinates of the tile to those of the
+	/// whole image (in the layout of glGetFloatv())
+	Matrix44f getTileMatrix() const;
 };
 
 /* _CAMERA_H */
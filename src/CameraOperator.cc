@@ -40,7 +40,8 @@ bool CameraOperator::loadFromFile (const char* filename, bool strict) {
 		delete cam_pos[i];
 	}
 	cam_pos.clear();
-	camera_display->clear();
+	if (camera_display != NULL)
+		camera_display->clear();
 
 	string filename_str (filename);
 
@@ -154,13 +155,17 @@ QListWidgetItem* CameraOperator::addCamera(float time, Camera* cam, bool moving)
 		camdata->moving = false;
 	}
 
-	CameraListItem* display = new CameraListItem(camdata, camera_display);
-	camera_display->insertItem(position, display);
-
 	if (cam_pos.size() > 1) {
 		fixed = false;
 	}
 
+	// cameras of the headless renderer are not listed
+	if (camera_display == NULL)
+		return NULL;
+
+	CameraListItem* display = new CameraListItem(camdata, camera_display);
+	camera_display->insertItem(position, display);
+
 	return display;
 }
 
@@ -237,7 +242,8 @@ void CameraOperator::deleteCameraPos(CameraPosition* pos) {
 			}
 			it++;
 		}
-		camera_display->takeItem(item_pos);
+		if (camera_display != NULL)
+			camera_display->takeItem(item_pos);
 		cam_pos.erase(it);
 		if (item_pos > 0) {
 			item_pos--;
@@ -309,7 +315,7 @@ int CameraOperator::setCameraPosTime(CameraPosition* pos, float time) {
 		}
 	}
 
-	for(int i=0; i<cam_pos.size(); i++) {
+	for(int i=0; camera_display != NULL && i<cam_pos.size(); i++) {
 		CameraListItem* item = (CameraListItem*)camera_display->item(i);
 		item->camera_data = cam_pos[i];
 		item->data_changed();
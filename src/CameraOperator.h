@@ -31,7 +31,8 @@ class CameraListItem : public QListWidgetItem {
 		void data_changed();
 };
 
-// This class is used to Manage multiple camera postions within an animation
+// This class is used to Manage multiple camera postions within an animation.
+// camera_display may be NULL if the positions are not shown in a list.
 
 struct CameraOperator{
     CameraOperator(QListWidget* camera_display) :
@@ -2,57 +2,151 @@
  * MeshUp - A visualization tool for multi-body systems based on skeletal
  * animation and magic.
  *
- * Copyright (c) 2011-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
  *
  * Licensed under the MIT license. See LICENSE for more details.
  */
 
 #include "Curve.h"
 
-#include "GL/glew.h"
-
 #include <iostream>
 #include <cstdlib>
+#include <algorithm>
+#include <limits>
 
 using namespace std;
 
-void Curve::generate_vbo() {
-	if (points.size() != colors.size()) {
-		cerr << "Error creating Curve VBO: points and colors do not have equal size!" << endl;
-		abort();
+static float distance_to_segment (const Vector3f &point, const Vector3f &start, const Vector3f &end) {
+	Vector3f direction = end - start;
+	float squared_length = direction.squaredNorm();
+
+	float t = 0.f;
+	if (squared_length > 0.f)
+		t = max (0.f, min (1.f, (point - start).dot (direction) / squared_length));
+
+	return (point - (start + direction * t)).norm();
+}
+
+void compute_point_importance (const std::vector<Vector3f> &points, std::vector<float> &importance) {
+	importance.assign (points.size(), 0.f);
+
+	if (points.size() == 0)
+		return;
+
+	importance.front() = numeric_limits<float>::max();
+	importance.back() = numeric_limits<float>::max();
+
+	struct Span {
+		unsigned int first;
+		unsigned int last;
+		float importance;
+	};
+
+	// explicit stack as long curves would be too deep for recursion
+	vector<Span> stack;
+	Span span = { 0, static_cast<unsigned int>(points.size() - 1), numeric_limits<float>::max() };
+	stack.push_back (span);
+
+	while (stack.size() != 0) {
+		span = stack.back();
+		stack.pop_back();
+
+		if (span.last - span.first < 2)
+			continue;
+
+		unsigned int split = span.first + 1;
+		float split_distance = -1.f;
+		for (unsigned int i = span.first + 1; i < span.last; i++) {
+			float distance = distance_to_segment (points[i], points[span.first], points[span.last]);
+			if (distance > split_distance) {
+				split = i;
+				split_distance = distance;
+			}
+		}
+
+		// a point is never more important than the point that split its
+		// span, so that thresholding gives a valid simplification
+		float split_importance = min (split_distance, span.importance);
+		importance[split] = split_importance;
+
+		Span left = { span.first, split, split_importance };
+		Span right = { split, span.last, split_importance };
+		stack.push_back (left);
+		stack.push_back (right);
 	}
+}
 
-	if (points.size() < 2) {
-		cerr << "Error creating Curve VBO: not enough points!" << endl;
+void Curve::generate_levels (float min_error, float error_factor, float reduction) {
+	if (points.size() != colors.size()) {
+		cerr << "Error creating Curve levels: points and colors do not have equal size!" << endl;
 		abort();
 	}
 
-	meshVBO.begin();	
+	levels.clear();
+	indices.clear();
+	buffer_id = 0;
+
+	if (points.size() == 0) {
+		bbox_min.setZero();
+		bbox_max.setZero();
+		return;
+	}
 
-	for (unsigned int i = 0; i < points.size() - 1; i++) {
-		meshVBO.addVertex3fv (points[i].data());
-		meshVBO.addColor3fv (colors[i].data());
+	bbox_min = points[0];
+	bbox_max = points[0];
+	for (unsigned int i = 1; i < points.size(); i++) {
+		for (unsigned int j = 0; j < 3; j++) {
+			bbox_min[j] = min (bbox_min[j], points[i][j]);
+			bbox_max[j] = max (bbox_max[j], points[i][j]);
+		}
 	}
 
-	meshVBO.end();
+	Level level;
+	level.error = 0.f;
+	level.first_index = 0;
+	level.index_count = points.size();
+	for (unsigned int i = 0; i < points.size(); i++)
+		indices.push_back (i);
+	levels.push_back (level);
 
-	meshVBO.generate_vbo();
-}
+	vector<float> importance;
+	compute_point_importance (points, importance);
 
-void Curve::draw() {
-	// Lazy compile the VBO if not yet done
-	if (meshVBO.vbo_id == 0) {
-		generate_vbo();
-	}
+	float error = min_error * (bbox_max - bbox_min).norm();
+
+	while (levels.back().index_count > 2) {
+		unsigned int count = 0;
+		for (unsigned int i = 0; i < importance.size(); i++) {
+			if (importance[i] > error)
+				count++;
+		}
 
-	glLineWidth (width);
-	glEnable (GL_LINE_SMOOTH);
-	//glEnable (GL_BLEND);
-	glDepthMask (GL_FALSE);
-	glHint (GL_LINE_SMOOTH_HINT, GL_NICEST);
+		if (count <= levels.back().index_count * reduction) {
+			level.error = error;
+			level.first_index = indices.size();
+			level.index_count = count;
 
-	meshVBO.draw(GL_LINE_STRIP);
+			for (unsigned int i = 0; i < importance.size(); i++) {
+				if (importance[i] > error)
+					indices.push_back (i);
+			}
+
+			levels.push_back (level);
+		}
+
+		// the coarsest level has an error of about the size of the curve
+		if (error > (bbox_max - bbox_min).norm())
+			break;
+
+		error *= error_factor;
+	}
+}
+
+const Curve::Level& Curve::selectLevel (float max_error) const {
+	for (size_t i = levels.size(); i > 1; i--) {
+		if (levels[i - 1].error <= max_error)
+			return levels[i - 1];
+	}
 
-	glDisable (GL_BLEND);
-	glDepthMask (GL_TRUE);
+	return levels[0];
 }
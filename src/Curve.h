@@ -10,17 +10,21 @@
 #ifndef _CURVE_H
 #define _CURVE_H
 
-#include "MeshVBO.h"
+#include <vector>
 
-/** \brief Allows drawing of three dimensional curves.
+#include "Math.h"
+
+/** \brief Three dimensional curve with decimated levels of detail.
  *
- * After adding points with Curve::addPointWithColor(...) one has to first
- * compile the Vertex Buffer Object (VBO) with Curve::generate_vbo(), which
- * is then sent to the graphics card. After that one can draw the curve by
- * calling Curve::draw().
+ * Curves are drawn by CurveRenderer, which packs all curves into a shared
+ * buffer. After adding points with Curve::addPointWithColor(...) one has
+ * to call Curve::generate_levels() (otherwise the renderer does it once
+ * the curve is drawn). It computes the bounding box and simplified
+ * versions of the curve (Douglas-Peucker) of which the renderer picks the
+ * coarsest one whose error is not visible.
  *
- * One must not forget to free the VBO once the curve is no more used by
- * calling Curve::delete_vbo().
+ * When the points are modified later, Curve::invalidate() has to be
+ * called.
  *
  * The width of the line can be specified by setting the value
  * Curve::width.
@@ -35,14 +39,21 @@
  *
  *		curve.addPointWithColor(sinf(t), t * 0.25, cosf(t), 1.f - t, t * 1.f, 1.f);
  *	}
- *	curve.generate_vbo();
+ *	curve.generate_levels();
  *	curve.width = 3.;
- *	curve.draw();
- *	curve.delete_vbo();
+ *
+ *	renderer.beginFrame();
+ *	renderer.addCurve (&curve, Matrix44f::Identity());
+ *	renderer.endFrame();
  * \endcode
  */
 struct Curve {
-	Curve() : width (3.f)
+	Curve() :
+		width (3.f),
+		bbox_min (0.f, 0.f, 0.f),
+		bbox_max (0.f, 0.f, 0.f),
+		buffer_id (0),
+		buffer_first_index (0)
 		{ }
 	void addPointWithColor(float x, float y, float z, float r, float g, float b) {
 		points.push_back (Vector3f (x, y, z));
@@ -54,17 +65,56 @@ struct Curve {
 
 	float width;
 
-	/// Uses data from points and colors to compile the VBO
-	void generate_vbo();
+	/// A simplified version of the curve
+	struct Level {
+		/// Maximum distance to the full curve
+		float error;
+		unsigned int first_index;
+		unsigned int index_count;
+	};
 
-	/// Frees the VBO
-	void delete_vbo() {
-		meshVBO.delete_vbo();
-	}
+	/// Bounding box of the points (computed by generate_levels())
+	Vector3f bbox_min;
+	Vector3f bbox_max;
+
+	/// Levels ordered from the full curve to the coarsest one
+	std::vector<Level> levels;
+	/// Point indices of all levels
+	std::vector<unsigned int> indices;
+
+	/// Id of the CurveRenderer buffer that contains the curve (0 if it
+	/// has to be uploaded)
+	unsigned int buffer_id;
+	/// Location of the indices in the renderer buffer
+	unsigned int buffer_first_index;
 
-	void draw();
+	/** \brief Computes the bounding box and the simplified levels.
+	 *
+	 * A level is only kept if it has at most reduction times the
+	 * points of the previous level. The errors of the levels grow by
+	 * error_factor starting at min_error times the bounding box diagonal.
+	 */
+	void generate_levels (float min_error = 1.f / 4096.f, float error_factor = 4.f, float reduction = 0.75f);
 
-	MeshVBO meshVBO;	
+	/// Returns the coarsest level whose error is at most max_error
+	const Level& selectLevel (float max_error) const;
+
+	/// Has to be called when the points were modified
+	void invalidate() {
+		levels.clear();
+		indices.clear();
+		buffer_id = 0;
+	}
 };
 
+/** \brief Computes for every point the largest distance at which it is
+ * still kept when the curve is simplified with the Douglas-Peucker
+ * algorithm.
+ *
+ * Keeping all points whose importance is larger than a tolerance gives the
+ * same points as running the algorithm with that tolerance. The end
+ * points are always kept.
+ */
+void compute_point_importance (const std::vector<Vector3f> &points, std::vector<float> &importance);
+
 #endif
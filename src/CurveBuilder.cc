@@ -0,0 +1,235 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "CurveBuilder.h"
+#include "Model.h"
+
+#include "colorscale.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+CurveBuilder::CurveBuilder() :
+	sample_rate (100.f),
+	coarse_sample_count (64),
+	cancel_requested (false),
+	running (false),
+	result_ready (false)
+{}
+
+CurveBuilder::~CurveBuilder() {
+	cancel();
+}
+
+static void add_frame_info (std::vector<CurveBuilder::FrameInfo> &frames, const Frame *frame, int parent, bool frames_initialized) {
+	CurveBuilder::FrameInfo info;
+	info.name = frame->name;
+	info.parent = parent;
+	// the fixed frame transformations are only valid once the model was
+	// updated (see Frame::initDefaultFrameTransform())
+	info.frame_transform = frames_initialized ? frame->frame_transform : frame->parent_transform;
+	info.pose_translation = frame->pose_translation;
+	info.pose_rotation_quaternion = frame->pose_rotation_quaternion;
+	info.pose_scaling = frame->pose_scaling;
+
+	int index = frames.size();
+	frames.push_back (info);
+
+	for (unsigned int ci = 0; ci < frame->children.size(); ci++) {
+		add_frame_info (frames, frame->children[ci], index, frames_initialized);
+	}
+}
+
+void CurveBuilder::start (const MeshupModel &model, const Animation &animation) {
+	cancel();
+
+	frames.clear();
+	for (unsigned int bi = 0; bi < model.frames.size(); bi++) {
+		add_frame_info (frames, model.frames[bi], -1, model.frames_initialized);
+	}
+
+	this->animation = animation;
+
+	// same as in UpdateModelFromAnimation()
+	if (this->animation.state_descriptor.states.size() == 0) {
+		this->animation.state_descriptor = model.state_descriptor;
+		this->animation.configuration = model.configuration;
+	}
+
+	if (this->animation.raw_values.size() == 0)
+		return;
+
+	running = true;
+	worker = std::thread (&CurveBuilder::run, this);
+}
+
+void CurveBuilder::cancel () {
+	cancel_requested = true;
+
+	if (worker.joinable())
+		worker.join();
+
+	cancel_requested = false;
+	running = false;
+
+	lock_guard<mutex> lock (result_mutex);
+	result_ready = false;
+	result = Result();
+}
+
+bool CurveBuilder::update (MeshupModel &model) {
+	Result pass_result;
+
+	{
+		lock_guard<mutex> lock (result_mutex);
+		if (!result_ready)
+			return false;
+
+		std::swap (pass_result, result);
+		result_ready = false;
+	}
+
+	if (!running && worker.joinable())
+		worker.join();
+
+	for (unsigned int i = 0; i < frames.size(); i++) {
+		CurvePtr curve;
+		MeshupModel::CurveMap::iterator curve_iter = model.curvemap.find (frames[i].name);
+		if (curve_iter == model.curvemap.end()) {
+			curve = CurvePtr (new Curve);
+			model.curvemap[frames[i].name] = curve;
+		} else {
+			curve = curve_iter->second;
+		}
+
+		// the curve is uploaded again when it is drawn the next time
+		pass_result.curves[i].width = curve->width;
+		std::swap (*curve, pass_result.curves[i]);
+	}
+
+	return true;
+}
+
+bool CurveBuilder::finished () {
+	lock_guard<mutex> lock (result_mutex);
+	return !running && !result_ready;
+}
+
+void CurveBuilder::wait () {
+	if (worker.joinable())
+		worker.join();
+}
+
+void CurveBuilder::run () {
+	float duration = animation.duration;
+	unsigned int final_sample_count = static_cast<unsigned int>(ceil (duration * sample_rate)) + 1;
+	final_sample_count = max (final_sample_count, 2u);
+
+	unsigned int sample_count = max (2u, min (coarse_sample_count, final_sample_count));
+
+	while (true) {
+		Result pass_result;
+		if (!computePass (sample_count, pass_result))
+			break;
+
+		{
+			lock_guard<mutex> lock (result_mutex);
+			std::swap (result, pass_result);
+			result_ready = true;
+
+			if (sample_count == final_sample_count)
+				running = false;
+		}
+
+		if (sample_count == final_sample_count)
+			break;
+
+		// the samples of the previous pass are kept and one sample is added
+		// in the middle of every interval
+		sample_count = min (2 * (sample_count - 1) + 1, final_sample_count);
+	}
+
+	running = false;
+}
+
+bool CurveBuilder::computePass (unsigned int sample_count, Result &pass_result) {
+	float duration = animation.duration;
+
+	pass_result.sample_count = sample_count;
+	pass_result.curves.resize (frames.size());
+	for (unsigned int i = 0; i < frames.size(); i++) {
+		pass_result.curves[i].points.resize (sample_count);
+		pass_result.curves[i].colors.resize (sample_count);
+	}
+
+	std::vector<Matrix44f> pose_transforms (frames.size());
+
+	for (unsigned int si = 0; si < sample_count; si++) {
+		if (cancel_requested)
+			return false;
+
+		float time = duration * static_cast<float>(si) / static_cast<float>(sample_count - 1);
+		if (si == sample_count - 1)
+			time = duration;
+
+		KeyFrame keyframe = animation.getKeyFrameAtTime (time);
+
+		for (unsigned int i = 0; i < frames.size(); i++) {
+			const FrameInfo &frame = frames[i];
+
+			Vector3f translation = frame.pose_translation;
+			SimpleMath::GL::Quaternion rotation = frame.pose_rotation_quaternion;
+			Vector3f scaling = frame.pose_scaling;
+
+			std::map<std::string, TransformInfo>::const_iterator transform_iter = keyframe.transformations.find (frame.name);
+			if (transform_iter != keyframe.transformations.end()) {
+				translation = transform_iter->second.translation;
+				rotation = transform_iter->second.rotation_quaternion;
+				scaling = transform_iter->second.scaling;
+			}
+
+			// same as Frame::updatePoseTransform()
+			Matrix44f pose_transform = frame.frame_transform;
+			if (frame.parent >= 0)
+				pose_transform = frame.frame_transform * pose_transforms[frame.parent];
+
+			pose_transform =
+				SimpleMath::GL::ScaleMat44 (scaling[0], scaling[1], scaling[2])
+				* rotation.toGLMatrix()
+				* SimpleMath::GL::TranslateMat44 (translation[0], translation[1], translation[2])
+				* pose_transform;
+
+			pose_transforms[i] = pose_transform;
+			pass_result.curves[i].points[si] = Vector3f (pose_transform(3,0), pose_transform(3,1), pose_transform(3,2));
+		}
+
+		float fraction = duration > 0.f ? time / duration * 2.f - 1.f : -1.f;
+		Vector3f color (
+				colorscale::red (fraction),
+				colorscale::green (fraction),
+				colorscale::blue (fraction)
+				);
+
+		for (unsigned int i = 0; i < frames.size(); i++) {
+			pass_result.curves[i].colors[si] = color;
+		}
+	}
+
+	for (unsigned int i = 0; i < frames.size(); i++) {
+		if (cancel_requested)
+			return false;
+
+		pass_result.curves[i].generate_levels();
+	}
+
+	return true;
+}
@@ -0,0 +1,110 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_CURVEBUILDER_H
+#define MESHUP_CURVEBUILDER_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include "Math.h"
+#include "Animation.h"
+#include "Curve.h"
+
+struct MeshupModel;
+
+/** \brief Computes the trajectory curves of all frames of a model in a
+ * background thread.
+ *
+ * start() copies the frame hierarchy of the model and the animation such
+ * that the thread does not access either of them. The curves are first
+ * sampled with coarse_sample_count samples, then the number of intervals
+ * is doubled in every pass until sample_rate is reached. The simplified
+ * levels of the curves (Curve::generate_levels()) are also computed by the
+ * thread.
+ *
+ * The result of the latest finished pass is moved into the curves of the
+ * model by update().
+ *
+ * Usage:
+ *
+ * \code
+ *	builder.start (*model, *animation);
+ *	// periodically, e.g. from a timer:
+ *	if (builder.update (*model))
+ *		redraw();
+ *	if (builder.finished())
+ *		stop_polling();
+ * \endcode
+ */
+struct CurveBuilder {
+	CurveBuilder();
+	~CurveBuilder();
+
+	/// Samples per second of the final pass
+	float sample_rate;
+	/// Number of samples of the first pass
+	unsigned int coarse_sample_count;
+
+	/// Cancels the current computation and starts computing the curves of
+	/// model for the animation.
+	void start (const MeshupModel &model, const Animation &animation);
+	/// Stops the computation and discards results that were not yet
+	/// retrieved.
+	void cancel ();
+	/// Replaces the curves of model with the latest finished pass. Returns
+	/// true if the curves changed.
+	bool update (MeshupModel &model);
+	/// Whether the computation is done and all results were retrieved
+	bool finished ();
+	/// Blocks until all passes are computed. The next update() applies the
+	/// final curves.
+	void wait ();
+
+	/// Copy of a frame of the model. Frames are sorted such that parents
+	/// come before their children.
+	struct FrameInfo {
+		std::string name;
+		/// Index of the parent or -1 for the base frames
+		int parent;
+		Matrix44f frame_transform;
+		/// Pose used if the frame is not part of the animation
+		Vector3f pose_translation;
+		SimpleMath::GL::Quaternion pose_rotation_quaternion;
+		Vector3f pose_scaling;
+	};
+
+	struct Result {
+		unsigned int sample_count;
+		/// Curve of every frame (including the simplified levels)
+		std::vector<Curve> curves;
+	};
+
+	std::vector<FrameInfo> frames;
+	Animation animation;
+
+	std::thread worker;
+	std::atomic<bool> cancel_requested;
+	std::atomic<bool> running;
+
+	/// Protects result and result_ready
+	std::mutex result_mutex;
+	Result result;
+	bool result_ready;
+
+	void run ();
+	/// Samples the animation sample_count times. Returns false if the
+	/// computation was cancelled.
+	bool computePass (unsigned int sample_count, Result &pass_result);
+};
+
+#endif
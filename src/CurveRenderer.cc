@@ -0,0 +1,293 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "GL/glew.h"
+
+#include "CurveRenderer.h"
+#include "Curve.h"
+#include "Model.h"
+#include "Frustum.h"
+
+#include <iostream>
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+static unsigned int next_buffer_id = 1;
+
+CurveRenderer::CurveRenderer() :
+	pixel_error (1.f),
+	draw_call_count (0),
+	vertex_count (0),
+	culled_count (0),
+	buffer_id (next_buffer_id++),
+	vbo_id (0),
+	ibo_id (0),
+	buffer_vertex_count (0),
+	buffer_vertex_capacity (0),
+	buffer_index_count (0),
+	buffer_index_capacity (0),
+	modelview (Matrix44f::Identity()),
+	projection (Matrix44f::Identity()),
+	viewport_height (1.f)
+{}
+
+CurveRenderer::~CurveRenderer() {
+	// the GL context may already be gone, destroy() has to be called
+	// explicitly
+}
+
+void CurveRenderer::destroy() {
+	if (vbo_id != 0)
+		glDeleteBuffers (1, &vbo_id);
+	if (ibo_id != 0)
+		glDeleteBuffers (1, &ibo_id);
+
+	vbo_id = 0;
+	ibo_id = 0;
+	buffer_id = next_buffer_id++;
+	buffer_vertex_count = 0;
+	buffer_vertex_capacity = 0;
+	buffer_index_count = 0;
+	buffer_index_capacity = 0;
+}
+
+void CurveRenderer::beginFrame() {
+	glGetFloatv (GL_MODELVIEW_MATRIX, modelview.data());
+	glGetFloatv (GL_PROJECTION_MATRIX, projection.data());
+
+	GLint viewport[4];
+	glGetIntegerv (GL_VIEWPORT, viewport);
+	viewport_height = static_cast<float>(viewport[3]);
+
+	transforms.clear();
+	draw_items.clear();
+	culled_count = 0;
+}
+
+void CurveRenderer::addModel (MeshupModel &model, const Matrix44f &transform) {
+	MeshupModel::CurveMap::iterator curve_iter = model.curvemap.begin();
+	while (curve_iter != model.curvemap.end()) {
+		addCurve (curve_iter->second, transform);
+		curve_iter++;
+	}
+}
+
+void CurveRenderer::addCurve (Curve *curve, const Matrix44f &transform) {
+	if (curve->points.size() < 2)
+		return;
+
+	if (curve->levels.size() == 0)
+		curve->generate_levels();
+
+	Matrix44f transformation = transform * modelview;
+
+	Frustum frustum (transformation * projection);
+	if (!frustum.intersectsBox (curve->bbox_min, curve->bbox_max)) {
+		culled_count++;
+		return;
+	}
+
+	if (transforms.size() == 0 || transforms.back() != transform)
+		transforms.push_back (transform);
+
+	float scale = projectedScale (curve->bbox_min, curve->bbox_max, transformation);
+	const Curve::Level &level = curve->selectLevel (pixel_error / scale);
+
+	DrawItem item;
+	item.transform = transforms.size() - 1;
+	item.width = curve->width;
+	item.curve = curve;
+	item.first_index = level.first_index;
+	item.index_count = level.index_count;
+	draw_items.push_back (item);
+}
+
+void CurveRenderer::endFrame() {
+	draw_call_count = 0;
+	vertex_count = 0;
+
+	if (draw_items.size() == 0)
+		return;
+
+	std::stable_sort (draw_items.begin(), draw_items.end());
+
+	// make sure all curves of this frame are stored in the buffers
+	unsigned int live_vertices = 0, live_indices = 0;
+	unsigned int missing_vertices = 0, missing_indices = 0;
+	for (size_t i = 0; i < draw_items.size(); i++) {
+		const Curve *curve = draw_items[i].curve;
+
+		live_vertices += curve->points.size();
+		live_indices += curve->indices.size();
+
+		if (curve->buffer_id != buffer_id) {
+			missing_vertices += curve->points.size();
+			missing_indices += curve->indices.size();
+		}
+	}
+
+	if (buffer_vertex_count + missing_vertices > buffer_vertex_capacity
+			|| buffer_index_count + missing_indices > buffer_index_capacity) {
+		// start over with only the curves of this frame as the CPU-side
+		// data of all of them is available
+		buffer_id = next_buffer_id++;
+		buffer_vertex_count = 0;
+		buffer_index_count = 0;
+		reserveBuffers (live_vertices, live_indices);
+	}
+
+	for (size_t i = 0; i < draw_items.size(); i++) {
+		if (draw_items[i].curve->buffer_id != buffer_id)
+			upload (draw_items[i].curve);
+	}
+
+	// the curves are drawn like the previous Curve::draw(): smooth lines
+	// that do not write the depth buffer
+	float line_width;
+	glGetFloatv (GL_LINE_WIDTH, &line_width);
+
+	glEnable (GL_LINE_SMOOTH);
+	glDepthMask (GL_FALSE);
+	glHint (GL_LINE_SMOOTH_HINT, GL_NICEST);
+
+	glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
+	glVertexPointer (3, GL_FLOAT, sizeof (Vertex), NULL);
+	glColorPointer (4, GL_UNSIGNED_BYTE, sizeof (Vertex), (const GLvoid *) offsetof (Vertex, color));
+
+	glEnableClientState (GL_VERTEX_ARRAY);
+	glEnableClientState (GL_COLOR_ARRAY);
+	glDisableClientState (GL_NORMAL_ARRAY);
+
+	glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, ibo_id);
+
+	size_t first = 0;
+	while (first < draw_items.size()) {
+		size_t last = first;
+
+		counts.clear();
+		offsets.clear();
+		while (last < draw_items.size()
+				&& draw_items[last].transform == draw_items[first].transform
+				&& draw_items[last].width == draw_items[first].width) {
+			const DrawItem &item = draw_items[last];
+			counts.push_back (item.index_count);
+			offsets.push_back ((const void *) ((item.curve->buffer_first_index + item.first_index) * sizeof (unsigned int)));
+			vertex_count += item.index_count;
+			last++;
+		}
+
+		glPushMatrix();
+		glMultMatrixf (transforms[draw_items[first].transform].data());
+
+		glLineWidth (draw_items[first].width);
+		glMultiDrawElements (GL_LINE_STRIP, &counts[0], GL_UNSIGNED_INT, &offsets[0], counts.size());
+		draw_call_count++;
+
+		glPopMatrix();
+
+		first = last;
+	}
+
+	glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer (GL_ARRAY_BUFFER, 0);
+	glDisableClientState (GL_COLOR_ARRAY);
+
+	glLineWidth (line_width);
+	glDisable (GL_BLEND);
+	glDepthMask (GL_TRUE);
+}
+
+float CurveRenderer::projectedScale (const Vector3f &bbox_min, const Vector3f &bbox_max, const Matrix44f &transformation) const {
+	// the rows of the transformation are the transformed axes
+	float scale = 0.f;
+	for (unsigned int i = 0; i < 3; i++) {
+		Vector3f axis (transformation(i,0), transformation(i,1), transformation(i,2));
+		scale = max (scale, axis.norm());
+	}
+
+	// curves are long compared to their distance to the camera, hence the
+	// closest corner is used instead of the center (as for meshes)
+	float min_w = numeric_limits<float>::max();
+	for (unsigned int i = 0; i < 8; i++) {
+		Vector4f corner (
+				(i & 1) ? bbox_max[0] : bbox_min[0],
+				(i & 2) ? bbox_max[1] : bbox_min[1],
+				(i & 4) ? bbox_max[2] : bbox_min[2],
+				1.f);
+		Vector4f clip_position = (corner.transpose() * transformation * projection).transpose();
+		min_w = min (min_w, clip_position[3]);
+	}
+
+	// the camera is inside or close to the bounding box
+	if (min_w <= 1.0e-6f)
+		return numeric_limits<float>::max();
+
+	return scale * projection(1,1) * 0.5f * viewport_height / min_w;
+}
+
+void CurveRenderer::reserveBuffers (unsigned int vertex_count, unsigned int index_count) {
+	const unsigned int min_vertex_capacity = 1 << 16;
+	const unsigned int min_index_capacity = 1 << 17;
+
+	if (vbo_id == 0)
+		glGenBuffers (1, &vbo_id);
+	if (ibo_id == 0)
+		glGenBuffers (1, &ibo_id);
+
+	// leave room for curves that are added or refined later
+	if (vertex_count > buffer_vertex_capacity) {
+		buffer_vertex_capacity = max (2 * vertex_count, min_vertex_capacity);
+
+		glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
+		glBufferData (GL_ARRAY_BUFFER, buffer_vertex_capacity * sizeof (Vertex), NULL, GL_STATIC_DRAW);
+		glBindBuffer (GL_ARRAY_BUFFER, 0);
+	}
+
+	if (index_count > buffer_index_capacity) {
+		buffer_index_capacity = max (2 * index_count, min_index_capacity);
+
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, ibo_id);
+		glBufferData (GL_ELEMENT_ARRAY_BUFFER, buffer_index_capacity * sizeof (unsigned int), NULL, GL_STATIC_DRAW);
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+}
+
+void CurveRenderer::upload (Curve *curve) {
+	vertex_data.resize (curve->points.size());
+	for (size_t i = 0; i < curve->points.size(); i++) {
+		Vertex &vertex = vertex_data[i];
+		for (unsigned int j = 0; j < 3; j++) {
+			vertex.position[j] = curve->points[i][j];
+			vertex.color[j] = static_cast<unsigned char>(max (0.f, min (1.f, curve->colors[i][j])) * 255.f + 0.5f);
+		}
+		vertex.color[3] = 255;
+	}
+
+	// the indices are stored relative to the start of the buffer
+	index_data.resize (curve->indices.size());
+	for (size_t i = 0; i < curve->indices.size(); i++) {
+		index_data[i] = curve->indices[i] + buffer_vertex_count;
+	}
+
+	glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
+	glBufferSubData (GL_ARRAY_BUFFER, buffer_vertex_count * sizeof (Vertex), vertex_data.size() * sizeof (Vertex), &vertex_data[0]);
+	glBindBuffer (GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, ibo_id);
+	glBufferSubData (GL_ELEMENT_ARRAY_BUFFER, buffer_index_count * sizeof (unsigned int), index_data.size() * sizeof (unsigned int), &index_data[0]);
+	glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	curve->buffer_id = buffer_id;
+	curve->buffer_first_index = buffer_index_count;
+
+	buffer_vertex_count += vertex_data.size();
+	buffer_index_count += index_data.size();
+}
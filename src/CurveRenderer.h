@@ -0,0 +1,118 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_CURVERENDERER_H
+#define MESHUP_CURVERENDERER_H
+
+#include <vector>
+#include <cstddef>
+
+#include "Math.h"
+
+struct Curve;
+struct MeshupModel;
+
+/** \brief Draws curves from a shared vertex and index buffer.
+ *
+ * Every curve is uploaded once (with all its levels, see
+ * Curve::generate_levels()) and stays in the buffer until it is
+ * invalidated. For each curve the coarsest level is chosen whose error
+ * projected onto the screen is below pixel_error. All curves with the
+ * same transformation and width are drawn with a single
+ * glMultiDrawElements() call.
+ *
+ * Curves whose bounding box is outside of the view volume are skipped.
+ *
+ * Usage:
+ *
+ * \code
+ *	renderer.beginFrame();
+ *	renderer.addModel (model, model_transform);
+ *	renderer.endFrame();
+ * \endcode
+ */
+struct CurveRenderer {
+	CurveRenderer();
+	~CurveRenderer();
+
+	/// Maximum distance in pixels between the drawn and the full curves
+	float pixel_error;
+
+	/// Number of draw calls issued by the last call of endFrame()
+	unsigned int draw_call_count;
+	/// Number of vertices drawn by the last call of endFrame()
+	unsigned int vertex_count;
+	/// Number of curves skipped since beginFrame() because they are
+	/// outside of the view volume
+	unsigned int culled_count;
+
+	/// Reads the matrices and the viewport from OpenGL
+	void beginFrame();
+	/// Queues all curves of the model. The transform is applied before
+	/// the current modelview matrix.
+	void addModel (MeshupModel &model, const Matrix44f &transform);
+	void addCurve (Curve *curve, const Matrix44f &transform);
+	/// Uploads the curves that are not yet in the buffer and draws all
+	/// queued curves
+	void endFrame();
+	/// Frees the buffers (requires a current GL context)
+	void destroy();
+
+	struct DrawItem {
+		/// Index into transforms
+		unsigned int transform;
+		float width;
+		Curve *curve;
+		unsigned int first_index;
+		unsigned int index_count;
+
+		bool operator< (const DrawItem &other) const {
+			if (transform != other.transform)
+				return transform < other.transform;
+			return width < other.width;
+		}
+	};
+
+	/// Position and color of a vertex in the buffer
+	struct Vertex {
+		float position[3];
+		unsigned char color[4];
+	};
+
+	/// Changes whenever the content of the buffers is discarded (see
+	/// Curve::buffer_id)
+	unsigned int buffer_id;
+
+	unsigned int vbo_id;
+	unsigned int ibo_id;
+	unsigned int buffer_vertex_count;
+	unsigned int buffer_vertex_capacity;
+	unsigned int buffer_index_count;
+	unsigned int buffer_index_capacity;
+
+	Matrix44f modelview;
+	Matrix44f projection;
+	float viewport_height;
+
+	std::vector<Matrix44f> transforms;
+	std::vector<DrawItem> draw_items;
+
+	std::vector<Vertex> vertex_data;
+	std::vector<unsigned int> index_data;
+	std::vector<int> counts;
+	std::vector<const void*> offsets;
+
+	/// Size of a world space distance of 1 in pixels at the point of the
+	/// bounding box (in eye coordinates) closest to the camera
+	float projectedScale (const Vector3f &bbox_min, const Vector3f &bbox_max, const Matrix44f &transformation) const;
+	void reserveBuffers (unsigned int vertex_count, unsigned int index_count);
+	void upload (Curve *curve);
+};
+
+#endif
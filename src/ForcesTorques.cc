@@ -1,18 +1,11 @@
 #include "ForcesTorques.h"
 #include "GL/glew.h"
 #include "string_utils.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <boost/filesystem.hpp>
 
-extern "C"
-{
-   #include <lua.h>
-   #include <lauxlib.h>
-   #include <lualib.h>
-}
-#include "luatables.h"
-
 using namespace std;
 
 bool ForcesTorques::loadFromFile (const char* filename, bool strict) {
@@ -27,15 +20,7 @@ bool ForcesTorques::loadFromFile (const char* filename, bool strict) {
 		return false;
 	}
 
-	if (times.size() > 0) {
-		for(int i=0;i<times.size();i++) {
-			delete forces[i];
-			delete torques[i];
-		}
-		times.clear();
-		forces.clear();
-		torques.clear();
-	}
+	clear();
 
 	double force_fps_previous_frame = 0.;
 	int force_fps_frame_count = 0;
@@ -50,20 +35,16 @@ bool ForcesTorques::loadFromFile (const char* filename, bool strict) {
 
 	int line_number = 0;
 
-	// Load Drawing Parameters from Modelfile
-	LuaTable model_table = LuaTable::fromFile(model_ref->model_filename.c_str());
-	Vector3f force_color = model_table["animation_settings"]["force_color"].getDefault(Vector3f(1., 0., 0.));
-	Vector3f torque_color = model_table["animation_settings"]["torque_color"].getDefault(Vector3f(0., 1., 0.));
-	float force_scale = model_table["animation_settings"]["force_scale"].getDefault(0.002);
-	float torque_scale = model_table["animation_settings"]["torque_scale"].getDefault(0.01);
-	float force_transparency = model_table["animation_settings"]["force_transparency"].getDefault(0.5); 
-	float torque_transparency = model_table["animation_settings"]["torque_transparency"].getDefault(0.5); 
+	// Drawing parameters as read by the model
+	AnimationSettings settings;
+	if (model_ref)
+		settings = model_ref->animation_settings;
 
-	force_threshold = model_table["animation_settings"]["force_threshold"].getDefault(1.0);
-	torque_threshold = model_table["animation_settings"]["torque_threshold"].getDefault(0.1);
+	force_threshold = settings.force_threshold;
+	torque_threshold = settings.torque_threshold;
 
-	force_properties = ArrowProperties(force_color, force_scale, force_transparency);
-	torque_properties = ArrowProperties(torque_color, torque_scale, torque_transparency);
+	force_properties = ArrowProperties(settings.force_color, settings.force_scale, settings.force_transparency);
+	torque_properties = ArrowProperties(settings.torque_color, settings.torque_scale, settings.torque_transparency);
 
 	while (!file_in.eof()) {
 		previous_line = line;
@@ -125,62 +106,67 @@ bool ForcesTorques::loadFromFile (const char* filename, bool strict) {
 	return true;
 }
 
-ArrowList ForcesTorques::getForcesAtTime(float time) {
-	unsigned int index = getIndexAtTime(time);
-	// if at beginning or end use first or last entry
-	if (index == 0) {
-		return *forces[index];
-	} else if ( time > duration) {
-		return *forces[forces.size()-1];
-	// if inbetween interpolate values for smooth animation
-	} else {
-		float time_fraction = getTimeFraction(time, index);
-		ArrowList* prev = forces[index-1];
-		ArrowList* next = forces[index];
-		ArrowList result;
-
-		// iterate over all entries and interpolate them
-		for(int i=0;i<prev->arrows.size();i++) {
-			Vector3f pos = interpolate(prev->arrows[i]->pos, next->arrows[i]->pos, time_fraction);
-			Vector3f direction = interpolate(prev->arrows[i]->direction, next->arrows[i]->direction, time_fraction);
-			result.addArrow(pos, direction);
-		}
+void ForcesTorques::clear() {
+	duration = 0.f;
+	contact_count = 0;
+	times.clear();
+	positions.clear();
+	forces.clear();
+	torques.clear();
+}
 
-		return result;
-	}
+void ForcesTorques::getForcesAtTime(float time, ArrowList &result) {
+	getArrowsAtTime(time, forces, result);
 }
 
-ArrowList ForcesTorques::getTorquesAtTime(float time) {
+void ForcesTorques::getTorquesAtTime(float time, ArrowList &result) {
+	getArrowsAtTime(time, torques, result);
+}
+
+void ForcesTorques::getArrowsAtTime(float time, const std::vector<float> &directions, ArrowList &result) {
+	if (times.size() == 0) {
+		result.arrows.clear();
+		return;
+	}
+
+	// resize() keeps the capacity, therefore this only allocates if the
+	// number of contacts grows
+	result.arrows.resize(contact_count);
+
 	unsigned int index = getIndexAtTime(time);
+
 	// if at beginning or end use first or last entry
-	if (index == 0) {
-		return *torques[index];
-	} else if ( time > duration) {
-		return *torques[torques.size()-1];
-	// if inbetween interpolate values for smooth animation
-	} else {
-		float time_fraction = getTimeFraction(time, index);
-		ArrowList* prev = torques[index-1];
-		ArrowList* next = torques[index];
-		ArrowList result;
-
-		// iterate over all entries and interpolate them
-		for(int i=0;i<prev->arrows.size();i++) {
-			Vector3f pos = interpolate(prev->arrows[i]->pos, next->arrows[i]->pos, time_fraction);
-			Vector3f direction = interpolate(prev->arrows[i]->direction, next->arrows[i]->direction, time_fraction);
-			result.addArrow(pos, direction);
+	if (index == 0 || time > duration) {
+		const float *pos = &positions[index * contact_count * 3];
+		const float *dir = &directions[index * contact_count * 3];
+		for (unsigned int i = 0; i < contact_count; i++) {
+			result.arrows[i].pos.set(pos[i * 3], pos[i * 3 + 1], pos[i * 3 + 2]);
+			result.arrows[i].direction.set(dir[i * 3], dir[i * 3 + 1], dir[i * 3 + 2]);
 		}
+		return;
+	}
 
-		return result;
+	// if inbetween interpolate values for smooth animation
+	float fraction = getTimeFraction(time, index);
+	const float *pos_prev = &positions[(index - 1) * contact_count * 3];
+	const float *pos_next = pos_prev + contact_count * 3;
+	const float *dir_prev = &directions[(index - 1) * contact_count * 3];
+	const float *dir_next = dir_prev + contact_count * 3;
+
+	for (unsigned int i = 0; i < contact_count * 3; i += 3) {
+		Arrow &arrow = result.arrows[i / 3];
+		for (unsigned int j = 0; j < 3; j++) {
+			arrow.pos[j] = pos_prev[i + j] * (1.f - fraction) + pos_next[i + j] * fraction;
+			arrow.direction[j] = dir_prev[i + j] * (1.f - fraction) + dir_next[i + j] * fraction;
+		}
 	}
 }
 
 unsigned int ForcesTorques::getIndexAtTime(float time) {
-	// Find index for values corresponding to current time
-	unsigned int index = 0;
-	while ((time > times[index]) && index < times.size() - 1) {
-		index++;
-	}
+	// Find the first frame that is not before time (or the last frame)
+	unsigned int index = std::lower_bound(times.begin(), times.end(), time) - times.begin();
+	if (index >= times.size())
+		index = times.size() - 1;
 	return index;
 }
 
@@ -191,30 +177,26 @@ float ForcesTorques::getTimeFraction(float time, unsigned int index) {
 	return (time - time_prev_frame) / (time_next_frame - time_prev_frame);
 }
 
-Vector3f ForcesTorques::interpolate(const Vector3f &prev, const Vector3f &next, float fraction) {
-	// Interpolate two Vector3f
-	return (prev * (1-fraction)) + (next * fraction); 
-}
-
 void ForcesTorques::addForcesTorques(VectorNd data) {
 	// first entry is time-stamp
 	float time = data[0];
 
 	// read force and torque data of the current time-stamp
-	ArrowList *f = new ArrowList();
-	ArrowList *t = new ArrowList();
-	int count = (data.size() - 1)/9;
-	for (int i=0; i<count ; i++) {
-		Vector3f pos(data[i*9+1], data[i*9+2], data[i*9+3]);
-		Vector3f force_data(data[i*9+4], data[i*9+5], data[i*9+6]);
-		Vector3f torque_data(data[i*9+7], data[i*9+8], data[i*9+9]);
-
-		f->addArrow(pos, force_data);
-		t->addArrow(pos, torque_data);
+	unsigned int count = (data.size() - 1)/9;
+	if (times.size() == 0) {
+		contact_count = count;
+	} else if (count != contact_count) {
+		cerr << "Error: expected data for " << contact_count << " contacts but got " << count << " at time " << time << "." << endl;
+		abort();
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		for (unsigned int j = 0; j < 3; j++) {
+			positions.push_back(data[i*9+1+j]);
+			forces.push_back(data[i*9+4+j]);
+			torques.push_back(data[i*9+7+j]);
+		}
 	}
 
 	times.push_back(time);
-	forces.push_back(f);
-	torques.push_back(t);
 }
-
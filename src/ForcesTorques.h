@@ -7,30 +7,35 @@
 #include "Model.h"
 #include "Arrow.h"
 
+/** \brief Forces and torques at contact points over time.
+ *
+ * The data of all frames is stored in contiguous float arrays with the
+ * layout [frame][contact][xyz] so that evaluating a time only touches two
+ * consecutive blocks and does not allocate any memory.
+ */
 struct ForcesTorques {
 	ForcesTorques(MeshupModel* model) :
 		forces_filename(""),
+		duration (0.f),
+		contact_count (0),
 		times (std::vector<float>()),
-		forces (std::vector<ArrowList*>()),
-		torques (std::vector<ArrowList*>())
+		positions (std::vector<float>()),
+		forces (std::vector<float>()),
+		torques (std::vector<float>())
 	{
 		model_ref = model;
 	}
-	~ForcesTorques() {
-		for(int i=0;i<times.size();i++) {
-			delete forces[i];
-			delete torques[i];
-		}
-	}
 	// Metadata
 	std::string forces_filename;
 	MeshupModel* model_ref;
 	float duration;
 
 	// Data Storage
+	unsigned int contact_count;
 	std::vector<float> times;
-	std::vector<ArrowList*> forces;
-	std::vector<ArrowList*> torques;
+	std::vector<float> positions;
+	std::vector<float> forces;
+	std::vector<float> torques;
 
 	// Drawing Parameters 
 	double force_threshold;
@@ -40,12 +45,17 @@ struct ForcesTorques {
 
 
 	bool loadFromFile (const char* filename, bool strict = true);
+	void clear();
 	void addForcesTorques(VectorNd data);
 	unsigned int getIndexAtTime(float time);
 	float getTimeFraction(float time, unsigned int index);
-	Vector3f interpolate(const Vector3f &prev, const Vector3f &next, float fraction);
-	ArrowList getForcesAtTime(float time);
-	ArrowList getTorquesAtTime(float time);
+	/// Writes the (interpolated) forces at time into result. The memory of
+	/// result is reused.
+	void getForcesAtTime(float time, ArrowList &result);
+	/// Writes the (interpolated) torques at time into result. The memory of
+	/// result is reused.
+	void getTorquesAtTime(float time, ArrowList &result);
+	void getArrowsAtTime(float time, const std::vector<float> &directions, ArrowList &result);
 };
 
 #endif  // FORCESTORQUES_H
@@ -0,0 +1,95 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "Frustum.h"
+
+#include <cmath>
+
+using namespace std;
+
+Frustum::Frustum() {
+	// accepts everything
+	for (unsigned int i = 0; i < 6; i++)
+		planes[i].setZero();
+}
+
+Frustum::Frustum (const Matrix44f &modelview_projection) {
+	extract (modelview_projection);
+}
+
+void Frustum::extract (const Matrix44f &modelview_projection) {
+	const Matrix44f &M = modelview_projection;
+
+	// a point p is inside if -w <= x, y, z <= w for (x, y, z, w) = p * M,
+	// i.e. the planes are the sums and differences of the columns of M
+	for (unsigned int i = 0; i < 3; i++) {
+		for (unsigned int j = 0; j < 4; j++) {
+			planes[2 * i][j] = M(j,3) + M(j,i);
+			planes[2 * i + 1][j] = M(j,3) - M(j,i);
+		}
+	}
+
+	for (unsigned int i = 0; i < 6; i++) {
+		float length = sqrtf (planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+		if (length > 0.f)
+			planes[i] = planes[i] / length;
+	}
+}
+
+bool Frustum::intersectsBox (const Vector3f &box_min, const Vector3f &box_max) const {
+	for (unsigned int i = 0; i < 6; i++) {
+		const Vector4f &plane = planes[i];
+
+		// the corner that lies furthest in direction of the plane normal
+		float distance = plane[3]
+			+ plane[0] * (plane[0] >= 0.f ? box_max[0] : box_min[0])
+			+ plane[1] * (plane[1] >= 0.f ? box_max[1] : box_min[1])
+			+ plane[2] * (plane[2] >= 0.f ? box_max[2] : box_min[2]);
+
+		if (distance < 0.f)
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::intersectsSphere (const Vector3f &center, float radius) const {
+	for (unsigned int i = 0; i < 6; i++) {
+		const Vector4f &plane = planes[i];
+		float distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+
+		if (distance < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+void transform_bounding_box (
+		const Vector3f &box_min,
+		const Vector3f &box_max,
+		const Matrix44f &transform,
+		Vector3f &result_min,
+		Vector3f &result_max) {
+	Vector3f center = (box_min + box_max) * 0.5f;
+	Vector3f extent = (box_max - box_min) * 0.5f;
+
+	for (unsigned int j = 0; j < 3; j++) {
+		float transformed_center = transform(3,j);
+		float transformed_extent = 0.f;
+
+		for (unsigned int i = 0; i < 3; i++) {
+			transformed_center += center[i] * transform(i,j);
+			transformed_extent += extent[i] * fabs (transform(i,j));
+		}
+
+		result_min[j] = transformed_center - transformed_extent;
+		result_max[j] = transformed_center + transformed_extent;
+	}
+}
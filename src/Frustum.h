@@ -0,0 +1,56 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_FRUSTUM_H
+#define MESHUP_FRUSTUM_H
+
+#include "Math.h"
+
+/** \brief Clipping planes of a view volume used to skip objects that are
+ * not visible.
+ *
+ * The planes are extracted from the combined modelview and projection
+ * matrix (as returned by glGetFloatv(), i.e. in the row vector convention
+ * of SimpleMath) and are given in the coordinates before the modelview
+ * transformation:
+ *
+ * \code
+ *	Frustum frustum (modelview * projection);
+ *	if (frustum.intersectsBox (bbox_min, bbox_max))
+ *		draw();
+ * \endcode
+ *
+ * The tests are conservative: boxes near the corners of the frustum may
+ * be reported as visible although they are outside.
+ */
+struct Frustum {
+	Frustum();
+	explicit Frustum (const Matrix44f &modelview_projection);
+
+	/// Plane equations (a, b, c, d) with normalized normals pointing inside
+	Vector4f planes[6];
+
+	void extract (const Matrix44f &modelview_projection);
+
+	/// Returns false if the axis aligned box is completely outside
+	bool intersectsBox (const Vector3f &box_min, const Vector3f &box_max) const;
+	/// Returns false if the sphere is completely outside
+	bool intersectsSphere (const Vector3f &center, float radius) const;
+};
+
+/** \brief Computes the axis aligned box that contains the box transformed
+ * by transform (row vector convention). */
+void transform_bounding_box (
+		const Vector3f &box_min,
+		const Vector3f &box_max,
+		const Matrix44f &transform,
+		Vector3f &result_min,
+		Vector3f &result_max);
+
+#endif
@@ -0,0 +1,918 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "GL/glew.h"
+
+#include "HeadlessRender.h"
+#include "OffscreenContext.h"
+#include "SceneRenderer.h"
+#include "Scene.h"
+#include "Model.h"
+#include "Animation.h"
+#include "ForcesTorques.h"
+#include "CameraOperator.h"
+#include "CurveBuilder.h"
+#include "MeshVBO.h"
+#include "ShadowMap.h"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <deque>
+#include <map>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "json/json.h"
+#include "VideoExporter.h"
+#include "ImageSeriesWriter.h"
+#include "TiledImageRenderer.h"
+
+using namespace std;
+
+/// Settings of meshup --render
+struct HeadlessRenderSettings {
+	HeadlessRenderSettings() :
+		output_filename (""),
+		width (1280),
+		height (720),
+		fps (25.f),
+		start_time (0.f),
+		end_time (-1.f),
+		transparent (false),
+		gpu_conversion (false),
+		fast_png (false),
+		overlay_filename (""),
+		jobs (1),
+		chunk_count (0),
+		chunk_index (-1),
+		retries (2),
+		software (false),
+		tile_size (2048)
+	{}
+
+	std::string output_filename;
+	int width;
+	int height;
+	float fps;
+	float start_time;
+	/// Negative for the end of the longest animation
+	float end_time;
+	bool transparent;
+	QVideoEncoderSettings video;
+	/// Converts the video frames to YUV in a shader
+	bool gpu_conversion;
+	/// Fastest deflate level for .png output
+	bool fast_png;
+	/// Sum of all images, empty if not written
+	std::string overlay_filename;
+	/// Number of worker processes that render at the same time
+	int jobs;
+	/// Number of parts of the time range, 0 for one per job
+	int chunk_count;
+	/// Part rendered by this worker process, -1 for the whole range
+	int chunk_index;
+	/// How often a failed part is started again
+	int retries;
+	/// Renders with Mesa on the CPU
+	bool software;
+	/// Larger images are rendered in tiles of this size
+	int tile_size;
+
+	/// Whether the images are rendered with a TiledImageRenderer
+	bool renderTiles() const {
+		ImageFileFormat format;
+		return parse_image_file_extension (output_filename, format)
+			&& TiledImageRenderer (tile_size).needsTiles (width, height);
+	}
+	/// Model, animation, force and camera files in the given order
+	std::vector<std::string> files;
+};
+
+static void print_headless_usage() {
+	cout << "Usage: meshup --render OUTPUT [options] [model_file(s)] [animation_file(s)] [force_file(s)] [camera_file]" << endl
+		<< "Renders the animations without a window or display server." << endl
+		<< endl
+		<< "OUTPUT is either a .png, .tga or .ppm file, to which the frame number" << endl
+		<< "is appended (image.png becomes image-0000.png, image-0001.png, ...)" << endl
+		<< "unless it contains a printf pattern such as frame_%05d.png, or a video" << endl
+		<< "file (e.g. .mp4, .mkv, .avi). Videos require a width and height that" << endl
+		<< "are multiples of 8. The uncompressed .tga and .ppm files are the" << endl
+		<< "fastest to write." << endl
+		<< endl
+		<< "--size WxH		 resolution of the images (default 1280x720)." << endl
+		<< "--fps N			 frames per second of animation time (default 25)." << endl
+		<< "--start T		 time of the first frame in seconds (default 0)." << endl
+		<< "--end T			 time of the last frame in seconds (default: end of" << endl
+		<< "				 the longest animation)." << endl
+		<< "--transparent		 transparent background (only for .png and .tga)." << endl
+		<< "--white			 white instead of black background." << endl
+		<< "--draw LIST		 comma separated list of the drawn elements out of" << endl
+		<< "				 grid, floor, meshes, shadows, curves, points," << endl
+		<< "				 forces, torques, base_axes, frame_axes (default" << endl
+		<< "				 floor,meshes,points,forces,torques)." << endl
+		<< "--codec NAME		 h264 (default, libx264 if available) or mpeg4." << endl
+		<< "--crf N			 constant rate factor of H.264 from 0 (lossless) to" << endl
+		<< "				 51 (default 23), -1 to use the bitrate instead." << endl
+		<< "--bitrate N		 bitrate in kbit/s if no CRF is used (default 5000)." << endl
+		<< "--gop N			 maximal number of frames between keyframes" << endl
+		<< "				 (default 250)." << endl
+		<< "--b-frames N		 number of B-frames (default 2)." << endl
+		<< "--encoder-threads N	 encoder threads, 0 for one per core (default)." << endl
+		<< "--thread-type TYPE	 frame, slice or frame+slice (default)." << endl
+		<< "--scaler NAME		 filter of the color conversion: fast_bilinear" << endl
+		<< "				 (default), bilinear, bicubic or point." << endl
+		<< "--gpu-yuv		 convert the frames to YUV in a shader (requires" << endl
+		<< "				 OpenGL 3.0)." << endl
+		<< "--fast-png		 fastest PNG compression (larger files)." << endl
+		<< "--overlay FILE		 also write the sum of all images to FILE (.png," << endl
+		<< "				 .tga or .ppm) like composite -compose plus." << endl
+		<< "--jobs N		 number of worker processes that render parts of" << endl
+		<< "				 the time range at the same time, each with its" << endl
+		<< "				 own OpenGL context (default 1)." << endl
+		<< "--chunks N		 number of parts of the time range (default: one" << endl
+		<< "				 per job). Video parts are joined without encoding" << endl
+		<< "				 them again." << endl
+		<< "--retries N		 starts a failed part up to N more times (default 2)." << endl
+		<< "--software		 render with Mesa on the CPU instead of the GPU." << endl
+		<< "--tile-size N		 images larger than N x N pixels are rendered in" << endl
+		<< "				 tiles and written row by row such that they never" << endl
+		<< "				 have to fit into memory (default 2048)." << endl
+		<< "--mesh-residency MODE, --fixed-function, --shadow-map-size N and" << endl
+		<< "--shadow-cascades N are the same as without --render." << endl
+		<< endl
+		<< "With more than one part the finished parts are recorded in" << endl
+		<< "OUTPUT.chunks.json, running the same command again after an" << endl
+		<< "interruption or failure only renders the missing parts. --overlay" << endl
+		<< "requires a single part." << endl
+		<< endl
+		<< "Exit status: 0 on success, 2 for invalid arguments, 3 if no OpenGL" << endl
+		<< "context could be created, 4 if a file could not be loaded and 5 if" << endl
+		<< "the output could not be written." << endl;
+}
+
+static bool parse_draw_list (const string &list, SceneRenderer &renderer) {
+	renderer.draw_grid = false;
+	renderer.draw_floor = false;
+	renderer.draw_meshes = false;
+	renderer.draw_shadows = false;
+	renderer.draw_curves = false;
+	renderer.draw_points = false;
+	renderer.draw_forces = false;
+	renderer.draw_torques = false;
+	renderer.draw_base_axes = false;
+	renderer.draw_frame_axes = false;
+
+	istringstream list_stream (list);
+	string name;
+	while (getline (list_stream, name, ',')) {
+		if (name == "grid") {
+			renderer.draw_grid = true;
+		} else if (name == "floor") {
+			renderer.draw_floor = true;
+		} else if (name == "meshes") {
+			renderer.draw_meshes = true;
+		} else if (name == "shadows") {
+			renderer.draw_shadows = true;
+		} else if (name == "curves") {
+			renderer.draw_curves = true;
+		} else if (name == "points") {
+			renderer.draw_points = true;
+		} else if (name == "forces") {
+			renderer.draw_forces = true;
+		} else if (name == "torques") {
+			renderer.draw_torques = true;
+		} else if (name == "base_axes") {
+			renderer.draw_base_axes = true;
+		} else if (name == "frame_axes") {
+			renderer.draw_frame_axes = true;
+		} else {
+			cerr << "Error: unknown element '" << name << "' in --draw!" << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static string file_extension (const string &filename) {
+	if (filename.find (".") == string::npos)
+		return "";
+
+	string extension = filename.substr (filename.rfind (".") + 1);
+	transform (extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	return extension;
+}
+
+/// Parses the arguments into settings and renderer. Returns false if they
+/// are invalid.
+static bool parse_headless_arguments (int argc, char* argv[], HeadlessRenderSettings &settings, SceneRenderer &renderer) {
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool has_value = i + 1 < argc;
+
+		if (arg == "--help" || arg == "-h") {
+			print_headless_usage();
+			exit (HeadlessRenderSuccess);
+
+		} else if (arg == "--render") {
+			if (!has_value) {
+				cerr << "Error: --render requires an output file!" << endl;
+				return false;
+			}
+			settings.output_filename = argv[++i];
+
+		} else if (arg == "--size") {
+			char separator = 0;
+			istringstream size_stream (has_value ? argv[++i] : "");
+			if (!(size_stream >> settings.width >> separator >> settings.height)
+					|| separator != 'x' || settings.width <= 0 || settings.height <= 0) {
+				cerr << "Error: --size requires a resolution such as 1280x720!" << endl;
+				return false;
+			}
+
+		} else if (arg == "--fps" || arg == "--start" || arg == "--end") {
+			float value = 0.f;
+			istringstream value_stream (has_value ? argv[++i] : "");
+			if (!(value_stream >> value) || value < 0.f || (arg == "--fps" && value == 0.f)) {
+				cerr << "Error: " << arg << " requires a positive number!" << endl;
+				return false;
+			}
+
+			if (arg == "--fps")
+				settings.fps = value;
+			else if (arg == "--start")
+				settings.start_time = value;
+			else
+				settings.end_time = value;
+
+		} else if (arg == "--transparent") {
+			settings.transparent = true;
+
+		} else if (arg == "--white") {
+			renderer.white_mode = true;
+
+		} else if (arg == "--draw") {
+			if (!has_value || !parse_draw_list (argv[++i], renderer))
+				return false;
+
+		} else if (arg == "--codec") {
+			if (!has_value || !parse_video_codec (argv[++i], settings.video.codec)) {
+				cerr << "Error: --codec requires h264 or mpeg4!" << endl;
+				return false;
+			}
+
+		} else if (arg == "--thread-type") {
+			if (!has_value || !parse_video_thread_type (argv[++i], settings.video.thread_type)) {
+				cerr << "Error: --thread-type requires frame, slice or frame+slice!" << endl;
+				return false;
+			}
+
+		} else if (arg == "--scaler") {
+			if (!has_value || !parse_video_scaler (argv[++i], settings.video.scaler)) {
+				cerr << "Error: --scaler requires fast_bilinear, bilinear, bicubic or point!" << endl;
+				return false;
+			}
+
+		} else if (arg == "--gpu-yuv") {
+			settings.gpu_conversion = true;
+
+		} else if (arg == "--fast-png") {
+			settings.fast_png = true;
+
+		} else if (arg == "--overlay") {
+			ImageFileFormat format;
+			if (!has_value || !parse_image_file_extension (argv[i + 1], format)) {
+				cerr << "Error: --overlay requires a .png, .tga or .ppm file!" << endl;
+				return false;
+			}
+			settings.overlay_filename = argv[++i];
+
+		} else if (arg == "--jobs" || arg == "--chunks" || arg == "--retries" || arg == "--tile-size") {
+			int value = 0;
+			istringstream value_stream (has_value ? argv[++i] : "");
+			if (!(value_stream >> value) || value < (arg == "--retries" ? 0 : 1)) {
+				cerr << "Error: invalid value for " << arg << "!" << endl;
+				return false;
+			}
+
+			if (arg == "--jobs")
+				settings.jobs = value;
+			else if (arg == "--chunks")
+				settings.chunk_count = value;
+			else if (arg == "--retries")
+				settings.retries = value;
+			else
+				settings.tile_size = value;
+
+		} else if (arg == "--software") {
+			settings.software = true;
+
+		} else if (arg == "--crf" || arg == "--bitrate" || arg == "--gop"
+				|| arg == "--b-frames" || arg == "--encoder-threads") {
+			int value = 0;
+			istringstream value_stream (has_value ? argv[++i] : "");
+			if (!(value_stream >> value) || value < (arg == "--crf" ? -1 : 0) || (arg == "--crf" && value > 51)) {
+				cerr << "Error: invalid value for " << arg << "!" << endl;
+				return false;
+			}
+
+			if (arg == "--crf")
+				settings.video.crf = value;
+			else if (arg == "--bitrate")
+				settings.video.bitrate = value * 1000;
+			else if (arg == "--gop")
+				settings.video.gop = max (value, 1);
+			else if (arg == "--b-frames")
+				settings.video.bframes = value;
+			else
+				settings.video.threads = value;
+
+		} else if (arg == "--mesh-residency") {
+			string mode = has_value ? argv[++i] : "";
+			if (mode == "keep") {
+				MeshVBO::default_residency = MeshVBO::ResidencyKeep;
+			} else if (mode == "drop") {
+				MeshVBO::default_residency = MeshVBO::ResidencyDropAfterUpload;
+			} else if (mode == "reload") {
+				MeshVBO::default_residency = MeshVBO::ResidencyReloadFromSource;
+			} else {
+				cerr << "Error: invalid mesh residency '" << mode << "'! Must be keep, drop or reload." << endl;
+				return false;
+			}
+
+		} else if (arg == "--fixed-function") {
+			renderer.use_shader_renderer = false;
+
+		} else if (arg == "--shadow-map-size" || arg == "--shadow-cascades") {
+			if (!has_value || atoi (argv[i + 1]) <= 0) {
+				cerr << "Error: " << arg << " requires a positive number!" << endl;
+				return false;
+			}
+
+			i++;
+			if (arg == "--shadow-map-size")
+				renderer.shadow_map->size = min (atoi (argv[i]), static_cast<int>(ShadowMap::MaxSize));
+			else
+				renderer.shadow_map->cascade_count = min (atoi (argv[i]), static_cast<int>(ShadowMap::MaxCascades));
+
+		} else if (arg == "-s" || arg == "--script") {
+			cerr << "Error: scripts are not supported with --render!" << endl;
+			return false;
+
+		} else {
+			string extension = file_extension (arg);
+			if (extension == "lua" || extension == "csv" || extension == "txt"
+					|| extension == "ff" || extension == "cam") {
+				settings.files.push_back (arg);
+			} else {
+				cerr << "Error: couldn't determine filetype of " << arg << "!" << endl;
+				return false;
+			}
+		}
+	}
+
+	if (settings.output_filename == "") {
+		cerr << "Error: no output file given!" << endl;
+		return false;
+	}
+
+	ImageFileFormat format;
+	if (!parse_image_file_extension (settings.output_filename, format)) {
+		if (settings.width % 8 != 0 || settings.height % 8 != 0) {
+			cerr << "Error: the size of a video has to be a multiple of 8!" << endl;
+			return false;
+		}
+
+		if (settings.transparent)
+			cerr << "Warning: videos have no transparency, ignoring --transparent." << endl;
+		settings.transparent = false;
+	}
+
+	if (settings.chunk_count == 0)
+		settings.chunk_count = settings.jobs;
+
+	if (settings.chunk_count > 1 && settings.overlay_filename != "") {
+		cerr << "Error: --overlay cannot be used with more than one part!" << endl;
+		return false;
+	}
+
+	if (settings.renderTiles() && settings.overlay_filename != "") {
+		cerr << "Error: --overlay cannot be used with tiled images!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+/// Loads the files in the same way as MeshupApp: an animation belongs to
+/// the last model (which is loaded again if it already has an animation)
+/// and a force file to the last animation.
+static bool load_headless_files (const HeadlessRenderSettings &settings, Scene &scene, CameraOperator &cam_operator) {
+	for (unsigned int i = 0; i < settings.files.size(); i++) {
+		const string &filename = settings.files[i];
+		string extension = file_extension (filename);
+		string model_filename = filename;
+
+		if (extension == "csv" || extension == "txt") {
+			if (scene.models.size() == 0) {
+				cerr << "Error: could not load animation " << filename << " without a model!" << endl;
+				return false;
+			}
+
+			if (scene.models.size() > scene.animations.size()) {
+				Animation *animation = new Animation();
+				if (!animation->loadFromFile (filename.c_str(), scene.models.back()->configuration, false)) {
+					cerr << "Error: could not load animation " << filename << "!" << endl;
+					delete animation;
+					return false;
+				}
+
+				scene.animations.push_back (animation);
+				scene.longest_animation = std::max (scene.longest_animation, animation->duration);
+				continue;
+			}
+
+			// no model given for this animation therefore copy the previous
+			// model and load the animation again
+			model_filename = scene.models.back()->model_filename;
+			i--;
+		} else if (extension == "ff") {
+			if (scene.animations.size() <= scene.forcesTorquesQueue.size()) {
+				cerr << "Error: there has to be an animation for every force file (" << filename << ")!" << endl;
+				return false;
+			}
+
+			ForcesTorques *forces_torques = new ForcesTorques (scene.models[scene.forcesTorquesQueue.size()]);
+			if (!forces_torques->loadFromFile (filename.c_str(), false)) {
+				cerr << "Error: could not load forces " << filename << "!" << endl;
+				delete forces_torques;
+				return false;
+			}
+
+			scene.forcesTorquesQueue.push_back (forces_torques);
+			continue;
+		} else if (extension == "cam") {
+			if (!cam_operator.loadFromFile (filename.c_str(), false))
+				return false;
+
+			continue;
+		} else {
+			model_filename = find_model_file_by_name (filename.c_str());
+			if (model_filename.size() == 0) {
+				cerr << "Error: could not find model " << filename << "!" << endl;
+				return false;
+			}
+		}
+
+		MeshupModel *model = new MeshupModel;
+		if (!model->loadModelFromFile (model_filename.c_str(), false)) {
+			cerr << "Error: could not load model " << model_filename << "!" << endl;
+			delete model;
+			return false;
+		}
+		model->resetPoses();
+		model->updateSegments();
+
+		scene.models.push_back (model);
+	}
+
+	return true;
+}
+
+static string frame_filename (const string &output_filename, int frame_index) {
+	if (output_filename.find ("%") != string::npos) {
+		vector<char> buffer (output_filename.size() + 32);
+		snprintf (&buffer[0], buffer.size(), output_filename.c_str(), frame_index);
+		return string (&buffer[0]);
+	}
+
+	stringstream filename_stream;
+	size_t extension_start = output_filename.rfind (".");
+	filename_stream << output_filename.substr (0, extension_start) << "-" << setw(4) << setfill('0') << frame_index << output_filename.substr (extension_start);
+
+	return filename_stream.str();
+}
+
+/// Video written by one part of a distributed rendering, e.g. video.part002.mp4
+static string chunk_filename (const string &output_filename, int chunk_index) {
+	stringstream filename_stream;
+	size_t extension_start = output_filename.rfind (".");
+	filename_stream << output_filename.substr (0, extension_start) << ".part" << setw(3) << setfill('0') << chunk_index << output_filename.substr (extension_start);
+
+	return filename_stream.str();
+}
+
+static bool file_exists (const string &filename) {
+	ifstream file (filename.c_str());
+	return file.good();
+}
+
+/// All arguments that affect the rendered frames. The recorded progress of
+/// a rendering with other arguments is not used.
+static string job_arguments (int argc, char* argv[]) {
+	string arguments;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--jobs" || arg == "--retries") {
+			i++;
+			continue;
+		}
+
+		arguments += (arguments == "" ? "" : " ") + arg;
+	}
+
+	return arguments;
+}
+
+/// Reads which parts are already rendered. Returns false if there is no
+/// manifest of the same rendering.
+static bool read_chunk_manifest (const string &filename, const string &arguments, vector<bool> &done) {
+	ifstream manifest_file (filename.c_str());
+	if (!manifest_file)
+		return false;
+
+	Json::Value manifest;
+	Json::Reader reader;
+	if (!reader.parse (manifest_file, manifest)) {
+		cerr << "Warning: ignoring invalid file " << filename << "." << endl;
+		return false;
+	}
+
+	if (manifest.get ("arguments", "").asString() != arguments
+			|| manifest.get ("chunks", 0).asUInt() != done.size()) {
+		cerr << "Warning: " << filename << " belongs to a rendering with other arguments, starting over." << endl;
+		return false;
+	}
+
+	for (unsigned int i = 0; i < done.size(); i++)
+		done[i] = manifest["done"].get (i, false).asBool();
+
+	return true;
+}
+
+/// Replaces the manifest such that it is complete even if the coordinator
+/// gets interrupted
+static bool write_chunk_manifest (const string &filename, const string &arguments, const vector<bool> &done) {
+	Json::Value manifest;
+	manifest["arguments"] = arguments;
+	manifest["chunks"] = static_cast<unsigned int>(done.size());
+	manifest["done"] = Json::Value (Json::arrayValue);
+	for (unsigned int i = 0; i < done.size(); i++)
+		manifest["done"].append (static_cast<bool>(done[i]));
+
+	string temporary_filename = filename + ".tmp";
+	ofstream manifest_file (temporary_filename.c_str(), ios::trunc);
+	manifest_file << manifest;
+	manifest_file.close();
+
+	if (!manifest_file || rename (temporary_filename.c_str(), filename.c_str()) != 0) {
+		cerr << "Warning: could not write " << filename << "!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+/** Renders the parts of the time range in worker processes, at most
+ * settings.jobs at the same time, and joins the parts of a video.
+ *
+ * The workers are forked before any OpenGL context exists such that each
+ * creates its own. Failed parts are started again up to settings.retries
+ * times unless the arguments or files are invalid. Returns true in the
+ * coordinator, which sets status once all workers finished, and false in
+ * a worker, which has to render the part settings.chunk_index.
+ */
+static bool coordinate_headless_chunks (int argc, char* argv[], HeadlessRenderSettings &settings, int &status) {
+	ImageFileFormat image_format;
+	bool render_video = !parse_image_file_extension (settings.output_filename, image_format);
+
+	string manifest_filename = settings.output_filename + ".chunks.json";
+	string arguments = job_arguments (argc, argv);
+	vector<bool> done (settings.chunk_count, false);
+
+	if (read_chunk_manifest (manifest_filename, arguments, done)) {
+		for (int i = 0; i < settings.chunk_count; i++) {
+			if (done[i] && render_video && !file_exists (chunk_filename (settings.output_filename, i)))
+				done[i] = false;
+		}
+
+		cout << "Resuming " << settings.output_filename << ", " << count (done.begin(), done.end(), true) << " of " << settings.chunk_count << " parts are already rendered." << endl;
+	}
+
+	deque<int> pending;
+	for (int i = 0; i < settings.chunk_count; i++) {
+		if (!done[i])
+			pending.push_back (i);
+	}
+
+	map<pid_t, int> workers;
+	vector<int> attempts (settings.chunk_count, 0);
+	status = HeadlessRenderSuccess;
+
+	while (!pending.empty() || !workers.empty()) {
+		// no more parts are started after a failure
+		while (status == HeadlessRenderSuccess && !pending.empty() && static_cast<int>(workers.size()) < settings.jobs) {
+			int chunk_index = pending.front();
+			pending.pop_front();
+			attempts[chunk_index]++;
+
+			// buffered output would otherwise be written by both processes
+			cout.flush();
+			cerr.flush();
+
+			pid_t pid = fork();
+			if (pid == 0) {
+				settings.chunk_index = chunk_index;
+				if (render_video)
+					settings.output_filename = chunk_filename (settings.output_filename, chunk_index);
+				return false;
+			} else if (pid < 0) {
+				cerr << "Error: could not start a worker process!" << endl;
+				status = HeadlessRenderWriteError;
+				break;
+			}
+
+			workers[pid] = chunk_index;
+		}
+
+		if (workers.empty())
+			break;
+
+		int worker_status = 0;
+		pid_t pid = waitpid (-1, &worker_status, 0);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+
+			cerr << "Error: lost the worker processes!" << endl;
+			status = HeadlessRenderWriteError;
+			break;
+		}
+
+		map<pid_t, int>::iterator worker = workers.find (pid);
+		if (worker == workers.end())
+			continue;
+
+		int chunk_index = worker->second;
+		workers.erase (worker);
+
+		int exit_status = WIFEXITED (worker_status) ? WEXITSTATUS (worker_status) : -1;
+		if (exit_status == HeadlessRenderSuccess) {
+			done[chunk_index] = true;
+			write_chunk_manifest (manifest_filename, arguments, done);
+		} else if (exit_status == HeadlessRenderInvalidArguments || exit_status == HeadlessRenderLoadError) {
+			// all other parts would fail in the same way
+			if (status == HeadlessRenderSuccess)
+				status = exit_status;
+		} else if (attempts[chunk_index] <= settings.retries) {
+			cerr << "Warning: part " << chunk_index + 1 << "/" << settings.chunk_count << " failed, starting it again." << endl;
+			pending.push_back (chunk_index);
+		} else {
+			cerr << "Error: part " << chunk_index + 1 << "/" << settings.chunk_count << " failed " << attempts[chunk_index] << " times!" << endl;
+			if (status == HeadlessRenderSuccess)
+				status = exit_status > 0 ? exit_status : HeadlessRenderWriteError;
+		}
+	}
+
+	if (status != HeadlessRenderSuccess) {
+		cerr << "The finished parts are kept, running the same command again only renders the missing ones." << endl;
+		return true;
+	}
+
+	if (render_video) {
+		QStringList segments;
+		for (int i = 0; i < settings.chunk_count; i++)
+			segments.append (QString::fromStdString (chunk_filename (settings.output_filename, i)));
+
+		cout << "Joining " << settings.chunk_count << " parts to " << settings.output_filename << endl;
+		if (!QVideoEncoder::concatenateFiles (segments, QString::fromStdString (settings.output_filename))) {
+			cerr << "Error: could not join the parts of " << settings.output_filename << "!" << endl;
+			status = HeadlessRenderWriteError;
+			return true;
+		}
+
+		for (int i = 0; i < settings.chunk_count; i++)
+			remove (chunk_filename (settings.output_filename, i).c_str());
+	}
+
+	remove (manifest_filename.c_str());
+
+	return true;
+}
+
+/// Passes the oldest pending frame of the framebuffer to the writer
+static bool write_headless_image (const HeadlessRenderSettings &settings, OffscreenFramebuffer &framebuffer, ImageSeriesWriter &writer, int frame_index) {
+	unsigned char *bgra_pixels = writer.acquirePixels();
+	if (bgra_pixels == NULL || !framebuffer.finishRead (bgra_pixels))
+		return false;
+
+	return writer.submitPixels (bgra_pixels, frame_filename (settings.output_filename, frame_index));
+}
+
+/// Renders each frame in tiles straight into its file
+static int render_headless_tiles (const HeadlessRenderSettings &settings, SceneRenderer &renderer, Scene &scene, CameraOperator &cam_operator, OffscreenFramebuffer &framebuffer, int first_frame, int end_frame, int frame_count, ImageFileFormat image_format) {
+	for (int i = first_frame; i < end_frame; i++) {
+		float current_time = settings.start_time + static_cast<float>(i) / settings.fps;
+
+		scene.setCurrentTime (current_time);
+		cam_operator.updateCamera (current_time);
+
+		TiledImageRenderer tiled_renderer (settings.tile_size);
+		if (!tiled_renderer.render (renderer, *cam_operator.current_cam, framebuffer, frame_filename (settings.output_filename, i),
+					settings.width, settings.height, settings.transparent, image_format))
+			return HeadlessRenderWriteError;
+
+		cout << "Frame " << i + 1 << "/" << frame_count << " (t = " << current_time << ")" << endl;
+	}
+
+	return HeadlessRenderSuccess;
+}
+
+static void delete_headless_scene (Scene &scene) {
+	for (unsigned int i = 0; i < scene.forcesTorquesQueue.size(); i++)
+		delete scene.forcesTorquesQueue[i];
+	for (unsigned int i = 0; i < scene.animations.size(); i++)
+		delete scene.animations[i];
+	for (unsigned int i = 0; i < scene.models.size(); i++)
+		delete scene.models[i];
+}
+
+int render_headless (int argc, char* argv[]) {
+	HeadlessRenderSettings settings;
+
+	// the context has to be destroyed after the GL objects of the
+	// renderer and the scene
+	OffscreenContext context;
+	SceneRenderer renderer;
+	Scene scene;
+
+	if (!parse_headless_arguments (argc, argv, settings, renderer))
+		return HeadlessRenderInvalidArguments;
+
+	// also used by the worker processes
+	if (settings.software)
+		setenv ("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+
+	int status = HeadlessRenderSuccess;
+	if (settings.chunk_count > 1 && coordinate_headless_chunks (argc, argv, settings, status))
+		return status;
+
+	// the framebuffer of tiled images is recreated with the tile size
+	int context_width = settings.width;
+	int context_height = settings.height;
+	if (settings.renderTiles()) {
+		context_width = min (context_width, settings.tile_size);
+		context_height = min (context_height, settings.tile_size);
+	}
+
+	if (!context.init (context_width, context_height, settings.transparent) || !renderer.initGL())
+		return HeadlessRenderNoContext;
+
+	renderer.scene = &scene;
+	renderer.setClearColor (settings.transparent);
+
+	CameraOperator cam_operator (NULL);
+	cam_operator.current_cam = cam_operator.mobile_cam;
+	cam_operator.setCamWidth (settings.width);
+	cam_operator.setCamHeight (settings.height);
+
+	if (!load_headless_files (settings, scene, cam_operator))
+		return HeadlessRenderLoadError;
+
+	// a single camera position is used for the whole animation
+	if (cam_operator.cam_pos.size() == 1)
+		cam_operator.setFixAtCam (cam_operator.cam_pos[0]->cam);
+
+	if (renderer.draw_curves) {
+		for (unsigned int i = 0; i < scene.animations.size(); i++) {
+			CurveBuilder builder;
+			builder.start (*scene.models[i], *scene.animations[i]);
+			builder.wait();
+			builder.update (*scene.models[i]);
+		}
+	}
+
+	float end_time = settings.end_time;
+	if (end_time < 0.f)
+		end_time = scene.longest_animation;
+
+	if (end_time < settings.start_time) {
+		cerr << "Error: the end time " << end_time << " is before the start time " << settings.start_time << "!" << endl;
+		return HeadlessRenderInvalidArguments;
+	}
+
+	// small tolerance such that the end time is included despite rounding
+	int frame_count = static_cast<int>(floor ((end_time - settings.start_time) * settings.fps + 1.0e-3f)) + 1;
+
+	// a worker renders its part of the frames, the images keep their
+	// numbers and the part of a video starts at its first frame
+	int first_frame = 0;
+	int end_frame = frame_count;
+	if (settings.chunk_index >= 0) {
+		first_frame = settings.chunk_index * frame_count / settings.chunk_count;
+		end_frame = (settings.chunk_index + 1) * frame_count / settings.chunk_count;
+	}
+
+	ImageFileFormat image_format = ImageFilePNG;
+	bool render_video = !parse_image_file_extension (settings.output_filename, image_format);
+	if (image_format == ImageFilePNG && settings.fast_png)
+		image_format = ImageFileFastPNG;
+	OffscreenFramebuffer &framebuffer = context.framebuffer;
+
+	if (settings.renderTiles()) {
+		status = render_headless_tiles (settings, renderer, scene, cam_operator, framebuffer, first_frame, end_frame, frame_count, image_format);
+		delete_headless_scene (scene);
+		return status;
+	}
+
+	if (render_video && settings.gpu_conversion) {
+		if (!framebuffer.init (settings.width, settings.height, settings.transparent, true)) {
+			cerr << "Warning: converting the video frames on the CPU instead." << endl;
+			settings.gpu_conversion = false;
+			framebuffer.init (settings.width, settings.height, settings.transparent);
+		}
+		framebuffer.bind();
+	}
+
+	VideoExporter exporter;
+	exporter.pixel_format = framebuffer.yuv ? VideoExporter::PixelFormatYUV420 : VideoExporter::PixelFormatBGRA;
+	if (render_video && !exporter.open (settings.output_filename, settings.width, settings.height, static_cast<unsigned int>(roundf (settings.fps)), settings.video)) {
+		cerr << "Error: could not create video " << settings.output_filename << "!" << endl;
+		return HeadlessRenderWriteError;
+	}
+
+	cout << "Rendering frames " << first_frame + 1 << "-" << end_frame << " of " << frame_count << " (" << settings.width << "x" << settings.height << ") to " << settings.output_filename << endl;
+
+	// the images are compressed and written by a pool of threads
+	ImageSeriesWriter writer;
+	if (!render_video)
+		writer.open (settings.width, settings.height, settings.transparent, image_format, settings.overlay_filename != "");
+
+	// frames are read back asynchronously, the oldest pending frame is
+	// written once the transfer had the time of the following frames
+	int written_count = first_frame;
+	for (int i = first_frame; i < end_frame; i++) {
+		if (render_video) {
+			// the exporter converts the frames straight from the mapped
+			// pixel buffers
+			if (!exporter.reserveFrame (framebuffer)) {
+				cerr << "Error: could not encode frame " << i << "!" << endl;
+				exporter.finishFrames (framebuffer);
+				return HeadlessRenderWriteError;
+			}
+		} else if (framebuffer.isFull() && !write_headless_image (settings, framebuffer, writer, written_count++)) {
+			return HeadlessRenderWriteError;
+		}
+
+		float current_time = settings.start_time + static_cast<float>(i) / settings.fps;
+
+		scene.setCurrentTime (current_time);
+		cam_operator.updateCamera (current_time);
+		renderer.renderFrame (cam_operator.current_cam);
+		framebuffer.startRead();
+
+		cout << "Frame " << i + 1 << "/" << frame_count << " (t = " << current_time << ")" << endl;
+	}
+
+	if (render_video) {
+		bool frames_written = exporter.finishFrames (framebuffer);
+
+		// also writes the frames delayed by the encoder
+		if (!exporter.close() || !frames_written) {
+			cerr << "Error: could not write video " << settings.output_filename << "!" << endl;
+			return HeadlessRenderWriteError;
+		}
+	}
+
+	while (framebuffer.pending_count > 0) {
+		if (!write_headless_image (settings, framebuffer, writer, written_count++))
+			return HeadlessRenderWriteError;
+	}
+
+	// the overlay uses the format of its own file name
+	if (!render_video) {
+		ImageFileFormat overlay_format = image_format;
+		parse_image_file_extension (settings.overlay_filename, overlay_format);
+
+		if (!writer.close (settings.overlay_filename, overlay_format))
+			return HeadlessRenderWriteError;
+	}
+
+	delete_headless_scene (scene);
+
+	return HeadlessRenderSuccess;
+}
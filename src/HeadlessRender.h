@@ -0,0 +1,33 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_HEADLESSRENDER_H
+#define MESHUP_HEADLESSRENDER_H
+
+/// Exit status of meshup --render
+enum HeadlessRenderStatus {
+	HeadlessRenderSuccess = 0,
+	HeadlessRenderInvalidArguments = 2,
+	/// No OpenGL context could be created
+	HeadlessRenderNoContext = 3,
+	/// A model, animation, force or camera file could not be loaded
+	HeadlessRenderLoadError = 4,
+	/// An image or the video could not be written
+	HeadlessRenderWriteError = 5
+};
+
+/** \brief Renders a time range of the scene to images or a video without
+ * a window or display server (meshup --render).
+ *
+ * Uses an OffscreenContext and the SceneRenderer, no widgets are created.
+ * Returns a HeadlessRenderStatus that is used as exit status.
+ */
+int render_headless (int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "ImageFile.h"
+
+#include <cstdio>
+#include <algorithm>
+
+using namespace std;
+
+const char* image_file_format_name (ImageFileFormat format) {
+	if (format == ImageFileFastPNG)
+		return "fast_png";
+	else if (format == ImageFileTGA)
+		return "tga";
+	else if (format == ImageFilePPM)
+		return "ppm";
+
+	return "png";
+}
+
+bool parse_image_file_format (const std::string &name, ImageFileFormat &format) {
+	if (name == "png")
+		format = ImageFilePNG;
+	else if (name == "fast_png")
+		format = ImageFileFastPNG;
+	else if (name == "tga")
+		format = ImageFileTGA;
+	else if (name == "ppm")
+		format = ImageFilePPM;
+	else
+		return false;
+
+	return true;
+}
+
+const char* image_file_extension (ImageFileFormat format) {
+	if (format == ImageFileTGA)
+		return ".tga";
+	else if (format == ImageFilePPM)
+		return ".ppm";
+
+	return ".png";
+}
+
+bool parse_image_file_extension (const std::string &filename, ImageFileFormat &format) {
+	size_t extension_start = filename.rfind (".");
+	if (extension_start == string::npos)
+		return false;
+
+	string extension = filename.substr (extension_start);
+	transform (extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	if (extension == ".png")
+		format = ImageFilePNG;
+	else if (extension == ".tga")
+		format = ImageFileTGA;
+	else if (extension == ".ppm")
+		format = ImageFilePPM;
+	else
+		return false;
+
+	return true;
+}
+
+bool write_tga (const std::string &filename, int width, int height, const unsigned char *bgra_pixels) {
+	FILE *file = fopen (filename.c_str(), "wb");
+	if (!file)
+		return false;
+
+	// uncompressed true color, origin in the lower left corner, 8 bits of
+	// alpha
+	unsigned char header[18] = { 0 };
+	header[2] = 2;
+	header[12] = width & 0xff;
+	header[13] = (width >> 8) & 0xff;
+	header[14] = height & 0xff;
+	header[15] = (height >> 8) & 0xff;
+	header[16] = 32;
+	header[17] = 8;
+
+	size_t size = static_cast<size_t>(width) * height * 4;
+	bool result = fwrite (header, 1, sizeof(header), file) == sizeof(header)
+		&& fwrite (bgra_pixels, 1, size, file) == size;
+
+	return fclose (file) == 0 && result;
+}
+
+bool write_ppm (const std::string &filename, int width, int height, const unsigned char *bgra_pixels) {
+	FILE *file = fopen (filename.c_str(), "wb");
+	if (!file)
+		return false;
+
+	bool result = fprintf (file, "P6\n%d %d\n255\n", width, height) > 0;
+
+	vector<unsigned char> row (width * 3);
+	for (int y = height - 1; result && y >= 0; y--) {
+		const unsigned char *source = bgra_pixels + static_cast<size_t>(y) * width * 4;
+		for (int x = 0; x < width; x++) {
+			row[x * 3] = source[x * 4 + 2];
+			row[x * 3 + 1] = source[x * 4 + 1];
+			row[x * 3 + 2] = source[x * 4];
+		}
+
+		result = fwrite (&row[0], 1, row.size(), file) == row.size();
+	}
+
+	return fclose (file) == 0 && result;
+}
+
+void ImageAccumulator::reset (int width, int height) {
+	std::lock_guard<std::mutex> lock (mutex);
+
+	this->width = width;
+	this->height = height;
+	count = 0;
+	sums.assign (static_cast<size_t>(width) * height * 4, 0.f);
+}
+
+void ImageAccumulator::add (const unsigned char *pixels) {
+	std::lock_guard<std::mutex> lock (mutex);
+
+	for (size_t i = 0; i < sums.size(); i++)
+		sums[i] += pixels[i];
+
+	count++;
+}
+
+void ImageAccumulator::result (unsigned char *pixels) {
+	std::lock_guard<std::mutex> lock (mutex);
+
+	for (size_t i = 0; i < sums.size(); i++)
+		pixels[i] = static_cast<unsigned char>(min (sums[i], 255.f));
+}
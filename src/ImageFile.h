@@ -0,0 +1,77 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_IMAGEFILE_H
+#define MESHUP_IMAGEFILE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+/** \brief File formats of rendered image series.
+ *
+ * The uncompressed formats are much faster to write than PNG, fast PNG
+ * uses the fastest deflate level.
+ */
+enum ImageFileFormat {
+	ImageFilePNG = 0,
+	ImageFileFastPNG,
+	ImageFileTGA,
+	ImageFilePPM
+};
+
+/// Names as used in the settings file: "png", "fast_png", "tga" or "ppm"
+const char* image_file_format_name (ImageFileFormat format);
+bool parse_image_file_format (const std::string &name, ImageFileFormat &format);
+/// File extension including the dot, e.g. ".png"
+const char* image_file_extension (ImageFileFormat format);
+/// Format of a file name ending in .png, .tga or .ppm (in any case).
+/// Returns false for other file names.
+bool parse_image_file_extension (const std::string &filename, ImageFileFormat &format);
+
+/// Writes 8 bit BGRA pixels with the rows from bottom to top (as read by
+/// OpenGL) as uncompressed 32 bit TGA, which stores them in the same
+/// order.
+bool write_tga (const std::string &filename, int width, int height, const unsigned char *bgra_pixels);
+/// Writes 8 bit BGRA pixels with the rows from bottom to top as binary PPM
+/// (without the alpha channel).
+bool write_ppm (const std::string &filename, int width, int height, const unsigned char *bgra_pixels);
+
+/** \brief Sums up images for an overlay of a whole image series.
+ *
+ * Same result as adding the images one after the other with ImageMagick
+ * (composite -compose plus) but in memory. The sums of the 8 bit values
+ * are exact for up to 65793 images, the order of add() does not matter.
+ */
+struct ImageAccumulator {
+	ImageAccumulator() :
+		width (0),
+		height (0),
+		count (0)
+	{}
+
+	/// Clears the sums for images of the given size
+	void reset (int width, int height);
+	/// Adds 8 bit pixels with four channels, can be called by several
+	/// threads at the same time
+	void add (const unsigned char *pixels);
+	/// Writes the sums clamped to 255
+	void result (unsigned char *pixels);
+
+	int width;
+	int height;
+	/// Number of added images
+	unsigned int count;
+
+	/// Protects sums and count
+	std::mutex mutex;
+	std::vector<float> sums;
+};
+
+#endif
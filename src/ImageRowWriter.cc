@@ -0,0 +1,184 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "ImageRowWriter.h"
+#include "meshup_config.h"
+
+#include <iostream>
+#include <algorithm>
+
+#ifdef MESHUP_USE_PNG
+#include <png.h>
+#endif
+
+using namespace std;
+
+ImageRowWriter::ImageRowWriter() :
+	width (0),
+	height (0),
+	alpha (false),
+	format (ImageFilePNG),
+	row_count (0),
+	failed (false),
+	file (NULL),
+	png_ptr (NULL),
+	info_ptr (NULL)
+{}
+
+ImageRowWriter::~ImageRowWriter() {
+	close();
+}
+
+bool ImageRowWriter::isSupported (ImageFileFormat format) {
+#ifdef MESHUP_USE_PNG
+	bool png_supported = true;
+#else
+	bool png_supported = false;
+#endif
+
+	return format == ImageFileTGA || format == ImageFilePPM || png_supported;
+}
+
+bool ImageRowWriter::open (const std::string &filename, int width, int height, bool alpha, ImageFileFormat format) {
+	close();
+
+	if (!isSupported (format)) {
+		cerr << "Error: MeshUp was built without libpng, use .tga or .ppm for " << filename << "!" << endl;
+		return false;
+	}
+
+	this->width = width;
+	this->height = height;
+	this->alpha = alpha;
+	this->format = format;
+	row_count = 0;
+	failed = false;
+
+	file = fopen (filename.c_str(), "wb");
+	if (!file)
+		return false;
+
+	if (format == ImageFileTGA) {
+		// same as write_tga() but with the origin in the upper left corner
+		unsigned char header[18] = { 0 };
+		header[2] = 2;
+		header[12] = width & 0xff;
+		header[13] = (width >> 8) & 0xff;
+		header[14] = height & 0xff;
+		header[15] = (height >> 8) & 0xff;
+		header[16] = 32;
+		header[17] = 8 | 0x20;
+
+		failed = fwrite (header, 1, sizeof(header), file) != sizeof(header);
+	} else if (format == ImageFilePPM) {
+		row.resize (width * 3);
+		failed = fprintf (file, "P6\n%d %d\n255\n", width, height) <= 0;
+	} else {
+#ifdef MESHUP_USE_PNG
+		row.resize (width * (alpha ? 4 : 3));
+
+		png_ptr = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+		if (png_ptr)
+			info_ptr = png_create_info_struct (png_ptr);
+
+		if (!info_ptr) {
+			failed = true;
+		} else if (setjmp (png_jmpbuf (png_ptr))) {
+			failed = true;
+		} else {
+			png_init_io (png_ptr, file);
+			png_set_compression_level (png_ptr, format == ImageFileFastPNG ? 1 : 6);
+			png_set_IHDR (png_ptr, info_ptr, width, height, 8, alpha ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
+					PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+			png_write_info (png_ptr, info_ptr);
+		}
+#endif
+	}
+
+	if (failed) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+bool ImageRowWriter::writeRow (const unsigned char *bgra_pixels) {
+	if (!file || failed || row_count >= height)
+		return false;
+
+	row_count++;
+
+	if (format == ImageFileTGA) {
+		size_t size = static_cast<size_t>(width) * 4;
+		failed = fwrite (bgra_pixels, 1, size, file) != size;
+		return !failed;
+	}
+
+	int channels = (format == ImageFilePPM || !alpha) ? 3 : 4;
+	for (int x = 0; x < width; x++) {
+		const unsigned char *source = bgra_pixels + x * 4;
+		unsigned char *target = &row[x * channels];
+
+		if (channels == 4) {
+			// PNG stores the colors without the premultiplied alpha
+			unsigned int a = source[3];
+			for (int c = 0; c < 3; c++)
+				target[c] = a == 0 ? 0 : min ((source[2 - c] * 255u + a / 2) / a, 255u);
+			target[3] = a;
+		} else {
+			target[0] = source[2];
+			target[1] = source[1];
+			target[2] = source[0];
+		}
+	}
+
+	if (format == ImageFilePPM) {
+		failed = fwrite (&row[0], 1, row.size(), file) != row.size();
+		return !failed;
+	}
+
+#ifdef MESHUP_USE_PNG
+	if (setjmp (png_jmpbuf (png_ptr))) {
+		failed = true;
+		return false;
+	}
+
+	png_write_row (png_ptr, &row[0]);
+#endif
+
+	return true;
+}
+
+bool ImageRowWriter::close() {
+	if (!file)
+		return false;
+
+	if (row_count != height)
+		failed = true;
+
+#ifdef MESHUP_USE_PNG
+	if (png_ptr) {
+		if (setjmp (png_jmpbuf (png_ptr)))
+			failed = true;
+		else if (!failed)
+			png_write_end (png_ptr, info_ptr);
+
+		png_destroy_write_struct (&png_ptr, info_ptr ? &info_ptr : NULL);
+		png_ptr = NULL;
+		info_ptr = NULL;
+	}
+#endif
+
+	if (fclose (file) != 0)
+		failed = true;
+	file = NULL;
+
+	return !failed;
+}
@@ -0,0 +1,72 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_IMAGEROWWRITER_H
+#define MESHUP_IMAGEROWWRITER_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#include "ImageFile.h"
+
+struct png_struct_def;
+struct png_info_def;
+
+/** \brief Writes an image file row by row from top to bottom such that the
+ * whole image never has to be in memory.
+ *
+ * PNG files are compressed with libpng while the rows are written, which
+ * requires MeshUp to be built with libpng (MESHUP_USE_PNG). TGA and PPM
+ * files are always available.
+ *
+ * Usage:
+ *
+ * \code
+ *	ImageRowWriter writer;
+ *	writer.open ("poster.png", 16000, 9000, false, ImageFilePNG);
+ *	for (each row from top to bottom)
+ *		writer.writeRow (bgra_row);
+ *	writer.close();
+ * \endcode
+ */
+struct ImageRowWriter {
+	ImageRowWriter();
+	~ImageRowWriter();
+
+	/// Whether open() supports the format in this build
+	static bool isSupported (ImageFileFormat format);
+
+	/// Creates the file and writes its header. Returns false if the file
+	/// cannot be created or the format is not supported.
+	bool open (const std::string &filename, int width, int height, bool alpha, ImageFileFormat format);
+	/// Writes the next row of 8 bit BGRA pixels (the layout of
+	/// OffscreenFramebuffer) with premultiplied alpha. Returns false after
+	/// an error.
+	bool writeRow (const unsigned char *bgra_pixels);
+	/// Completes the file, returns false if it could not be written or
+	/// not all rows were given.
+	bool close();
+
+	int width;
+	int height;
+	bool alpha;
+	ImageFileFormat format;
+	/// Number of rows passed to writeRow()
+	int row_count;
+	bool failed;
+
+	FILE *file;
+	png_struct_def *png_ptr;
+	png_info_def *info_ptr;
+	/// Pixels of a row in the layout of the file
+	std::vector<unsigned char> row;
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "ImageSeriesWriter.h"
+
+#include <QImage>
+
+#include <iostream>
+
+using namespace std;
+
+static unsigned int default_thread_count (unsigned int thread_count) {
+	if (thread_count == 0)
+		thread_count = thread::hardware_concurrency();
+
+	return thread_count > 0 ? thread_count : 1;
+}
+
+// every thread and the caller hold one pixel buffer
+ImageSeriesWriter::ImageSeriesWriter (unsigned int thread_count, unsigned int queue_size) :
+	width (0),
+	height (0),
+	alpha (false),
+	format (ImageFilePNG),
+	overlay (false),
+	is_open (false),
+	failed (false),
+	thread_count (default_thread_count (thread_count)),
+	free_pixels (queue_size + default_thread_count (thread_count) + 1),
+	jobs (queue_size)
+{}
+
+ImageSeriesWriter::~ImageSeriesWriter() {
+	close();
+}
+
+bool ImageSeriesWriter::open (int width, int height, bool alpha, ImageFileFormat format, bool overlay) {
+	this->width = width;
+	this->height = height;
+	this->alpha = alpha;
+	this->format = format;
+	this->overlay = overlay;
+
+	if (overlay)
+		accumulator.reset (width, height);
+
+	for (unsigned int i = 0; i < free_pixels.capacity; i++) {
+		pixel_buffers.push_back (new unsigned char[width * height * 4]);
+		free_pixels.push (pixel_buffers[i]);
+	}
+
+	is_open = true;
+	for (unsigned int i = 0; i < thread_count; i++)
+		threads.push_back (std::thread (&ImageSeriesWriter::work, this));
+
+	return true;
+}
+
+unsigned char* ImageSeriesWriter::acquirePixels() {
+	unsigned char *pixels = NULL;
+
+	if (failed || !free_pixels.pop (pixels))
+		return NULL;
+
+	return pixels;
+}
+
+bool ImageSeriesWriter::submitPixels (unsigned char *pixels, const std::string &filename) {
+	Job job = { pixels, filename };
+	if (!jobs.push (job))
+		return false;
+
+	return !failed;
+}
+
+bool ImageSeriesWriter::close (const std::string &overlay_filename, ImageFileFormat overlay_format) {
+	if (!is_open)
+		return false;
+
+	// the threads finish the queued frames and then stop
+	jobs.close();
+	for (unsigned int i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	bool result = !failed;
+
+	if (overlay && !overlay_filename.empty() && accumulator.count > 0) {
+		vector<unsigned char> pixels (width * height * 4);
+		accumulator.result (&pixels[0]);
+
+		if (!writeImage (&pixels[0], overlay_filename, overlay_format)) {
+			cerr << "Error: could not write image " << overlay_filename << "!" << endl;
+			result = false;
+		}
+	}
+
+	for (unsigned int i = 0; i < pixel_buffers.size(); i++)
+		delete[] pixel_buffers[i];
+
+	pixel_buffers.clear();
+	threads.clear();
+	is_open = false;
+
+	return result;
+}
+
+bool ImageSeriesWriter::writeImage (const unsigned char *pixels, const std::string &filename, ImageFileFormat format) {
+	if (format == ImageFileTGA)
+		return write_tga (filename, width, height, pixels);
+	else if (format == ImageFilePPM)
+		return write_ppm (filename, width, height, pixels);
+
+	// uses the pixels without copying them, OpenGL stores the bottom row
+	// first
+	QImage image (pixels, width, height, alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+
+	// a quality of 80 selects the fastest deflate level of Qt's PNG writer
+	return image.mirrored().save (filename.c_str(), "PNG", format == ImageFileFastPNG ? 80 : -1);
+}
+
+void ImageSeriesWriter::work() {
+	Job job;
+	while (jobs.pop (job)) {
+		if (!failed) {
+			if (overlay)
+				accumulator.add (job.pixels);
+
+			if (!writeImage (job.pixels, job.filename, format)) {
+				cerr << "Error: could not write image " << job.filename << "!" << endl;
+				failed = true;
+			}
+		}
+
+		free_pixels.push (job.pixels);
+	}
+}
@@ -0,0 +1,92 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_IMAGESERIESWRITER_H
+#define MESHUP_IMAGESERIESWRITER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "BoundedQueue.h"
+#include "ImageFile.h"
+
+/** \brief Writes rendered frames as image files using a pool of threads.
+ *
+ * The frames are encoded and written by thread_count threads such that
+ * the PNG compression does not hold up the rendering. At most queue_size
+ * frames wait for a thread, the pixel buffers are allocated once and
+ * reused.
+ *
+ * If overlay is enabled the frames are also summed up into an
+ * ImageAccumulator and the overlay is written once by close().
+ *
+ * Usage:
+ *
+ * \code
+ *	ImageSeriesWriter writer;
+ *	writer.open (1280, 720, false, ImageFilePNG, true);
+ *	for (each frame) {
+ *		unsigned char *pixels = writer.acquirePixels();
+ *		// read the frame into pixels
+ *		writer.submitPixels (pixels, filename);
+ *	}
+ *	writer.close ("overlay.png", ImageFilePNG);
+ * \endcode
+ */
+struct ImageSeriesWriter {
+	/// A thread_count of 0 uses one thread per core
+	ImageSeriesWriter (unsigned int thread_count = 0, unsigned int queue_size = 8);
+	~ImageSeriesWriter();
+
+	/// Starts the threads for frames of the given size. Can only be called
+	/// once.
+	bool open (int width, int height, bool alpha, ImageFileFormat format, bool overlay);
+	/// Returns a buffer for the 8 bit BGRA pixels (rows from bottom to top)
+	/// of the next frame, blocks while all buffers are in use. Returns NULL
+	/// after an error.
+	unsigned char* acquirePixels();
+	/// Queues the pixels to be written to filename. Returns false after an
+	/// error.
+	bool submitPixels (unsigned char *pixels, const std::string &filename);
+	/// Waits until all frames are written and writes the overlay in
+	/// overlay_format (if enabled and overlay_filename is not empty).
+	/// Returns false if any file could not be written.
+	bool close (const std::string &overlay_filename = "", ImageFileFormat overlay_format = ImageFilePNG);
+
+	int width;
+	int height;
+	bool alpha;
+	ImageFileFormat format;
+	bool overlay;
+	bool is_open;
+	/// Set by the worker threads, frames after an error are dropped
+	std::atomic<bool> failed;
+
+	unsigned int thread_count;
+
+	struct Job {
+		unsigned char *pixels;
+		std::string filename;
+	};
+
+	BoundedQueue<unsigned char*> free_pixels;
+	BoundedQueue<Job> jobs;
+
+	std::vector<unsigned char*> pixel_buffers;
+	std::vector<std::thread> threads;
+
+	ImageAccumulator accumulator;
+
+	bool writeImage (const unsigned char *pixels, const std::string &filename, ImageFileFormat format);
+	void work();
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "GL/glew.h"
+
+#include "LineBuffer.h"
+
+#include <iostream>
+
+using namespace std;
+
+LineBuffer::LineBuffer() :
+	vbo_id (0),
+	vbo_capacity (0)
+{}
+
+void LineBuffer::clear() {
+	vertex_data.clear();
+	ranges.clear();
+}
+
+void LineBuffer::setLineWidth (float width) {
+	if (ranges.size() != 0 && ranges.back().width == width)
+		return;
+
+	// reuse the last range if no lines were added to it
+	if (ranges.size() != 0 && ranges.back().count == 0) {
+		ranges.back().width = width;
+		return;
+	}
+
+	Range range;
+	range.width = width;
+	range.first = vertexCount();
+	range.count = 0;
+	ranges.push_back (range);
+}
+
+void LineBuffer::addLine (const Vector3f &start, const Vector3f &end, const Vector3f &color) {
+	if (ranges.size() == 0)
+		setLineWidth (1.f);
+
+	const float line[12] = {
+		start[0], start[1], start[2], color[0], color[1], color[2],
+		end[0], end[1], end[2], color[0], color[1], color[2]
+	};
+
+	vertex_data.insert (vertex_data.end(), line, line + 12);
+	ranges.back().count += 2;
+}
+
+void LineBuffer::draw() {
+	if (vertex_data.size() == 0)
+		return;
+
+	size_t data_size = vertex_data.size() * sizeof(float);
+
+	if (vbo_id == 0)
+		glGenBuffers (1, &vbo_id);
+
+	glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
+
+	// orphan the previous content so that the driver does not have to wait
+	// for pending draws
+	if (data_size > vbo_capacity)
+		vbo_capacity = data_size * 2;
+	glBufferData (GL_ARRAY_BUFFER, vbo_capacity, NULL, GL_STREAM_DRAW);
+	glBufferSubData (GL_ARRAY_BUFFER, 0, data_size, &vertex_data[0]);
+
+	GLsizei stride = 6 * sizeof(float);
+	glVertexPointer (3, GL_FLOAT, stride, NULL);
+	glColorPointer (3, GL_FLOAT, stride, (const GLvoid *) (3 * sizeof(float)));
+
+	glEnableClientState (GL_VERTEX_ARRAY);
+	glEnableClientState (GL_COLOR_ARRAY);
+	glDisableClientState (GL_NORMAL_ARRAY);
+
+	float line_width;
+	glGetFloatv (GL_LINE_WIDTH, &line_width);
+
+	float line_range[2];
+	glGetFloatv (GL_ALIASED_LINE_WIDTH_RANGE, line_range);
+
+	for (size_t i = 0; i < ranges.size(); i++) {
+		if (ranges[i].count == 0)
+			continue;
+
+		if (ranges[i].width < line_range[0] || ranges[i].width > line_range[1]) {
+			cerr << "Warning: Only line widths within range [" << line_range[0] << ", " << line_range[1] << "] are supported by the graphics driver! (line_width = " << ranges[i].width << ")" << endl;
+		}
+
+		glLineWidth (ranges[i].width);
+		glDrawArrays (GL_LINES, ranges[i].first, ranges[i].count);
+	}
+
+	glLineWidth (line_width);
+
+	glDisableClientState (GL_COLOR_ARRAY);
+	glBindBuffer (GL_ARRAY_BUFFER, 0);
+}
+
+void LineBuffer::delete_vbo() {
+	if (vbo_id != 0)
+		glDeleteBuffers (1, &vbo_id);
+
+	vbo_id = 0;
+	vbo_capacity = 0;
+}
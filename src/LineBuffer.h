@@ -0,0 +1,61 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_LINEBUFFER_H
+#define MESHUP_LINEBUFFER_H
+
+#include <vector>
+
+#include "Math.h"
+
+/** \brief Collects colored line segments that change every frame and
+ * draws them from a single streamed vertex buffer.
+ *
+ * Lines with the same width are drawn with one glDrawArrays() call:
+ *
+ * \code
+ *	lines.clear();
+ *	lines.setLineWidth (2.f);
+ *	lines.addLine (start, end, color);
+ *	lines.draw();
+ * \endcode
+ */
+struct LineBuffer {
+	LineBuffer();
+
+	/// Consecutive lines that are drawn with the same width
+	struct Range {
+		float width;
+		unsigned int first;
+		unsigned int count;
+	};
+
+	/// Interleaved positions and colors (x, y, z, r, g, b)
+	std::vector<float> vertex_data;
+	std::vector<Range> ranges;
+
+	unsigned int vbo_id;
+	/// Size of the allocated buffer in bytes
+	size_t vbo_capacity;
+
+	void clear();
+	/// Width of the lines added afterwards
+	void setLineWidth (float width);
+	void addLine (const Vector3f &start, const Vector3f &end, const Vector3f &color);
+
+	unsigned int vertexCount() const {
+		return vertex_data.size() / 6;
+	}
+
+	/// Uploads the lines and draws them (requires a current GL context)
+	void draw();
+	void delete_vbo();
+};
+
+#endif
@@ -14,30 +14,62 @@
 #include "string_utils.h"
 
 #include <string.h>
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <fstream>
 #include <limits>
 #include <iostream>
+#include <queue>
 
 using namespace std;
 
 // warning vbos seem to be buggy!
 const bool use_vbo = true;
 
+VertexFormat MeshVBO::default_vertex_format;
+MeshVBO::ResidencyPolicy MeshVBO::default_residency = MeshVBO::ResidencyKeep;
+
 MeshVBO::MeshVBO (const MeshVBO& mesh)
 {
 	vbo_id = 0;
+	ibo_id = 0;
+	vao_id = 0;
+	arena_id = 0;
+	arena_base_vertex = 0;
+	arena_first_index = 0;
 	started = mesh.started;
 	smooth_shading = mesh.smooth_shading;
+	vertex_format = mesh.vertex_format;
+	buffer_format = mesh.buffer_format;
+	residency = mesh.residency;
+	resident = true;
+	source = mesh.source;
 	buffer_size = mesh.buffer_size;
+	buffer_vertex_count = mesh.buffer_vertex_count;
+	buffer_index_count = mesh.buffer_index_count;
+	stride = mesh.stride;
 	normal_offset = mesh.normal_offset;
 	color_offset = mesh.color_offset;
+	normal_type = mesh.normal_type;
+	color_type = mesh.color_type;
+	position_offset = mesh.position_offset;
+	position_scale = mesh.position_scale;
 	bbox_min = mesh.bbox_min;
 	bbox_max = mesh.bbox_max;
 
-	vertices = mesh.vertices;
-	normals = mesh.normals;
-	colors = mesh.colors;
+	if (mesh.resident) {
+		vertices = mesh.vertices;
+		normals = mesh.normals;
+		colors = mesh.colors;
+		indices = mesh.indices;
+	} else {
+		readBuffers (mesh);
+	}
+
+	lod_error = mesh.lod_error;
+	for (size_t i = 0; i < mesh.lods.size(); i++)
+		lods.push_back (new MeshVBO (*mesh.lods[i]));
 
 	if (mesh.vbo_id != 0) {
 		generate_vbo();
@@ -47,18 +79,40 @@ MeshVBO::MeshVBO (const MeshVBO& mesh)
 MeshVBO& MeshVBO::operator=(const MeshVBO& mesh) 
 {
 	if (this != &mesh) {
+		deleteBuffers();
+
 		vbo_id = 0;
+		ibo_id = 0;
 		started = mesh.started;
 		smooth_shading = mesh.smooth_shading;
+		vertex_format = mesh.vertex_format;
+		residency = mesh.residency;
+		resident = true;
+		source = mesh.source;
 		buffer_size = 0;
+		buffer_vertex_count = 0;
+		buffer_index_count = 0;
+		stride = 0;
 		normal_offset = 0;
 		color_offset = 0;
+		normal_type = 0;
+		color_type = 0;
 		bbox_min = mesh.bbox_min;
 		bbox_max = mesh.bbox_max;
 
-		vertices = mesh.vertices;
-		normals = mesh.normals;
-		colors = mesh.colors;
+		if (mesh.resident) {
+			vertices = mesh.vertices;
+			normals = mesh.normals;
+			colors = mesh.colors;
+			indices = mesh.indices;
+		} else {
+			readBuffers (mesh);
+		}
+
+		clearLODs();
+		lod_error = mesh.lod_error;
+		for (size_t i = 0; i < mesh.lods.size(); i++)
+			lods.push_back (new MeshVBO (*mesh.lods[i]));
 
 		if (mesh.vbo_id != 0) {
 			generate_vbo();
@@ -68,12 +122,117 @@ MeshVBO& MeshVBO::operator=(const MeshVBO& mesh)
 	return *this;
 }
 
+MeshVBO::MeshVBO (MeshVBO&& mesh) noexcept :
+	vbo_id (mesh.vbo_id),
+	ibo_id (mesh.ibo_id),
+	vao_id (mesh.vao_id),
+	arena_id (mesh.arena_id),
+	arena_base_vertex (mesh.arena_base_vertex),
+	arena_first_index (mesh.arena_first_index),
+	started (mesh.started),
+	smooth_shading (mesh.smooth_shading),
+	vertex_format (mesh.vertex_format),
+	buffer_format (mesh.buffer_format),
+	residency (mesh.residency),
+	resident (mesh.resident),
+	source (std::move (mesh.source)),
+	buffer_size (mesh.buffer_size),
+	buffer_vertex_count (mesh.buffer_vertex_count),
+	buffer_index_count (mesh.buffer_index_count),
+	stride (mesh.stride),
+	normal_offset (mesh.normal_offset),
+	color_offset (mesh.color_offset),
+	normal_type (mesh.normal_type),
+	color_type (mesh.color_type),
+	position_offset (mesh.position_offset),
+	position_scale (mesh.position_scale),
+	bbox_min (mesh.bbox_min),
+	bbox_max (mesh.bbox_max),
+	vertices (std::move (mesh.vertices)),
+	normals (std::move (mesh.normals)),
+	colors (std::move (mesh.colors)),
+	indices (std::move (mesh.indices)),
+	lods (std::move (mesh.lods)),
+	lod_error (mesh.lod_error)
+{
+	mesh.vbo_id = 0;
+	mesh.ibo_id = 0;
+	mesh.vao_id = 0;
+	mesh.arena_id = 0;
+	mesh.resident = true;
+	mesh.lods.clear();
+}
+
+MeshVBO& MeshVBO::operator= (MeshVBO&& mesh) noexcept {
+	if (this != &mesh) {
+		deleteBuffers();
+		clearLODs();
+
+		vbo_id = mesh.vbo_id;
+		ibo_id = mesh.ibo_id;
+		vao_id = mesh.vao_id;
+		arena_id = mesh.arena_id;
+		arena_base_vertex = mesh.arena_base_vertex;
+		arena_first_index = mesh.arena_first_index;
+		started = mesh.started;
+		smooth_shading = mesh.smooth_shading;
+		vertex_format = mesh.vertex_format;
+		buffer_format = mesh.buffer_format;
+		residency = mesh.residency;
+		resident = mesh.resident;
+		source = std::move (mesh.source);
+		buffer_size = mesh.buffer_size;
+		buffer_vertex_count = mesh.buffer_vertex_count;
+		buffer_index_count = mesh.buffer_index_count;
+		stride = mesh.stride;
+		normal_offset = mesh.normal_offset;
+		color_offset = mesh.color_offset;
+		normal_type = mesh.normal_type;
+		color_type = mesh.color_type;
+		position_offset = mesh.position_offset;
+		position_scale = mesh.position_scale;
+		bbox_min = mesh.bbox_min;
+		bbox_max = mesh.bbox_max;
+
+		vertices = std::move (mesh.vertices);
+		normals = std::move (mesh.normals);
+		colors = std::move (mesh.colors);
+		indices = std::move (mesh.indices);
+		lods = std::move (mesh.lods);
+		lod_error = mesh.lod_error;
+
+		mesh.vbo_id = 0;
+		mesh.ibo_id = 0;
+		mesh.vao_id = 0;
+		mesh.arena_id = 0;
+		mesh.resident = true;
+		mesh.lods.clear();
+	}
+
+	return *this;
+}
+
 void MeshVBO::begin() {
 	started = true;
+	resident = true;
+	source = MeshSource();
 
 	vertices.resize(0);
 	normals.resize(0);
 	colors.resize(0);
+	indices.resize(0);
+
+	clearLODs();
+}
+
+void MeshVBO::reserve (size_t vertex_count, bool with_normals, bool with_colors) {
+	vertices.reserve (vertex_count);
+
+	if (with_normals)
+		normals.reserve (vertex_count);
+
+	if (with_colors)
+		colors.reserve (vertex_count);
 }
 
 void MeshVBO::end() {
@@ -87,6 +246,59 @@ void MeshVBO::end() {
 	started = false;
 }
 
+static short quantize_snorm16 (float value) {
+	value = max (-1.f, min (1.f, value));
+	return static_cast<short>(floorf (value * 32767.f + 0.5f));
+}
+
+static unsigned char quantize_unorm8 (float value) {
+	value = max (0.f, min (1.f, value));
+	return static_cast<unsigned char>(floorf (value * 255.f + 0.5f));
+}
+
+static int quantize_snorm (float value, float max_value) {
+	value = max (-1.f, min (1.f, value));
+	return static_cast<int>(floorf (value * max_value + 0.5f));
+}
+
+static unsigned int pack_int_2_10_10_10_rev (const Vector3f &normal) {
+	unsigned int x = quantize_snorm (normal[0], 511.f) & 0x3ff;
+	unsigned int y = quantize_snorm (normal[1], 511.f) & 0x3ff;
+	unsigned int z = quantize_snorm (normal[2], 511.f) & 0x3ff;
+
+	return x | (y << 10) | (z << 20);
+}
+
+static float unpack_int10 (unsigned int value) {
+	// sign extend the 10 bit value
+	int result = static_cast<int>(value << 22) >> 22;
+	return max (-1.f, static_cast<float>(result) / 511.f);
+}
+
+/** Some drivers (e.g. Mesa) reject GL_INT_2_10_10_10_REV for
+ * glNormalPointer even though ARB_vertex_type_2_10_10_10_rev allows it,
+ * therefore we probe it once.
+ */
+static bool packed_normals_supported() {
+	static int supported = -1;
+
+	if (supported == -1) {
+		supported = 0;
+
+		if (GLEW_VERSION_3_3 || GLEW_ARB_vertex_type_2_10_10_10_rev) {
+			while (glGetError() != GL_NO_ERROR) {}
+
+			glNormalPointer (GL_INT_2_10_10_10_REV, 0, NULL);
+			if (glGetError() == GL_NO_ERROR)
+				supported = 1;
+
+			glNormalPointer (GL_FLOAT, 0, NULL);
+		}
+	}
+
+	return supported == 1;
+}
+
 unsigned int MeshVBO::generate_vbo() {
 	bool have_normals = false;
 	bool have_colors = false;
@@ -99,91 +311,332 @@ unsigned int MeshVBO::generate_vbo() {
 
 	assert (vbo_id == 0);
 	assert (started == false);
+	assert (resident);
 	assert (vertices.size() != 0);
 	assert (!have_normals || (normals.size() == vertices.size()));
 	assert (!have_colors || (colors.size() == vertices.size()));
 
-	// create the buffer
-	glGenBuffers (1, &vbo_id);
+	buffer_format = vertex_format;
 
-	// initialize the buffer object
-	glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
+	// compute the interleaved layout
+	GLsizeiptr position_size = sizeof(float) * 3;
+	if (buffer_format.position == VertexFormat::PositionShort3)
+		position_size = sizeof(short) * 4;
 
-	buffer_size = sizeof(float) * 4 * vertices.size();
-	normal_offset = 0;
-	color_offset = 0;
-	
+	GLsizeiptr normal_size = 0;
+	normal_type = 0;
 	if (have_normals) {
-		normal_offset = buffer_size;
-		buffer_size += sizeof(float) * 3 * normals.size();
+		if (buffer_format.normal == VertexFormat::NormalPacked) {
+			normal_size = 4;
+			if (packed_normals_supported())
+				normal_type = GL_INT_2_10_10_10_REV;
+			else
+				normal_type = GL_BYTE;
+		} else {
+			normal_size = sizeof(float) * 3;
+			normal_type = GL_FLOAT;
+		}
 	}
+
+	GLsizeiptr color_size = 0;
+	color_type = 0;
 	if (have_colors) {
-		color_offset = buffer_size;
-		buffer_size += sizeof(float) * 4 * colors.size();
+		if (buffer_format.color == VertexFormat::ColorUByte4) {
+			color_size = 4;
+			color_type = GL_UNSIGNED_BYTE;
+		} else {
+			color_size = sizeof(float) * 4;
+			color_type = GL_FLOAT;
+		}
 	}
 
+	normal_offset = position_size;
+	color_offset = normal_offset + normal_size;
+	stride = color_offset + color_size;
+	buffer_size = stride * vertices.size();
+	buffer_vertex_count = vertices.size();
+	buffer_index_count = indices.size();
+
+	// Quantized positions are stored relative to the center of the bounding
+	// box. A single scale is used for all axes so that the normals do not
+	// have to be corrected for the quantization.
+	position_offset = Vector3f (0.f, 0.f, 0.f);
+	position_scale = 1.f;
+
+	if (buffer_format.position == VertexFormat::PositionShort3) {
+		Vector3f vertex_min = vertices[0];
+		Vector3f vertex_max = vertices[0];
+		for (size_t i = 1; i < vertices.size(); i++) {
+			for (unsigned int j = 0; j < 3; j++) {
+				vertex_min[j] = min (vertex_min[j], vertices[i][j]);
+				vertex_max[j] = max (vertex_max[j], vertices[i][j]);
+			}
+		}
+
+		position_offset = (vertex_min + vertex_max) * 0.5f;
+		Vector3f half_extents = (vertex_max - vertex_min) * 0.5f;
+		float max_half_extent = max (half_extents[0], max (half_extents[1], half_extents[2]));
+		if (max_half_extent > 0.f)
+			position_scale = max_half_extent / 32767.f;
+	}
+
+	// create the buffer
+	glGenBuffers (1, &vbo_id);
+
+	// initialize the buffer object
+	glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
+
 	glBufferData (GL_ARRAY_BUFFER, buffer_size, NULL, GL_STATIC_DRAW);
 
 	// fill the data
-	
-	float *raw_buffer = (float*) glMapBuffer (GL_ARRAY_BUFFER, GL_READ_WRITE);
-	memcpy (&(raw_buffer[0]), &vertices[0], sizeof(float) * 4 * vertices.size());
+	unsigned char *raw_buffer = (unsigned char*) glMapBuffer (GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		unsigned char *vertex = raw_buffer + i * stride;
+
+		if (buffer_format.position == VertexFormat::PositionShort3) {
+			short position[4];
+			for (unsigned int j = 0; j < 3; j++)
+				position[j] = quantize_snorm16 ((vertices[i][j] - position_offset[j]) / (position_scale * 32767.f));
+			position[3] = 0;
+			memcpy (vertex, position, sizeof(position));
+		} else {
+			memcpy (vertex, vertices[i].data(), sizeof(float) * 3);
+		}
 
-	if (have_normals)
-		memcpy (&(raw_buffer[4 * vertices.size()]), &normals[0], sizeof(float) * 3 * normals.size());
+		if (have_normals) {
+			Vector3f normal = normals[i];
+			float length = normal.norm();
+			if (length > 0.f)
+				normal = normal / length;
+
+			if (normal_type == GL_INT_2_10_10_10_REV) {
+				unsigned int packed = pack_int_2_10_10_10_rev (normal);
+				memcpy (vertex + normal_offset, &packed, sizeof(packed));
+			} else if (normal_type == GL_BYTE) {
+				signed char packed[4];
+				for (unsigned int j = 0; j < 3; j++)
+					packed[j] = static_cast<signed char>(quantize_snorm (normal[j], 127.f));
+				packed[3] = 0;
+				memcpy (vertex + normal_offset, packed, sizeof(packed));
+			} else {
+				memcpy (vertex + normal_offset, normal.data(), sizeof(float) * 3);
+			}
+		}
 
-	if (have_colors)
-		memcpy (&(raw_buffer[(4 * vertices.size() + 3 * normals.size())]), &colors[0], sizeof(float) * 4 * colors.size());
+		if (have_colors) {
+			if (buffer_format.color == VertexFormat::ColorUByte4) {
+				unsigned char color[4];
+				for (unsigned int j = 0; j < 4; j++)
+					color[j] = quantize_unorm8 (colors[i][j]);
+				memcpy (vertex + color_offset, color, sizeof(color));
+			} else {
+				memcpy (vertex + color_offset, colors[i].data(), sizeof(float) * 4);
+			}
+		}
+	}
 
 	glUnmapBuffer (GL_ARRAY_BUFFER);
 
 	glBindBuffer (GL_ARRAY_BUFFER, 0);
 
+	if (indices.size() != 0) {
+		assert (ibo_id == 0);
+
+		glGenBuffers (1, &ibo_id);
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, ibo_id);
+		glBufferData (GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	releaseCPUData();
+
 	return vbo_id;
 }
 
 void MeshVBO::delete_vbo() {
+	ensureResident();
+
+	for (size_t i = 0; i < lods.size(); i++)
+		lods[i]->delete_vbo();
+
+	if (vbo_id != 0) {
+		glDeleteBuffers (1, &vbo_id);
+	}
+
+	if (ibo_id != 0) {
+		glDeleteBuffers (1, &ibo_id);
+	}
+
+	if (vao_id != 0) {
+		glDeleteVertexArrays (1, &vao_id);
+	}
+
+	vbo_id = 0;
+	ibo_id = 0;
+	vao_id = 0;
+	arena_id = 0;
+}
+
+void MeshVBO::deleteBuffers() {
+	for (size_t i = 0; i < lods.size(); i++)
+		lods[i]->deleteBuffers();
+
 	if (vbo_id != 0) {
 		glDeleteBuffers (1, &vbo_id);
 	}
 
+	if (ibo_id != 0) {
+		glDeleteBuffers (1, &ibo_id);
+	}
+
+	if (vao_id != 0) {
+		glDeleteVertexArrays (1, &vao_id);
+	}
+
 	vbo_id = 0;
+	ibo_id = 0;
+	vao_id = 0;
+	arena_id = 0;
 }
 
 void MeshVBO::debug_vbo () {
 	assert (vbo_id != 0 && "MeshVBO not initialized!");
 
-	glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
+	MeshVBO buffer_data;
+	buffer_data.readBuffers (*this);
 
-	float *raw_buffer =(float*) glMapBuffer (GL_ARRAY_BUFFER, GL_READ_ONLY);
+	cout << "stride = " << stride << " normal_offset = " << normal_offset << " color_offset = " << color_offset << endl;
 	cout << "vertices = " << endl;
-	for (unsigned int i=0; i < vertices.size(); i++) {
-		cout << "  [" << i << "] = " << raw_buffer[i*4] << ", " << raw_buffer[i*4 + 1] << ", " << raw_buffer[i*4+2] << endl;
-	}
+	for (unsigned int i=0; i < buffer_data.vertices.size(); i++) {
+		const Vector3f &position = buffer_data.vertices[i];
+		cout << "  [" << i << "] = " << position[0] << ", " << position[1] << ", " << position[2];
+
+		if (buffer_data.normals.size() != 0) {
+			const Vector3f &normal = buffer_data.normals[i];
+			cout << " normal = " << normal[0] << ", " << normal[1] << ", " << normal[2];
+		}
 
-	cout << "normals = " << endl;
-	for (unsigned int i=vertices.size(); i < vertices.size() + normals.size(); i++) {
-		cout << "  [" << i << "] = " << raw_buffer[i*3] << ", " << raw_buffer[i*3 + 1] << ", " << raw_buffer[i*3+2] << endl;
+		if (buffer_data.colors.size() != 0) {
+			const Vector4f &color = buffer_data.colors[i];
+			cout << " color = " << color[0] << ", " << color[1] << ", " << color[2] << ", " << color[3];
+		}
+
+		cout << endl;
 	}
 
-	cout << "colors = " << endl;
-	for (unsigned int i=vertices.size() + normals.size(); i < vertices.size() + normals.size() + colors.size(); i++) {
-		cout << "  [" << i << "] = " << raw_buffer[i*4] << ", " << raw_buffer[i*4 + 1] << ", " << raw_buffer[i*4+2] << endl;
+	if (buffer_data.indices.size() != 0) {
+		cout << "indices = " << endl;
+		for (unsigned int i = 0; i + 2 < buffer_data.indices.size(); i += 3) {
+			cout << "  [" << i / 3 << "] = " << buffer_data.indices[i] << ", " << buffer_data.indices[i + 1] << ", " << buffer_data.indices[i + 2] << endl;
+		}
 	}
+}
 
-	glUnmapBuffer(GL_ARRAY_BUFFER);
+void MeshVBO::readBuffers (const MeshVBO &mesh) {
+	assert (mesh.vbo_id != 0 && "MeshVBO not initialized!");
 
+	std::vector<unsigned char> raw_buffer (mesh.buffer_size);
+
+	glBindBuffer (GL_ARRAY_BUFFER, mesh.vbo_id);
+	glGetBufferSubData (GL_ARRAY_BUFFER, 0, mesh.buffer_size, &raw_buffer[0]);
 	glBindBuffer (GL_ARRAY_BUFFER, 0);
+
+	vertices.resize (mesh.buffer_vertex_count);
+	normals.resize (mesh.normal_type != 0 ? mesh.buffer_vertex_count : 0);
+	colors.resize (mesh.color_type != 0 ? mesh.buffer_vertex_count : 0);
+
+	for (unsigned int i = 0; i < mesh.buffer_vertex_count; i++) {
+		const unsigned char *vertex = &raw_buffer[i * mesh.stride];
+
+		if (mesh.buffer_format.position == VertexFormat::PositionShort3) {
+			short quantized[3];
+			memcpy (quantized, vertex, sizeof(quantized));
+			for (unsigned int j = 0; j < 3; j++)
+				vertices[i][j] = mesh.position_offset[j] + mesh.position_scale * quantized[j];
+		} else {
+			memcpy (vertices[i].data(), vertex, sizeof(float) * 3);
+		}
+
+		if (mesh.normal_type == GL_INT_2_10_10_10_REV) {
+			unsigned int packed;
+			memcpy (&packed, vertex + mesh.normal_offset, sizeof(packed));
+			for (unsigned int j = 0; j < 3; j++)
+				normals[i][j] = unpack_int10 (packed >> (10 * j));
+		} else if (mesh.normal_type == GL_BYTE) {
+			signed char packed[3];
+			memcpy (packed, vertex + mesh.normal_offset, sizeof(packed));
+			for (unsigned int j = 0; j < 3; j++)
+				normals[i][j] = max (-1.f, packed[j] / 127.f);
+		} else if (mesh.normal_type == GL_FLOAT) {
+			memcpy (normals[i].data(), vertex + mesh.normal_offset, sizeof(float) * 3);
+		}
+
+		if (mesh.color_type == GL_UNSIGNED_BYTE) {
+			for (unsigned int j = 0; j < 4; j++)
+				colors[i][j] = vertex[mesh.color_offset + j] / 255.f;
+		} else if (mesh.color_type == GL_FLOAT) {
+			memcpy (colors[i].data(), vertex + mesh.color_offset, sizeof(float) * 4);
+		}
+	}
+
+	indices.resize (mesh.buffer_index_count);
+	if (mesh.buffer_index_count != 0) {
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, mesh.ibo_id);
+		glGetBufferSubData (GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(unsigned int) * mesh.buffer_index_count, &indices[0]);
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	bbox_min = mesh.bbox_min;
+	bbox_max = mesh.bbox_max;
+	resident = true;
 }
 
-void MeshVBO::addVertex4f (float x, float y, float z, float w) {
-	Vector4f vertex;
-	vertex[0] = x;
-	vertex[1] = y;
-	vertex[2] = z;
-	vertex[3] = w;
-	vertices.push_back(vertex);
+void MeshVBO::ensureResident() {
+	if (resident)
+		return;
+
+	if (residency == ResidencyReloadFromSource && source.valid()) {
+		MeshVBO loaded;
+
+		if (loaded.loadOBJ (source.filename.c_str(), source.object_name == "" ? NULL : source.object_name.c_str())) {
+			if (source.welded)
+				loaded.weld();
+
+			if (source.optimize_cache_size > 0)
+				loaded.optimize (source.optimize_cache_size, source.reduce_overdraw);
+
+			// make sure we got the same mesh as before
+			if (loaded.vertices.size() == buffer_vertex_count && loaded.indices.size() == buffer_index_count) {
+				vertices.swap (loaded.vertices);
+				normals.swap (loaded.normals);
+				colors.swap (loaded.colors);
+				indices.swap (loaded.indices);
+				resident = true;
+
+				return;
+			}
+		}
+
+		cerr << "Warning: could not reload mesh '" << source.filename << "', reading back GPU data instead." << endl;
+	}
+
+	readBuffers (*this);
+}
+
+void MeshVBO::releaseCPUData() {
+	if (residency == ResidencyKeep || vbo_id == 0)
+		return;
+
+	std::vector<Vector3f>().swap (vertices);
+	std::vector<Vector3f>().swap (normals);
+	std::vector<Vector4f>().swap (colors);
+	std::vector<unsigned int>().swap (indices);
 
+	resident = false;
+}
+
+static void extend_bbox (Vector3f &bbox_min, Vector3f &bbox_max, const Vector3f &vertex) {
 	bbox_max[0] = max (vertex[0], bbox_max[0]);
 	bbox_max[1] = max (vertex[1], bbox_max[1]);
 	bbox_max[2] = max (vertex[2], bbox_max[2]);
@@ -193,6 +646,16 @@ void MeshVBO::addVertex4f (float x, float y, float z, float w) {
 	bbox_min[2] = min (vertex[2], bbox_min[2]);
 }
 
+void MeshVBO::addVertex4f (float x, float y, float z, float w) {
+	Vector3f vertex;
+	vertex[0] = x / w;
+	vertex[1] = y / w;
+	vertex[2] = z / w;
+	vertices.push_back(vertex);
+
+	extend_bbox (bbox_min, bbox_max, vertex);
+}
+
 void MeshVBO::addVertex4fv (const float vert[4]) {
 	addVertex4f (vert[0], vert[1], vert[2], vert[3]);
 }
@@ -249,35 +712,56 @@ void MeshVBO::draw(unsigned int mode) {
 	if (use_vbo) {
 		glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
 
-		glVertexPointer (4, GL_FLOAT, 0, NULL);
+		if (buffer_format.position == VertexFormat::PositionShort3) {
+			glPushMatrix();
+			glTranslatef (position_offset[0], position_offset[1], position_offset[2]);
+			glScalef (position_scale, position_scale, position_scale);
+			glVertexPointer (3, GL_SHORT, stride, NULL);
+		} else {
+			glVertexPointer (3, GL_FLOAT, stride, NULL);
+		}
 
-		if (normals.size() != 0) {
-			glNormalPointer (GL_FLOAT, 0, (const GLvoid *) normal_offset);
+		if (normal_type != 0) {
+			glNormalPointer (normal_type, stride, (const GLvoid *) normal_offset);
 		}
 
-		if (colors.size() != 0) {
-			glColorPointer (4, GL_FLOAT, 0, (const GLvoid *) (color_offset));
+		if (color_type != 0) {
+			glColorPointer (4, color_type, stride, (const GLvoid *) (color_offset));
 		}
 		
 		glEnableClientState (GL_VERTEX_ARRAY);
 
-		if (normals.size() != 0) {
+		if (normal_type != 0) {
 			glEnableClientState (GL_NORMAL_ARRAY);
 		} else {
 			glDisableClientState (GL_NORMAL_ARRAY);
 		}
 
-		if (colors.size() != 0) {
+		if (color_type != 0) {
 			glEnableClientState (GL_COLOR_ARRAY);
 		} else {
 			glDisableClientState (GL_COLOR_ARRAY);
 		}
 
-		glDrawArrays (mode, 0, vertices.size());
+		if (buffer_index_count != 0) {
+			glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, ibo_id);
+			glDrawElements (mode, buffer_index_count, GL_UNSIGNED_INT, NULL);
+			glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+		} else {
+			glDrawArrays (mode, 0, buffer_vertex_count);
+		}
 		glBindBuffer (GL_ARRAY_BUFFER, 0);
+
+		if (buffer_format.position == VertexFormat::PositionShort3)
+			glPopMatrix();
 	} else {
+		ensureResident();
+
+		size_t count = indices.size() != 0 ? indices.size() : vertices.size();
+
 		glBegin (mode);
-		for (size_t vi = 0; vi < vertices.size(); vi++) {
+		for (size_t i = 0; i < count; i++) {
+			size_t vi = indices.size() != 0 ? indices[i] : i;
 			if (colors.size() != 0)
 				glColor3fv (colors[vi].data());
 			if (normals.size() != 0)
@@ -288,36 +772,79 @@ void MeshVBO::draw(unsigned int mode) {
 	}
 }
 
+void MeshVBO::bindVertexArray() {
+	if (vbo_id == 0) {
+		// generate_vbo() must not modify the element buffer of another
+		// vertex array
+		glBindVertexArray (0);
+		generate_vbo();
+	}
+
+	if (vao_id != 0) {
+		glBindVertexArray (vao_id);
+		return;
+	}
+
+	glGenVertexArrays (1, &vao_id);
+	glBindVertexArray (vao_id);
+
+	glBindBuffer (GL_ARRAY_BUFFER, vbo_id);
+
+	if (buffer_format.position == VertexFormat::PositionShort3)
+		glVertexAttribPointer (AttributePosition, 3, GL_SHORT, GL_FALSE, stride, NULL);
+	else
+		glVertexAttribPointer (AttributePosition, 3, GL_FLOAT, GL_FALSE, stride, NULL);
+	glEnableVertexAttribArray (AttributePosition);
+
+	if (normal_type != 0) {
+		glVertexAttribPointer (AttributeNormal, normal_type == GL_INT_2_10_10_10_REV ? 4 : 3, normal_type, GL_TRUE, stride, (const GLvoid *) normal_offset);
+		glEnableVertexAttribArray (AttributeNormal);
+	}
+
+	if (color_type != 0) {
+		glVertexAttribPointer (AttributeColor, 4, color_type, GL_TRUE, stride, (const GLvoid *) color_offset);
+		glEnableVertexAttribArray (AttributeColor);
+	}
+
+	// the element buffer binding is part of the vertex array state
+	if (ibo_id != 0)
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, ibo_id);
+
+	glBindBuffer (GL_ARRAY_BUFFER, 0);
+}
+
 void MeshVBO::setColor(const Vector4f &color) {
+	ensureResident();
+	source = MeshSource();
+
 	for(int i=0;i<colors.size();i++) {
 		colors[i] = color;
 	}
 }
 
 void MeshVBO::transform(const Matrix44f &transformation) {
-	//save current data to be transformed 
-	MeshVBO old = MeshVBO(*this);
+	ensureResident();
+	clearLODs();
+	source = MeshSource();
 
-	bool have_normals = false;
-	bool have_colors = false;
-	if (normals.size() != 0)
-		have_normals = true;
-	if (colors.size() != 0)
-		have_colors = true;
+	Matrix33f rotation = transformation.block<3,3>(0,0);
 
-	//clear current data
-	vertices.clear();
-	normals.clear();
-	colors.clear();
+	bbox_min = Vector3f (
+			std::numeric_limits<float>::max(),
+			std::numeric_limits<float>::max(),
+			std::numeric_limits<float>::max());
+	bbox_max = -bbox_min;
 
-	Matrix33f rotation = transformation.block<3,3>(0,0);
+	for (unsigned int i = 0; i < vertices.size(); i++) {
+		Vector4f vertex (vertices[i][0], vertices[i][1], vertices[i][2], 1.f);
+		Vector4f transformed = (vertex.transpose() * transformation).transpose();
 
-	for (unsigned int i = 0; i < old.vertices.size(); i++) {
-		addVertex4fv ((old.vertices[i].transpose() * transformation).data());
-		if (have_normals)
-			addNormalfv ((old.normals[i].transpose() * rotation).data());
-		if (have_colors)
-			addColor4fv (old.colors[i].data());
+		vertices[i] = Vector3f (transformed[0], transformed[1], transformed[2]) / transformed[3];
+		extend_bbox (bbox_min, bbox_max, vertices[i]);
+	}
+
+	for (unsigned int i = 0; i < normals.size(); i++) {
+		normals[i] = (normals[i].transpose() * rotation).transpose();
 	}
 }
 
@@ -327,6 +854,16 @@ void MeshVBO::join (const Matrix44f &transformation, const MeshVBO &other) {
 		// To fix this create a temporary copy and use that for copying
 		abort();
 	}
+
+	if (!other.resident) {
+		MeshVBO other_data;
+		other_data.readBuffers (other);
+		join (transformation, other_data);
+		return;
+	}
+
+	ensureResident();
+	source = MeshSource();
 	bool have_normals = false;
 	bool have_colors = false;
 	bool other_have_normals = false;
@@ -357,10 +894,38 @@ void MeshVBO::join (const Matrix44f &transformation, const MeshVBO &other) {
 		abort();
 	}
 
+	clearLODs();
+
+	unsigned int vertex_offset = vertices.size();
+
+	reserve (vertex_offset + other.vertices.size(), have_normals, have_colors);
+	if (indices.size() != 0 || other.indices.size() != 0) {
+		indices.reserve (
+				(indices.size() != 0 ? indices.size() : vertex_offset)
+				+ (other.indices.size() != 0 ? other.indices.size() : other.vertices.size()));
+	}
+
+	// as soon as one of the meshes is indexed the result is indexed, too
+	if (indices.size() != 0 || other.indices.size() != 0) {
+		if (indices.size() == 0) {
+			for (unsigned int i = 0; i < vertex_offset; i++)
+				indices.push_back (i);
+		}
+
+		if (other.indices.size() == 0) {
+			for (unsigned int i = 0; i < other.vertices.size(); i++)
+				indices.push_back (vertex_offset + i);
+		} else {
+			for (unsigned int i = 0; i < other.indices.size(); i++)
+				indices.push_back (vertex_offset + other.indices[i]);
+		}
+	}
+
 	Matrix33f rotation = transformation.block<3,3>(0,0);
 
 	for (unsigned int i = 0; i < other.vertices.size(); i++) {
-		addVertex4fv ((other.vertices[i].transpose() * transformation).data());
+		Vector4f vertex (other.vertices[i][0], other.vertices[i][1], other.vertices[i][2], 1.f);
+		addVertex4fv ((vertex.transpose() * transformation).data());
 		if (have_normals)
 			addNormalfv ((other.normals[i].transpose() * rotation).data());
 		if (have_colors)
@@ -369,14 +934,817 @@ void MeshVBO::join (const Matrix44f &transformation, const MeshVBO &other) {
 }
 
 void MeshVBO::center() {
+	ensureResident();
+	source = MeshSource();
+
 	Vector3f displacement = - bbox_min - (bbox_max - bbox_min) * 0.5;
 	for (size_t i = 0; i < vertices.size(); i++) {
-		vertices[i] = vertices[i] + Vector4f (displacement[0], displacement[1], displacement[2], 0.);
+		vertices[i] = vertices[i] + displacement;
 	}
 	bbox_max += displacement;
 	bbox_min += displacement;
 }
 
+//
+// Mesh optimization
+//
+static int compare_floats (const float *a, const float *b, unsigned int count) {
+	for (unsigned int i = 0; i < count; i++) {
+		if (a[i] < b[i])
+			return -1;
+		if (a[i] > b[i])
+			return 1;
+	}
+
+	return 0;
+}
+
+struct VertexLess {
+	VertexLess (const MeshVBO &mesh_) :
+		mesh (mesh_)
+	{}
+
+	bool operator() (unsigned int a, unsigned int b) const {
+		int result = compare_floats (mesh.vertices[a].data(), mesh.vertices[b].data(), 3);
+
+		if (result == 0 && mesh.normals.size() != 0)
+			result = compare_floats (mesh.normals[a].data(), mesh.normals[b].data(), 3);
+
+		if (result == 0 && mesh.colors.size() != 0)
+			result = compare_floats (mesh.colors[a].data(), mesh.colors[b].data(), 4);
+
+		return result < 0;
+	}
+
+	const MeshVBO &mesh;
+};
+
+void MeshVBO::weld() {
+	ensureResident();
+
+	if (indices.size() != 0 || vertices.size() == 0)
+		return;
+
+	assert (vertices.size() % 3 == 0);
+
+	bool have_normals = normals.size() != 0;
+	bool have_colors = colors.size() != 0;
+
+	// sort the vertices such that identical vertices are next to each other.
+	// As the sort is stable the first entry of each group is the one that
+	// occurs first in the mesh.
+	std::vector<unsigned int> order (vertices.size());
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	VertexLess less (*this);
+	std::stable_sort (order.begin(), order.end(), less);
+
+	std::vector<unsigned int> representative (vertices.size());
+	representative[order[0]] = order[0];
+	for (unsigned int i = 1; i < order.size(); i++) {
+		if (less (order[i - 1], order[i]))
+			representative[order[i]] = order[i];
+		else
+			representative[order[i]] = representative[order[i - 1]];
+	}
+
+	std::vector<Vector3f> welded_vertices;
+	std::vector<Vector3f> welded_normals;
+	std::vector<Vector4f> welded_colors;
+	std::vector<unsigned int> remap (vertices.size());
+
+	indices.resize (vertices.size());
+
+	for (unsigned int i = 0; i < vertices.size(); i++) {
+		if (representative[i] == i) {
+			remap[i] = welded_vertices.size();
+
+			welded_vertices.push_back (vertices[i]);
+			if (have_normals)
+				welded_normals.push_back (normals[i]);
+			if (have_colors)
+				welded_colors.push_back (colors[i]);
+		}
+
+		indices[i] = remap[representative[i]];
+	}
+
+	vertices.swap (welded_vertices);
+	normals.swap (welded_normals);
+	colors.swap (welded_colors);
+
+	source.welded = true;
+}
+
+/** Computes the area weighted normal and centroid of a range of triangles.
+ */
+static void calc_cluster_geometry (
+		const MeshVBO &mesh,
+		const std::vector<unsigned int> &triangle_indices,
+		unsigned int first_triangle,
+		unsigned int last_triangle,
+		Vector3f &normal,
+		Vector3f &centroid,
+		float &area) {
+	normal = Vector3f::Zero();
+	centroid = Vector3f::Zero();
+	area = 0.f;
+
+	for (unsigned int t = first_triangle; t < last_triangle; t++) {
+		const Vector3f &p0 = mesh.vertices[triangle_indices[t * 3]];
+		const Vector3f &p1 = mesh.vertices[triangle_indices[t * 3 + 1]];
+		const Vector3f &p2 = mesh.vertices[triangle_indices[t * 3 + 2]];
+
+		Vector3f triangle_normal = (p1 - p0).cross (p2 - p0);
+		float triangle_area = triangle_normal.norm() * 0.5f;
+
+		normal += triangle_normal;
+		centroid += (p0 + p1 + p2) * (triangle_area / 3.f);
+		area += triangle_area;
+	}
+
+	if (area > 0.f)
+		centroid = centroid / area;
+}
+
+struct ClusterInfo {
+	unsigned int first_triangle;
+	unsigned int last_triangle;
+	float sort_key;
+
+	bool operator< (const ClusterInfo &other) const {
+		return sort_key > other.sort_key;
+	}
+};
+
+void MeshVBO::optimize (unsigned int cache_size, bool reduce_overdraw) {
+	ensureResident();
+
+	if (indices.size() == 0)
+		weld();
+
+	if (indices.size() == 0)
+		return;
+
+	assert (indices.size() % 3 == 0);
+
+	int vertex_count = vertices.size();
+	unsigned int triangle_count = indices.size() / 3;
+
+	// vertex -> triangle adjacency
+	std::vector<int> live_triangles (vertex_count, 0);
+	for (unsigned int i = 0; i < indices.size(); i++)
+		live_triangles[indices[i]]++;
+
+	std::vector<unsigned int> adjacency_offsets (vertex_count + 1, 0);
+	for (int v = 0; v < vertex_count; v++)
+		adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+
+	std::vector<unsigned int> adjacency (indices.size());
+	std::vector<unsigned int> adjacency_fill (adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+	for (unsigned int t = 0; t < triangle_count; t++) {
+		for (unsigned int j = 0; j < 3; j++) {
+			unsigned int v = indices[t * 3 + j];
+			adjacency[adjacency_fill[v]++] = t;
+		}
+	}
+
+	// Tipsify
+	std::vector<int> cache_time (vertex_count, 0);
+	std::vector<bool> emitted (triangle_count, false);
+	std::vector<unsigned int> dead_end_stack;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> cluster_starts;
+	std::vector<unsigned int> reordered;
+	reordered.reserve (indices.size());
+
+	int time = cache_size + 1;
+	int cursor = 0;
+	int fanning_vertex = 0;
+
+	while (cursor < vertex_count && live_triangles[cursor] == 0)
+		cursor++;
+
+	fanning_vertex = cursor < vertex_count ? cursor : -1;
+	cluster_starts.push_back (0);
+
+	while (fanning_vertex >= 0) {
+		candidates.clear();
+
+		for (unsigned int k = adjacency_offsets[fanning_vertex]; k < adjacency_offsets[fanning_vertex + 1]; k++) {
+			unsigned int t = adjacency[k];
+			if (emitted[t])
+				continue;
+
+			for (unsigned int j = 0; j < 3; j++) {
+				unsigned int v = indices[t * 3 + j];
+
+				reordered.push_back (v);
+				dead_end_stack.push_back (v);
+				candidates.push_back (v);
+				live_triangles[v]--;
+
+				if (time - cache_time[v] > static_cast<int>(cache_size)) {
+					cache_time[v] = time;
+					time++;
+				}
+			}
+
+			emitted[t] = true;
+		}
+
+		// choose the next fanning vertex among the vertices of the emitted
+		// triangles: prefer vertices that will still be in the cache once
+		// all of their remaining triangles have been emitted
+		int next_vertex = -1;
+		int best_priority = -1;
+		for (unsigned int i = 0; i < candidates.size(); i++) {
+			int v = candidates[i];
+			if (live_triangles[v] <= 0)
+				continue;
+
+			int priority = 0;
+			if (time - cache_time[v] + 2 * live_triangles[v] <= static_cast<int>(cache_size))
+				priority = time - cache_time[v];
+
+			if (priority > best_priority) {
+				best_priority = priority;
+				next_vertex = v;
+			}
+		}
+
+		if (next_vertex == -1) {
+			// dead end: use a recently referenced vertex or, if there is none
+			// left, the next vertex with remaining triangles
+			while (dead_end_stack.size() != 0) {
+				unsigned int v = dead_end_stack.back();
+				dead_end_stack.pop_back();
+
+				if (live_triangles[v] > 0) {
+					next_vertex = v;
+					break;
+				}
+			}
+
+			while (next_vertex == -1 && cursor < vertex_count) {
+				if (live_triangles[cursor] > 0)
+					next_vertex = cursor;
+				else
+					cursor++;
+			}
+
+			if (next_vertex != -1)
+				cluster_starts.push_back (reordered.size() / 3);
+		}
+
+		fanning_vertex = next_vertex;
+	}
+
+	assert (reordered.size() == indices.size());
+
+	// Overdraw reduction: sort the clusters such that the ones that face
+	// away from the mesh center get drawn first. The clusters start where
+	// Tipsify hit a dead end so that the cache behaviour stays mostly
+	// unaffected.
+	if (reduce_overdraw && cluster_starts.size() > 1) {
+		Vector3f mesh_normal, mesh_centroid;
+		float mesh_area;
+		calc_cluster_geometry (*this, reordered, 0, triangle_count, mesh_normal, mesh_centroid, mesh_area);
+
+		std::vector<ClusterInfo> clusters (cluster_starts.size());
+		for (unsigned int i = 0; i < clusters.size(); i++) {
+			clusters[i].first_triangle = cluster_starts[i];
+			clusters[i].last_triangle = (i + 1 < cluster_starts.size()) ? cluster_starts[i + 1] : triangle_count;
+
+			Vector3f normal, centroid;
+			float area;
+			calc_cluster_geometry (*this, reordered, clusters[i].first_triangle, clusters[i].last_triangle, normal, centroid, area);
+
+			float normal_length = normal.norm();
+			if (normal_length > 0.f)
+				clusters[i].sort_key = (centroid - mesh_centroid).dot (normal / normal_length);
+			else
+				clusters[i].sort_key = 0.f;
+		}
+
+		std::stable_sort (clusters.begin(), clusters.end());
+
+		std::vector<unsigned int> sorted;
+		sorted.reserve (reordered.size());
+		for (unsigned int i = 0; i < clusters.size(); i++) {
+			sorted.insert (sorted.end(),
+					reordered.begin() + clusters[i].first_triangle * 3,
+					reordered.begin() + clusters[i].last_triangle * 3);
+		}
+		reordered.swap (sorted);
+	}
+
+	// Vertex fetch optimization: order vertices by first use
+	std::vector<int> remap (vertex_count, -1);
+	unsigned int used_vertex_count = 0;
+	for (unsigned int i = 0; i < reordered.size(); i++) {
+		if (remap[reordered[i]] == -1)
+			remap[reordered[i]] = used_vertex_count++;
+
+		reordered[i] = remap[reordered[i]];
+	}
+
+	bool have_normals = normals.size() != 0;
+	bool have_colors = colors.size() != 0;
+
+	std::vector<Vector3f> sorted_vertices (used_vertex_count);
+	std::vector<Vector3f> sorted_normals (have_normals ? used_vertex_count : 0);
+	std::vector<Vector4f> sorted_colors (have_colors ? used_vertex_count : 0);
+
+	for (int v = 0; v < vertex_count; v++) {
+		if (remap[v] == -1)
+			continue;
+
+		sorted_vertices[remap[v]] = vertices[v];
+		if (have_normals)
+			sorted_normals[remap[v]] = normals[v];
+		if (have_colors)
+			sorted_colors[remap[v]] = colors[v];
+	}
+
+	vertices.swap (sorted_vertices);
+	normals.swap (sorted_normals);
+	colors.swap (sorted_colors);
+	indices.swap (reordered);
+
+	source.optimize_cache_size = cache_size;
+	source.reduce_overdraw = reduce_overdraw;
+}
+
+float MeshVBO::calcACMR (unsigned int cache_size) const {
+	if (!resident) {
+		MeshVBO buffer_data;
+		buffer_data.readBuffers (*this);
+		return buffer_data.calcACMR (cache_size);
+	}
+
+	if (vertices.size() == 0)
+		return 0.f;
+
+	// without indices every vertex gets transformed
+	if (indices.size() == 0)
+		return 3.f;
+
+	std::vector<int> insertion_time (vertices.size(), -1);
+	int time = 0;
+	unsigned int misses = 0;
+
+	for (unsigned int i = 0; i < indices.size(); i++) {
+		unsigned int v = indices[i];
+
+		if (insertion_time[v] < 0 || time - insertion_time[v] >= static_cast<int>(cache_size)) {
+			insertion_time[v] = time;
+			time++;
+			misses++;
+		}
+	}
+
+	return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+//
+// Level of detail
+//
+/** Symmetric 4x4 matrix that measures the sum of squared distances to a
+ * set of planes (Garland and Heckbert, "Surface Simplification Using
+ * Quadric Error Metrics", 1997).
+ */
+struct Quadric {
+	Quadric() {
+		for (unsigned int i = 0; i < 10; i++)
+			m[i] = 0.;
+	}
+
+	void addPlane (const Vector3f &normal, const Vector3f &point, double weight) {
+		double a = normal[0];
+		double b = normal[1];
+		double c = normal[2];
+		double d = - (a * point[0] + b * point[1] + c * point[2]);
+
+		m[0] += weight * a * a;
+		m[1] += weight * a * b;
+		m[2] += weight * a * c;
+		m[3] += weight * a * d;
+		m[4] += weight * b * b;
+		m[5] += weight * b * c;
+		m[6] += weight * b * d;
+		m[7] += weight * c * c;
+		m[8] += weight * c * d;
+		m[9] += weight * d * d;
+	}
+
+	Quadric& operator+= (const Quadric &other) {
+		for (unsigned int i = 0; i < 10; i++)
+			m[i] += other.m[i];
+
+		return *this;
+	}
+
+	double evaluate (const Vector3f &p) const {
+		double x = p[0];
+		double y = p[1];
+		double z = p[2];
+
+		return m[0] * x * x + 2. * m[1] * x * y + 2. * m[2] * x * z + 2. * m[3] * x
+			+ m[4] * y * y + 2. * m[5] * y * z + 2. * m[6] * y
+			+ m[7] * z * z + 2. * m[8] * z
+			+ m[9];
+	}
+
+	double m[10];
+};
+
+struct CollapseCandidate {
+	double cost;
+	/// vertex that is kept (and moved to target)
+	unsigned int keep;
+	/// vertex that is removed
+	unsigned int remove;
+	unsigned int keep_version;
+	unsigned int remove_version;
+	Vector3f target;
+
+	bool operator< (const CollapseCandidate &other) const {
+		return cost > other.cost;
+	}
+};
+
+struct Simplifier {
+	std::vector<Vector3f> positions;
+	std::vector<Quadric> quadrics;
+	std::vector<unsigned int> versions;
+	std::vector<bool> vertex_alive;
+	std::vector<std::vector<unsigned int> > vertex_triangles;
+	std::vector<unsigned int> triangles;
+	std::vector<bool> triangle_alive;
+	std::priority_queue<CollapseCandidate> queue;
+
+	CollapseCandidate makeCandidate (unsigned int a, unsigned int b) const {
+		Quadric q = quadrics[a];
+		q += quadrics[b];
+
+		Vector3f options[3] = {
+			positions[a],
+			positions[b],
+			(positions[a] + positions[b]) * 0.5f
+		};
+
+		CollapseCandidate candidate;
+		candidate.keep = a;
+		candidate.remove = b;
+		candidate.cost = std::numeric_limits<double>::max();
+
+		for (unsigned int i = 0; i < 3; i++) {
+			double cost = max (0., q.evaluate (options[i]));
+			if (cost < candidate.cost) {
+				candidate.cost = cost;
+				candidate.target = options[i];
+			}
+		}
+
+		candidate.keep_version = versions[a];
+		candidate.remove_version = versions[b];
+
+		return candidate;
+	}
+
+	Vector3f triangleNormal (unsigned int t, unsigned int moved_vertex, const Vector3f &moved_position) const {
+		Vector3f p[3];
+		for (unsigned int j = 0; j < 3; j++) {
+			unsigned int v = triangles[t * 3 + j];
+			p[j] = (v == moved_vertex) ? moved_position : positions[v];
+		}
+
+		return (p[1] - p[0]).cross (p[2] - p[0]);
+	}
+
+	/// Checks whether moving vertex to target flips any of its triangles
+	/// that do not contain other.
+	bool causesFlip (unsigned int vertex, unsigned int other, const Vector3f &target) const {
+		const std::vector<unsigned int> &adjacent = vertex_triangles[vertex];
+
+		for (size_t i = 0; i < adjacent.size(); i++) {
+			unsigned int t = adjacent[i];
+			if (!triangle_alive[t])
+				continue;
+
+			if (triangles[t * 3] == other || triangles[t * 3 + 1] == other || triangles[t * 3 + 2] == other)
+				continue;
+
+			Vector3f normal_before = triangleNormal (t, vertex, positions[vertex]);
+			Vector3f normal_after = triangleNormal (t, vertex, target);
+
+			if (normal_before.dot (normal_after) <= 0.f)
+				return true;
+		}
+
+		return false;
+	}
+};
+
+struct PositionLess {
+	PositionLess (const std::vector<Vector3f> &vertices_) :
+		vertices (vertices_)
+	{}
+
+	bool operator() (unsigned int a, unsigned int b) const {
+		return compare_floats (vertices[a].data(), vertices[b].data(), 3) < 0;
+	}
+
+	const std::vector<Vector3f> &vertices;
+};
+
+MeshVBO MeshVBO::simplify (unsigned int target_triangle_count, float *error) const {
+	if (!resident) {
+		MeshVBO buffer_data;
+		buffer_data.readBuffers (*this);
+		return buffer_data.simplify (target_triangle_count, error);
+	}
+
+	Simplifier simplifier;
+
+	// merge vertices by position only
+	std::vector<unsigned int> order (vertices.size());
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	PositionLess less (vertices);
+	std::stable_sort (order.begin(), order.end(), less);
+
+	std::vector<unsigned int> remap (vertices.size());
+	std::vector<unsigned int> source_vertex;
+	for (unsigned int i = 0; i < order.size(); i++) {
+		if (i == 0 || less (order[i - 1], order[i])) {
+			source_vertex.push_back (order[i]);
+			simplifier.positions.push_back (vertices[order[i]]);
+		}
+		remap[order[i]] = simplifier.positions.size() - 1;
+	}
+
+	unsigned int vertex_count = simplifier.positions.size();
+	unsigned int index_count = indices.size() != 0 ? indices.size() : vertices.size();
+
+	for (unsigned int i = 0; i + 2 < index_count; i += 3) {
+		unsigned int v[3];
+		for (unsigned int j = 0; j < 3; j++)
+			v[j] = remap[indices.size() != 0 ? indices[i + j] : i + j];
+
+		// skip triangles that became degenerate by the merging
+		if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2])
+			continue;
+
+		simplifier.triangles.insert (simplifier.triangles.end(), v, v + 3);
+	}
+
+	unsigned int triangle_count = simplifier.triangles.size() / 3;
+	simplifier.triangle_alive.resize (triangle_count, true);
+	simplifier.vertex_triangles.resize (vertex_count);
+	simplifier.quadrics.resize (vertex_count);
+	simplifier.versions.resize (vertex_count, 0);
+	simplifier.vertex_alive.resize (vertex_count, true);
+
+	// accumulate the plane quadrics and collect the edges
+	std::vector<std::pair<unsigned int, unsigned int> > edges;
+	for (unsigned int t = 0; t < triangle_count; t++) {
+		const unsigned int *v = &simplifier.triangles[t * 3];
+		Vector3f normal = simplifier.triangleNormal (t, v[0], simplifier.positions[v[0]]);
+		float length = normal.norm();
+		if (length > 0.f)
+			normal = normal / length;
+
+		for (unsigned int j = 0; j < 3; j++) {
+			simplifier.vertex_triangles[v[j]].push_back (t);
+			simplifier.quadrics[v[j]].addPlane (normal, simplifier.positions[v[0]], 1.);
+
+			unsigned int a = v[j];
+			unsigned int b = v[(j + 1) % 3];
+			edges.push_back (std::make_pair (min (a, b), max (a, b)));
+		}
+	}
+
+	std::sort (edges.begin(), edges.end());
+
+	// edges that are only used by a single triangle are on the border of the
+	// mesh. These get an additional plane perpendicular to the triangle that
+	// keeps the border in place.
+	for (unsigned int i = 0; i < edges.size(); i++) {
+		bool border = (i == 0 || edges[i - 1] != edges[i])
+			&& (i + 1 == edges.size() || edges[i + 1] != edges[i]);
+
+		if (!border)
+			continue;
+
+		unsigned int a = edges[i].first;
+		unsigned int b = edges[i].second;
+		const std::vector<unsigned int> &adjacent = simplifier.vertex_triangles[a];
+		for (size_t k = 0; k < adjacent.size(); k++) {
+			const unsigned int *v = &simplifier.triangles[adjacent[k] * 3];
+			if (v[0] != b && v[1] != b && v[2] != b)
+				continue;
+
+			Vector3f normal = simplifier.triangleNormal (adjacent[k], v[0], simplifier.positions[v[0]]);
+			Vector3f edge = simplifier.positions[b] - simplifier.positions[a];
+			Vector3f border_normal = edge.cross (normal);
+			float length = border_normal.norm();
+			if (length > 0.f) {
+				border_normal = border_normal / length;
+				simplifier.quadrics[a].addPlane (border_normal, simplifier.positions[a], 10.);
+				simplifier.quadrics[b].addPlane (border_normal, simplifier.positions[a], 10.);
+			}
+			break;
+		}
+	}
+
+	edges.erase (std::unique (edges.begin(), edges.end()), edges.end());
+	for (unsigned int i = 0; i < edges.size(); i++)
+		simplifier.queue.push (simplifier.makeCandidate (edges[i].first, edges[i].second));
+
+	// collapse edges until the target is reached
+	double max_cost = 0.;
+	std::vector<unsigned int> neighbors;
+
+	while (triangle_count > target_triangle_count && !simplifier.queue.empty()) {
+		CollapseCandidate candidate = simplifier.queue.top();
+		simplifier.queue.pop();
+
+		unsigned int keep = candidate.keep;
+		unsigned int remove = candidate.remove;
+
+		if (!simplifier.vertex_alive[keep] || !simplifier.vertex_alive[remove]
+				|| simplifier.versions[keep] != candidate.keep_version
+				|| simplifier.versions[remove] != candidate.remove_version)
+			continue;
+
+		if (simplifier.causesFlip (keep, remove, candidate.target)
+				|| simplifier.causesFlip (remove, keep, candidate.target))
+			continue;
+
+		max_cost = max (max_cost, candidate.cost);
+
+		simplifier.positions[keep] = candidate.target;
+		simplifier.quadrics[keep] += simplifier.quadrics[remove];
+		simplifier.vertex_alive[remove] = false;
+		simplifier.versions[keep]++;
+
+		std::vector<unsigned int> &keep_triangles = simplifier.vertex_triangles[keep];
+		const std::vector<unsigned int> &remove_triangles = simplifier.vertex_triangles[remove];
+
+		for (size_t i = 0; i < remove_triangles.size(); i++) {
+			unsigned int t = remove_triangles[i];
+			if (!simplifier.triangle_alive[t])
+				continue;
+
+			unsigned int *v = &simplifier.triangles[t * 3];
+			if (v[0] == keep || v[1] == keep || v[2] == keep) {
+				simplifier.triangle_alive[t] = false;
+				triangle_count--;
+				continue;
+			}
+
+			for (unsigned int j = 0; j < 3; j++) {
+				if (v[j] == remove)
+					v[j] = keep;
+			}
+			keep_triangles.push_back (t);
+		}
+		simplifier.vertex_triangles[remove].clear();
+
+		// drop dead triangles and update the candidates of the neighbors
+		neighbors.clear();
+		size_t alive_count = 0;
+		for (size_t i = 0; i < keep_triangles.size(); i++) {
+			unsigned int t = keep_triangles[i];
+			if (!simplifier.triangle_alive[t])
+				continue;
+
+			keep_triangles[alive_count++] = t;
+			for (unsigned int j = 0; j < 3; j++) {
+				if (simplifier.triangles[t * 3 + j] != keep)
+					neighbors.push_back (simplifier.triangles[t * 3 + j]);
+			}
+		}
+		keep_triangles.resize (alive_count);
+
+		std::sort (neighbors.begin(), neighbors.end());
+		neighbors.erase (std::unique (neighbors.begin(), neighbors.end()), neighbors.end());
+
+		for (size_t i = 0; i < neighbors.size(); i++)
+			simplifier.queue.push (simplifier.makeCandidate (keep, neighbors[i]));
+	}
+
+	if (error)
+		*error = static_cast<float>(sqrt (max_cost));
+
+	// assemble the simplified mesh with area weighted vertex normals
+	std::vector<Vector3f> vertex_normals (vertex_count, Vector3f (0.f, 0.f, 0.f));
+	for (unsigned int t = 0; t < simplifier.triangle_alive.size(); t++) {
+		if (!simplifier.triangle_alive[t])
+			continue;
+
+		const unsigned int *v = &simplifier.triangles[t * 3];
+		Vector3f normal = simplifier.triangleNormal (t, v[0], simplifier.positions[v[0]]);
+		for (unsigned int j = 0; j < 3; j++)
+			vertex_normals[v[j]] += normal;
+	}
+
+	MeshVBO result;
+	result.vertex_format = vertex_format;
+	result.smooth_shading = true;
+
+	std::vector<int> result_index (vertex_count, -1);
+	for (unsigned int t = 0; t < simplifier.triangle_alive.size(); t++) {
+		if (!simplifier.triangle_alive[t])
+			continue;
+
+		for (unsigned int j = 0; j < 3; j++) {
+			unsigned int v = simplifier.triangles[t * 3 + j];
+
+			if (result_index[v] == -1) {
+				result_index[v] = result.vertices.size();
+
+				result.addVertex3fv (simplifier.positions[v].data());
+
+				Vector3f normal = vertex_normals[v];
+				float length = normal.norm();
+				if (length > 0.f)
+					normal = normal / length;
+				result.addNormalfv (normal.data());
+
+				if (colors.size() != 0)
+					result.addColor4fv (colors[source_vertex[v]].data());
+			}
+
+			result.indices.push_back (result_index[v]);
+		}
+	}
+
+	if (result.indices.size() != 0)
+		result.optimize();
+
+	return result;
+}
+
+void MeshVBO::generateLODs (unsigned int level_count, float reduction) {
+	// meshes with less triangles are not worth simplifying
+	const unsigned int min_triangle_count = 32;
+
+	ensureResident();
+	clearLODs();
+
+	float diagonal = (bbox_max - bbox_min).norm();
+	if (vertices.size() == 0 || diagonal <= 0.f)
+		return;
+
+	const MeshVBO *source = this;
+	float accumulated_error = 0.f;
+
+	for (unsigned int level = 0; level < level_count; level++) {
+		unsigned int source_triangle_count = (source->indices.size() != 0 ? source->indices.size() : source->vertices.size()) / 3;
+		unsigned int target_triangle_count = static_cast<unsigned int>(source_triangle_count * reduction);
+
+		if (target_triangle_count < min_triangle_count)
+			break;
+
+		float level_error = 0.f;
+		MeshVBO *lod = new MeshVBO (source->simplify (target_triangle_count, &level_error));
+
+		// stop if the mesh could not be reduced considerably
+		if (lod->indices.size() / 3 > source_triangle_count * 0.9f) {
+			delete lod;
+			break;
+		}
+
+		accumulated_error += level_error;
+		lod->lod_error = accumulated_error / diagonal;
+		lod->residency = (residency == ResidencyKeep) ? ResidencyKeep : ResidencyDropAfterUpload;
+		lods.push_back (lod);
+
+		source = lod;
+	}
+}
+
+void MeshVBO::clearLODs() {
+	for (size_t i = 0; i < lods.size(); i++)
+		delete lods[i];
+
+	lods.clear();
+}
+
+MeshVBO* MeshVBO::selectLOD (float projected_size, float max_pixel_error) {
+	for (size_t i = lods.size(); i > 0; i--) {
+		if (lods[i - 1]->lod_error * projected_size <= max_pixel_error)
+			return lods[i - 1];
+	}
+
+	return this;
+}
+
 //
 // OBJ loader
 //
@@ -647,12 +2015,16 @@ bool MeshVBO::loadOBJ (const char* filename, const char* object_name, bool stric
 
 	file_stream.close();
 
+	source.filename = filename;
+	source.object_name = object_name ? object_name : "";
+
 	return true;
 }
 
 MeshVBO CreateUVSphere (unsigned int rows, unsigned int segments) {
 	MeshVBO result;
 	result.begin();
+	result.reserve (rows * segments * 6);
 
 	float row_d = 1. / (rows);
 	float angle_d = 2 * M_PI / static_cast<float>(segments);
@@ -705,6 +2077,7 @@ MeshVBO CreateUVSphere (unsigned int rows, unsigned int segments) {
 MeshVBO CreateCuboid (float width, float height, float depth) {
 	MeshVBO result;
 	result.begin();
+	result.reserve (36);
 
 	Vector3f v0 (  0.5 * width, -0.5 * height,  0.5 * depth);
 	Vector3f v1 (  0.5 * width, -0.5 * height, -0.5 * depth);
@@ -825,6 +2198,8 @@ MeshVBO CreateGrid (unsigned int cells_u, unsigned int cells_v, const Vector3f &
 	MeshVBO result;
 
 	result.begin();
+	result.reserve (cells_u * cells_v * 6, true, true);
+
 	Vector3f u_vec_temp (1.f, 0.f, 0.f);
 	if (u_vec_temp.dot(normal.normalized()) > 0.8) {
 		u_vec_temp = Vector3f (0.f, 1.f, 0.f);
@@ -881,6 +2256,7 @@ MeshVBO CreateCylinder (unsigned int segments) {
 	MeshVBO result;
 	
 	result.begin();
+	result.reserve (segments * 12);
 
 	float delta = 2. * M_PI / static_cast<float>(segments);
 	for (unsigned int i = 0; i < segments; i++) {
@@ -957,6 +2333,7 @@ MeshVBO CreateCylinder (unsigned int segments, float length, float scaleRadius,
 	length = length*0.5;
 	
 	result.begin();
+	result.reserve (segments * 12, true, true);
 
 	float delta = 2. * M_PI / static_cast<float>(segments);
 
@@ -1045,6 +2422,7 @@ MeshVBO CreateOpenTorus(int segments, float width, float radius, Vector4f color,
 	std::vector<Vector3f> current_circ(circseg);
 
 	result.begin();
+	result.reserve ((showmiddle ? 6 : 0) + segments * circseg * 6, true, true);
 
 	if (showmiddle) {
 		Vector3f p0(middle[0]+0.04, middle[1], middle[2]);
@@ -1154,9 +2532,10 @@ MeshVBO CreateCapsule (unsigned int rows, unsigned int segments, float length_z,
 
 	MeshVBO sphere = CreateUVSphere (rows, segments);
 	MeshVBO half_sphere;
+	half_sphere.reserve (sphere.vertices.size() / 2);
 
 	for (unsigned int i = 0; i < sphere.vertices.size() * 0.5; i++) {
-		half_sphere.addVertex4fv (sphere.vertices[i].data());
+		half_sphere.addVertex3fv (sphere.vertices[i].data());
 		half_sphere.addNormalfv (sphere.normals[i].data());
 	}
 
@@ -1224,6 +2603,7 @@ MeshVBO CreateCone(int segments, float height, float radius, Vector4f color){
 	MeshVBO result;
 
 	result.begin();
+	result.reserve (segments * 6, true, true);
 
 	float delta = 2. * M_PI / static_cast<float>(segments);
 
@@ -40,35 +40,140 @@ struct Material {
 	unsigned int texture_bump;
 };
 
+/** \brief Describes how the vertex attributes are stored in the GPU buffer.
+ *
+ * All attributes are interleaved per vertex. Each attribute starts at a
+ * multiple of 4 bytes.
+ */
+struct VertexFormat {
+	enum PositionType {
+		/// 3 floats (12 bytes)
+		PositionFloat3,
+		/// 3 shorts quantized to the bounding box of the mesh (8 bytes)
+		PositionShort3
+	};
+	enum NormalType {
+		/// 3 floats (12 bytes)
+		NormalFloat3,
+		/// GL_INT_2_10_10_10_REV or 3 bytes if not supported (4 bytes)
+		NormalPacked
+	};
+	enum ColorType {
+		/// 4 floats (16 bytes)
+		ColorFloat4,
+		/// RGBA8 (4 bytes)
+		ColorUByte4
+	};
+
+	VertexFormat() :
+		position (PositionFloat3),
+		normal (NormalPacked),
+		color (ColorUByte4)
+	{}
+	VertexFormat (PositionType position_, NormalType normal_, ColorType color_) :
+		position (position_),
+		normal (normal_),
+		color (color_)
+	{}
+
+	PositionType position;
+	NormalType normal;
+	ColorType color;
+};
+
+/** \brief Describes how the CPU-side data of a mesh can be recreated from
+ * its OBJ file.
+ */
+struct MeshSource {
+	MeshSource() :
+		filename (""),
+		object_name (""),
+		welded (false),
+		optimize_cache_size (0),
+		reduce_overdraw (false)
+	{}
+
+	bool valid() const {
+		return filename != "";
+	}
+
+	std::string filename;
+	std::string object_name;
+	bool welded;
+	/// Cache size used for MeshVBO::optimize() (0 if not optimized)
+	unsigned int optimize_cache_size;
+	bool reduce_overdraw;
+};
+
 /** \brief Loads Wavefront VBO files and prepares them for use in
  * OpenGL.
  */
 struct MeshVBO {
+	/// What happens to the CPU-side data once it was uploaded to the GPU
+	enum ResidencyPolicy {
+		/// vertices, normals, colors and indices stay in memory
+		ResidencyKeep,
+		/// the data is released and read back from the GPU when needed
+		ResidencyDropAfterUpload,
+		/// the data is released and loaded again from the source file
+		/// when needed (falls back to ResidencyDropAfterUpload if the mesh
+		/// was not loaded from a file or modified afterwards)
+		ResidencyReloadFromSource
+	};
+
+	/// Generic vertex attribute locations used by bindVertexArray()
+	enum VertexAttribute {
+		AttributePosition = 0,
+		AttributeNormal = 1,
+		AttributeColor = 2
+	};
+
 	MeshVBO() :
 		vbo_id(0),
+		ibo_id(0),
+		vao_id(0),
+		arena_id(0),
+		arena_base_vertex(0),
+		arena_first_index(0),
 		started(false),
 		smooth_shading(true),
+		vertex_format (default_vertex_format),
+		residency (default_residency),
+		resident (true),
 		buffer_size (0),
+		buffer_vertex_count (0),
+		buffer_index_count (0),
+		stride (0),
 		normal_offset (0),
 		color_offset (0),
+		normal_type (0),
+		color_type (0),
+		position_offset (0.f, 0.f, 0.f),
+		position_scale (1.f),
 		bbox_min (std::numeric_limits<float>::max(),
 				std::numeric_limits<float>::max(),
 				std::numeric_limits<float>::max()),
 		bbox_max (-std::numeric_limits<float>::max(),
 				-std::numeric_limits<float>::max(),
-				-std::numeric_limits<float>::max())
+				-std::numeric_limits<float>::max()),
+		lod_error (0.f)
 	{}
 	MeshVBO (const MeshVBO& mesh);
 	MeshVBO& operator= (const MeshVBO& mesh);
+	/// Takes over the data and the GPU buffers of mesh
+	MeshVBO (MeshVBO&& mesh) noexcept;
+	MeshVBO& operator= (MeshVBO&& mesh) noexcept;
 	~MeshVBO() {
-		if (vbo_id != 0) {
-			delete_vbo();
-		}
+		deleteBuffers();
+		clearLODs();
 	}
 
 	void begin();
 	void end();
 
+	/// Reserves memory for vertex_count vertices (and normals and colors)
+	void reserve (size_t vertex_count, bool with_normals = true, bool with_colors = false);
+
 	void addVertex4f (float x, float y, float z, float w);
 	void addVertex4fv (const float vert[4]);
 	void addVertex3f (float x, float y, float z);
@@ -81,31 +186,141 @@ struct MeshVBO {
 	void addColor3fv (const float color[3]);
 
 	unsigned int generate_vbo();
+	/// Deletes the GPU buffers (CPU-side data that was released gets
+	/// fetched first)
 	void delete_vbo();
+	/// Deletes the GPU buffers of this mesh and its LODs without fetching
+	/// released data
+	void deleteBuffers();
 	void debug_vbo();
 
+	/// Makes sure the CPU-side data is available (see ResidencyPolicy)
+	void ensureResident();
+	/// Releases the CPU-side data if the residency policy allows it
+	void releaseCPUData();
+	/// Decodes the GPU buffers of source into the CPU-side arrays
+	void readBuffers (const MeshVBO &source);
+
 	void draw(unsigned int mode);
 
+	/** \brief Binds a vertex array object with the buffer layout as
+	 * generic vertex attributes (see VertexAttribute).
+	 *
+	 * The vertex array object is created on first use and requires
+	 * OpenGL 3.0. Quantized positions have to be transformed using
+	 * position_offset and position_scale by the vertex shader.
+	 */
+	void bindVertexArray();
+
 	unsigned int vbo_id;
+	unsigned int ibo_id;
+	unsigned int vao_id;
+
+	/// Location of the data in the shared buffers of the ShaderRenderer
+	/// (arena_id is 0 if not stored there)
+	unsigned int arena_id;
+	unsigned int arena_base_vertex;
+	unsigned int arena_first_index;
+
 	bool started;
 	bool smooth_shading;
 
+	/// Layout used for the next call of generate_vbo()
+	VertexFormat vertex_format;
+	/// Layout used for new meshes
+	static VertexFormat default_vertex_format;
+	/// Layout of the data currently stored in the vertex buffer
+	VertexFormat buffer_format;
+
+	ResidencyPolicy residency;
+	/// Policy used for new meshes
+	static ResidencyPolicy default_residency;
+	/// Whether vertices, normals, colors and indices are available
+	bool resident;
+	/// Where the mesh data came from (used by ResidencyReloadFromSource)
+	MeshSource source;
+
 	GLsizeiptr buffer_size;
+	unsigned int buffer_vertex_count;
+	unsigned int buffer_index_count;
+	GLsizeiptr stride;
 	GLsizeiptr normal_offset;
 	GLsizeiptr color_offset;
+	/// GL type of the normals in the buffer (0 if there are none)
+	unsigned int normal_type;
+	/// GL type of the colors in the buffer (0 if there are none)
+	unsigned int color_type;
+
+	/// Quantized positions are transformed by position_offset + position_scale * p
+	Vector3f position_offset;
+	float position_scale;
 	
 	Vector3f bbox_min;
 	Vector3f bbox_max;
 
-	std::vector<Vector4f> vertices;
+	std::vector<Vector3f> vertices;
 	std::vector<Vector3f> normals;
 	std::vector<Vector4f> colors;
 
+	/// Triangle indices into the vertex arrays (empty for non-indexed meshes)
+	std::vector<unsigned int> indices;
+
+	/// Simplified versions of this mesh, ordered from fine to coarse (owned)
+	std::vector<MeshVBO*> lods;
+	/// Geometric error of this mesh relative to the bounding box diagonal
+	/// of the original mesh (0 for the original mesh)
+	float lod_error;
+
 	void join (const Matrix44f &transformation, const MeshVBO &other);
 	void transform(const Matrix44f &transformation);
 	void setColor(const Vector4f &color);
 	void center ();
 	bool loadOBJ (const char* filename, const char* object_name = NULL, bool strict = false);
+
+	/** \brief Merges identical vertices and creates the index buffer.
+	 *
+	 * The order of the triangles is not altered.
+	 */
+	void weld();
+
+	/** \brief Reorders triangles and vertices for better GPU cache usage.
+	 *
+	 * The triangles are reordered using Tipsify (Sander et al., "Fast
+	 * Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007)
+	 * for the post-transform vertex cache. If reduce_overdraw is set, the
+	 * resulting triangle clusters are sorted such that outward facing
+	 * clusters are drawn first. Afterwards the vertices are sorted by their
+	 * first use to improve vertex fetch locality.
+	 *
+	 * Meshes without indices are welded first.
+	 */
+	void optimize (unsigned int cache_size = 16, bool reduce_overdraw = true);
+
+	/// Average cache miss ratio (misses per triangle) for a FIFO vertex cache
+	float calcACMR (unsigned int cache_size = 16) const;
+
+	/** \brief Creates a simplified mesh using quadric error edge collapses.
+	 *
+	 * Vertices are merged by position, i.e. the simplified mesh has smooth
+	 * normals. If error is not NULL it receives the geometric error of
+	 * the simplified mesh (in mesh units).
+	 */
+	MeshVBO simplify (unsigned int target_triangle_count, float *error = NULL) const;
+
+	/** \brief Creates a chain of up to level_count simplified meshes.
+	 *
+	 * Each level has about reduction times the triangles of the previous
+	 * level. Generation stops early once a mesh cannot be simplified
+	 * any further.
+	 */
+	void generateLODs (unsigned int level_count, float reduction = 0.5f);
+	void clearLODs();
+
+	/** \brief Returns the coarsest level whose error is below
+	 * max_pixel_error when the bounding box diagonal of the mesh covers
+	 * projected_size pixels.
+	 */
+	MeshVBO* selectLOD (float projected_size, float max_pixel_error = 1.f);
 };
 
 MeshVBO CreateUVSphere (unsigned int rows, unsigned int segments);
@@ -24,6 +24,9 @@
 #include "ForcesTorques.h"
 #include "Scene.h"
 #include "Scripting.h"
+#include "ShadowMap.h"
+#include "CurveBuilder.h"
+#include "Profiler.h"
 
 #include <assert.h>
 #include <iostream>
@@ -36,9 +39,9 @@
 #include <unistd.h>
 
 #include "json/json.h"
-#include "colorscale.h"
 
-#include "QVideoEncoder.h"
+#include "VideoExporter.h"
+#include "ImageSeriesWriter.h"
 
 #include "Model.h"
 
@@ -55,6 +58,7 @@ MeshupApp::MeshupApp(QWidget *parent)
 
 	selected_cam = NULL;
 	scene = new Scene;
+	L = NULL;
 
 	//setting up the socket pair for signal handling
 	if (!::socketpair(AF_UNIX, SOCK_STREAM,0,sigusr1Fd)) {
@@ -75,10 +79,15 @@ MeshupApp::MeshupApp(QWidget *parent)
 	//  its just an initialization of the memory with something
 	//  that makes sense
 	glRefreshTime=20; 
+	scriptRefreshTime=100;
 
 	sceneRefreshTimer = new QTimer (this);
-	sceneRefreshTimer->setSingleShot(false);
+	sceneRefreshTimer->setSingleShot(true);
+	scriptUpdateTimer = new QTimer (this);
+	scriptUpdateTimer->setSingleShot(false);
+	curveUpdateTimer = new QTimer (this);
 	updateTime.start();
+	lastDrawTime.start();
 
 	timeLine = new QTimeLine (TimeLineDuration, this);
 	timeLine->setCurveShape(QTimeLine::LinearCurve);
@@ -134,8 +143,11 @@ MeshupApp::MeshupApp(QWidget *parent)
 	dockPlayerControls->setVisible(true);
 	dockViewSettings->setVisible(false);
 
-	// the sceneRefreshTimer is used to continously redraw the OpenGL widget
+	// the scene is only redrawn if something changed (see requestRedraw()),
+	// the sceneRefreshTimer merges all requests within glRefreshTime
 	connect (sceneRefreshTimer, SIGNAL(timeout()), this , SLOT(drawScene()));
+	connect (scriptUpdateTimer, SIGNAL(timeout()), this , SLOT(updateScript()));
+	connect (curveUpdateTimer, SIGNAL(timeout()), this , SLOT(update_curves()));
 
 	//camera interaction
 	connect (listWidgetCameraList, SIGNAL(itemClicked(QListWidgetItem*)), this, SLOT(select_camera(QListWidgetItem*)));
@@ -190,6 +202,7 @@ MeshupApp::MeshupApp(QWidget *parent)
 	connect (actionReloadFiles, SIGNAL ( triggered() ), this, SLOT(action_reload_files()));
 
 	connect (glWidget, SIGNAL (camera_changed()), this, SLOT (camera_changed()));	
+	connect (glWidget, SIGNAL (redraw_requested()), this, SLOT (requestRedraw()));
 	connect (glWidget, SIGNAL (toggle_camera_fix(bool)), this, SLOT (toggle_camera_fix(bool)));	
 	connect (glWidget, SIGNAL (start_draw()), this, SLOT (update_camera()));
 	connect (lineEditCameraEye, SIGNAL (editingFinished()), this, SLOT (set_camera_pos()));
@@ -201,7 +214,7 @@ MeshupApp::MeshupApp(QWidget *parent)
 
 	loadSettings();
 	
-	sceneRefreshTimer->start(glRefreshTime);
+	requestRedraw();
 }
 
 void MeshupApp::opengl_initialized () {
@@ -210,15 +223,44 @@ void MeshupApp::opengl_initialized () {
 	parseArguments (main_argc, main_argv);
 }
 
+void MeshupApp::requestRedraw () {
+	if (sceneRefreshTimer->isActive())
+		return;
+
+	// draw right away unless the last frame was drawn less than
+	// glRefreshTime ago
+	int elapsed = lastDrawTime.elapsed();
+	sceneRefreshTimer->start (elapsed < glRefreshTime ? glRefreshTime - elapsed : 0);
+}
+
+void MeshupApp::updateScript () {
+	// the script was already updated for a frame that was drawn recently
+	if (!L || updateTime.elapsed() < scriptRefreshTime)
+		return;
+
+	ProfileScope profile_scope (ProfilePhaseScriptUpdate);
+	scripting_update (L, 1.0e-3f * static_cast<float>(updateTime.restart()) );
+}
+
 void MeshupApp::drawScene () {
-	if (L)
+	profiler.beginFrame();
+
+	if (L) {
+		ProfileScope profile_scope (ProfilePhaseScriptUpdate);
 		scripting_update (L, 1.0e-3f * static_cast<float>(updateTime.restart()) );
+	}
+
+	lastDrawTime.restart();
 
 	scene->setCurrentTime(scene->current_time);
 	glWidget->updateGL();
 
-	if (L)
+	if (L) {
+		ProfileScope profile_scope (ProfilePhaseScriptUpdate);
 		scripting_draw (L);
+	}
+
+	profiler.endFrame();
 }
 
 void MeshupApp::loadModel(const char* filename) {
@@ -234,6 +276,8 @@ void MeshupApp::loadModel(const char* filename) {
 	model->updateSegments();
 	
 	scene->models.push_back (model);
+
+	requestRedraw();
 }
 
 void MeshupApp::loadAnimation(const char* filename) {
@@ -263,7 +307,9 @@ void MeshupApp::loadAnimation(const char* filename) {
 	UpdateModelFromAnimation (scene->models[i], scene->animations[i], scene->current_time);
 	animation_speed_changed(spinBoxSpeed->value());
 
- 	initialize_curves(); 
+	initialize_model_curves (i);
+
+	requestRedraw();
 }
 
 void MeshupApp::loadForcesAndTorques(const char* filename) {
@@ -294,6 +340,8 @@ void MeshupApp::loadForcesAndTorques(const char* filename) {
 		checkBoxDrawTorques->setChecked(glWidget->draw_torques);
 	 }
 	 scene->forcesTorquesQueue.push_back (forcesTorques);
+
+	requestRedraw();
 }
 
 void MeshupApp::loadCamera(const char* filename) {
@@ -306,6 +354,7 @@ void MeshupApp::loadCamera(const char* filename) {
 void MeshupApp::setAnimationFraction (float fraction, bool editingTime) {
 	float set_time = fraction * scene->longest_animation;
 	scene->setCurrentTime(set_time);
+	requestRedraw();
 	if (selected_cam != NULL && !playerPaused && editingTime) {
 		CameraPosition* campos = selected_cam->camera_data;
 		int row = cam_operator->setCameraPosTime(campos, set_time);
@@ -322,6 +371,21 @@ void print_usage() {
 		<< "				 for examples and documentation. Note that any re-" << endl
 		<< "				 maining arguments will be sent to the meshup.load(args)" << endl
 		<< "				 script function." << endl
+		<< "--mesh-residency MODE	 what happens to the CPU copy of mesh data after" << endl
+		<< "				 uploading it to the GPU: keep (default), drop, or" << endl
+		<< "				 reload (re-read from the mesh file when needed)." << endl
+		<< "--fixed-function	 draw meshes using the fixed function pipeline" << endl
+		<< "				 instead of GLSL shaders." << endl
+		<< "--shadow-map-size N	 resolution of each shadow map cascade (default" << endl
+		<< "				 2048, at most 4096)." << endl
+		<< "--shadow-cascades N	 number of shadow map cascades that split the view" << endl
+		<< "				 (1 to 4, default 1). The fixed function pipeline" << endl
+		<< "				 only uses one." << endl
+		<< "--profile		 measure the time spent in the parts of each frame" << endl
+		<< "				 and show the averages on top of the scene (see" << endl
+		<< "				 also meshup.getProfile() in doc/scripting/)." << endl
+		<< "--render OUTPUT		 render the animations to images or a video without" << endl
+		<< "				 opening a window (see meshup --render --help)." << endl
 		<< endl
 		<< "Report bugs to <martin.felis@iwr.uni-heidelberg.de>" << endl;
 }
@@ -329,6 +393,24 @@ void print_usage() {
 void MeshupApp::parseArguments (int argc, char* argv[]) {
 	string scripting_file = "";
 
+	// the residency has to be known before the first model gets loaded
+	for (int i = 1; i < argc - 1; i++) {
+		if (string(argv[i]) != "--mesh-residency")
+			continue;
+
+		string mode = argv[i + 1];
+		if (mode == "keep") {
+			MeshVBO::default_residency = MeshVBO::ResidencyKeep;
+		} else if (mode == "drop") {
+			MeshVBO::default_residency = MeshVBO::ResidencyDropAfterUpload;
+		} else if (mode == "reload") {
+			MeshVBO::default_residency = MeshVBO::ResidencyReloadFromSource;
+		} else {
+			cerr << "Error: invalid mesh residency '" << mode << "'! Must be keep, drop or reload." << endl;
+			abort();
+		}
+	}
+
 	for (int i = 1; i < argc; i++) {
 
 		// check if diplaying help was part of input
@@ -344,8 +426,31 @@ void MeshupApp::parseArguments (int argc, char* argv[]) {
 		if (arg.find (".") != std::string::npos) 
 			arg_extension = arg.substr (arg.rfind(".") + 1);
 
+		if (arg == "--mesh-residency") {
+			// already handled above
+			i++;
+
+		} else if (arg == "--fixed-function") {
+			glWidget->use_shader_renderer = false;
+
+		} else if (arg == "--profile") {
+			profiler.setEnabled (true);
+			profiler.show_overlay = true;
+
+		} else if (arg == "--shadow-map-size" || arg == "--shadow-cascades") {
+			i++;
+			if (i == argc || atoi (argv[i]) <= 0) {
+				cerr << "Error: " << arg << " requires a positive number!" << endl;
+				abort();
+			}
+
+			if (arg == "--shadow-map-size")
+				glWidget->shadow_map->size = min (atoi (argv[i]), static_cast<int>(ShadowMap::MaxSize));
+			else
+				glWidget->shadow_map->cascade_count = min (atoi (argv[i]), static_cast<int>(ShadowMap::MaxCascades));
+
 		// check if there is a scripting file included
-		if (arg == "-s" || arg == "--script") {
+		} else if (arg == "-s" || arg == "--script") {
 			i++;
 			if (i == argc) {
 				cerr << "Error: no scripting file provided!" << endl;
@@ -395,10 +500,16 @@ void MeshupApp::parseArguments (int argc, char* argv[]) {
 			}
 		}
 		scripting_load (L, argc - script_args_start, &argv[script_args_start]);
+
+		// meshup.update() is also called while nothing is drawn
+		scriptUpdateTimer->start (scriptRefreshTime);
 	}
+
+	requestRedraw();
 }
 
 void MeshupApp::closeEvent (QCloseEvent *event) {
+	cancel_curves();
 	saveSettings();
 }
 
@@ -433,6 +544,7 @@ void MeshupApp::saveSettings () {
 	settings_json["configuration"]["window"]["xpos"] = x();
 	settings_json["configuration"]["window"]["ypos"] = y();
 	settings_json["configuration"]["window"]["glRefreshTime"] = glRefreshTime;
+	settings_json["configuration"]["window"]["scriptRefreshTime"] = scriptRefreshTime;
 
 	settings_json["configuration"]["render"]["width"]  = renderImageSeriesDialog->WidthSpinBox->value();
 	settings_json["configuration"]["render"]["height"] = renderImageSeriesDialog->HeightSpinBox->value();
@@ -442,6 +554,18 @@ void MeshupApp::saveSettings () {
 	settings_json["configuration"]["render"]["frame_count_mode"] = renderImageSeriesDialog->frameCountModeRadioButton->isChecked();
 	settings_json["configuration"]["render"]["composite"]		= renderImageSeriesDialog->compositeBox->isChecked();
 	settings_json["configuration"]["render"]["transparent"]	 = renderImageSeriesDialog->transparentBackgroundCheckBox->isChecked();
+	settings_json["configuration"]["render"]["format"]		   = image_file_format_name (renderImageSeriesDialog->imageFormat());
+
+	QVideoEncoderSettings video_settings = renderVideoDialog->encoderSettings();
+	settings_json["configuration"]["video"]["codec"]       = video_codec_name (video_settings.codec);
+	settings_json["configuration"]["video"]["crf"]         = video_settings.crf;
+	settings_json["configuration"]["video"]["bitrate"]     = video_settings.bitrate;
+	settings_json["configuration"]["video"]["gop"]         = video_settings.gop;
+	settings_json["configuration"]["video"]["b_frames"]    = video_settings.bframes;
+	settings_json["configuration"]["video"]["threads"]     = video_settings.threads;
+	settings_json["configuration"]["video"]["thread_type"] = video_thread_type_name (video_settings.thread_type);
+	settings_json["configuration"]["video"]["scaler"]      = video_scaler_name (video_settings.scaler);
+	settings_json["configuration"]["video"]["gpu_conversion"] = renderVideoDialog->gpuConversion();
 
 	string home_dir = getenv("HOME");
 
@@ -515,6 +639,21 @@ void MeshupApp::loadSettings () {
 	renderImageSeriesDialog->frameCountModeRadioButton->setChecked(settings_json["configuration"]["render"].get("frame_count_mode", false).asBool());
 	renderImageSeriesDialog->compositeBox->setChecked(settings_json["configuration"]["render"].get("composite", false).asBool());
 	renderImageSeriesDialog->transparentBackgroundCheckBox->setChecked(settings_json["configuration"]["render"].get("transparent", true).asBool());
+	ImageFileFormat image_format = ImageFilePNG;
+	parse_image_file_format (settings_json["configuration"]["render"].get("format", "png").asString(), image_format);
+	renderImageSeriesDialog->setImageFormat (image_format);
+
+	QVideoEncoderSettings video_settings;
+	parse_video_codec (settings_json["configuration"]["video"].get("codec", video_codec_name (video_settings.codec)).asString(), video_settings.codec);
+	video_settings.crf = settings_json["configuration"]["video"].get("crf", video_settings.crf).asInt();
+	video_settings.bitrate = settings_json["configuration"]["video"].get("bitrate", video_settings.bitrate).asUInt();
+	video_settings.gop = settings_json["configuration"]["video"].get("gop", video_settings.gop).asUInt();
+	video_settings.bframes = settings_json["configuration"]["video"].get("b_frames", video_settings.bframes).asUInt();
+	video_settings.threads = settings_json["configuration"]["video"].get("threads", video_settings.threads).asUInt();
+	parse_video_thread_type (settings_json["configuration"]["video"].get("thread_type", video_thread_type_name (video_settings.thread_type)).asString(), video_settings.thread_type);
+	parse_video_scaler (settings_json["configuration"]["video"].get("scaler", video_scaler_name (video_settings.scaler)).asString(), video_settings.scaler);
+	renderVideoDialog->setEncoderSettings (video_settings);
+	renderVideoDialog->setGpuConversion (settings_json["configuration"]["video"].get("gpu_conversion", false).asBool());
 
 	int x, y, w, h;
 
@@ -523,6 +662,7 @@ void MeshupApp::loadSettings () {
 	w = settings_json["configuration"]["window"].get("width", 650).asInt();
 	h = settings_json["configuration"]["window"].get("height", 650).asInt();
 	glRefreshTime = settings_json["configuration"]["window"].get("glRefreshTime", 20).asInt();
+	scriptRefreshTime = settings_json["configuration"]["window"].get("scriptRefreshTime", 100).asInt();
 
 	setGeometry (x, y, w, h);
 	camera_changed();
@@ -552,6 +692,8 @@ void MeshupApp::camera_changed() {
 	lineEditLightPos->setText(light_stream.str().c_str());
 	checkBoxCameraFixed->setChecked(fixed);
 
+	requestRedraw();
+
 	if (selected_cam != NULL) {
 		movingCameraCheckBox->setDisabled(false);
 		deleteCameraButton->setDisabled(false);
@@ -779,6 +921,7 @@ void MeshupApp::action_reload_files() {
 }
 
 void MeshupApp::action_quit () {
+	cancel_curves();
 	saveSettings();
 	qApp->quit();
 }
@@ -794,61 +937,62 @@ void MeshupApp::animation_loaded() {
 	for (unsigned int i = 0; i < scene->animations.size(); i++) {
 		UpdateModelFromAnimation (scene->models[i], scene->animations[i], scene->current_time);
 	}
+
+	requestRedraw();
 }
 
 void MeshupApp::initialize_curves() {
-	float curve_frame_rate = 100.f;
-
-	float old_time = scene->current_time;
+	for (unsigned int i = 0; i < scene->models.size(); i++) {
+		initialize_model_curves (i);
+	}
+}
 
-	// qDebug() << "duration = " << scientific << duration << endl;
-	// cout << "time_step = " << scientific << time_step << endl;
+/** \brief Starts computing the curves of a model in the background
+ *
+ * The curves are refined progressively, update_curves() applies the
+ * intermediate results.
+ */
+void MeshupApp::initialize_model_curves (unsigned int model_index) {
+	while (curve_builders.size() <= model_index) {
+		curve_builders.push_back (new CurveBuilder());
+	}
 
-	for (unsigned int i = 0; i < scene->models.size(); i++) {
-		scene->models[i]->clearCurves();
+	if (model_index < scene->animations.size()) {
+		curve_builders[model_index]->start (*scene->models[model_index], *scene->animations[model_index]);
+	} else {
+		curve_builders[model_index]->cancel();
+		scene->models[model_index]->clearCurves();
 	}
 
-	for (unsigned int i = 0; i < scene->animations.size(); i++) {
-		float current_time = 0.f;
-		float duration = scene->animations[i]->duration;
-		int curvepointcount = ceil(duration * curve_frame_rate);
-		float time_step = duration / curvepointcount;
-
-		while (1) {
-			float fraction = current_time / duration * 2.f - 1.f;
-
-			UpdateModelFromAnimation (scene->models[i], scene->animations[i], current_time);
-			scene->models[i]->updateFrames();
-			MeshupModel::FrameMap::iterator frame_iter = scene->models[i]->framemap.begin();
-
-			for (frame_iter; frame_iter != scene->models[i]->framemap.end(); frame_iter++) {
-				Matrix44f pose_matrix = frame_iter->second->pose_transform;
-				Vector3f pose_translation (
-						pose_matrix (3,0),
-						pose_matrix (3,1),
-						pose_matrix (3,2)
-						);
-
-				scene->models[i]->addCurvePoint (frame_iter->first,
-						pose_translation,
-						Vector3f (
-							colorscale::red(fraction),
-							colorscale::green(fraction),
-							colorscale::blue(fraction))
-						);
-			}
+	if (!curveUpdateTimer->isActive())
+		curveUpdateTimer->start (glRefreshTime);
+}
 
-			if (current_time == duration)
-				break;
+void MeshupApp::update_curves() {
+	bool curves_changed = false;
+	bool curves_finished = true;
 
-			current_time += time_step;
-			if (current_time > duration)
-				current_time = duration;
-		}
+	for (unsigned int i = 0; i < curve_builders.size() && i < scene->models.size(); i++) {
+		if (curve_builders[i]->update (*scene->models[i]))
+			curves_changed = true;
+
+		if (!curve_builders[i]->finished())
+			curves_finished = false;
 	}
 
-	scene->current_time = old_time;
-	// qDebug() << "initializing curves done";
+	if (curves_finished)
+		curveUpdateTimer->stop();
+
+	if (curves_changed)
+		requestRedraw();
+}
+
+void MeshupApp::cancel_curves() {
+	curveUpdateTimer->stop();
+
+	for (unsigned int i = 0; i < curve_builders.size(); i++) {
+		curve_builders[i]->cancel();
+	}
 }
 
 /** \brief Modifies the widgets to show the current time
@@ -979,6 +1123,8 @@ void MeshupApp::actionRenderSeriesAndSaveToFile () {
 
 	doComposite = renderImageSeriesDialog->compositeBox->isChecked();
 	render_transparent = renderImageSeriesDialog->transparentBackgroundCheckBox->isChecked();
+	ImageFileFormat image_format = renderImageSeriesDialog->imageFormat();
+	string extension = image_file_extension (image_format);
 	
 	string figure_name = string("./image-series") ;
 	stringstream filename_stream;
@@ -986,7 +1132,7 @@ void MeshupApp::actionRenderSeriesAndSaveToFile () {
 	int series_nr=0;
 	while (true) {
 		filename_stream.str("");
-		filename_stream << figure_name << "_" << setw(3) << setfill('0') << series_nr << "-0000.png";
+		filename_stream << figure_name << "_" << setw(3) << setfill('0') << series_nr << "-0000" << extension;
 		if (!QFile (filename_stream.str().c_str()).exists()) 
 			break;
 		series_nr++;
@@ -1010,40 +1156,68 @@ void MeshupApp::actionRenderSeriesAndSaveToFile () {
 	pbar.setMinimumDuration(0);
 
 	stringstream overlayFilename;
-	overlayFilename << figure_name << "_" << setw(3) << setfill('0') << series_nr << "-overlay.png";
+	overlayFilename << figure_name << "_" << setw(3) << setfill('0') << series_nr << "-overlay" << extension;
+
+	// the images are compressed and written by a pool of threads, the
+	// overlay is summed up in memory and written at the end
+	ImageSeriesWriter writer;
+	writer.open (width, height, render_transparent, image_format, doComposite);
+
+	OffscreenFramebuffer &framebuffer = glWidget->offscreen_framebuffer;
+	int written_count = 0;
 
 	for(int i = 0; i < image_count; i++) {
 		pbar.setValue(i);
 
-		float current_time = (float) i * timestep;
+		// the oldest frame was transferred while the later ones were drawn
+		if (framebuffer.isFull()) {
+			filename_stream.str("");
+			filename_stream << figure_name << "_" << setw(3) << setfill('0') << series_nr << "-" << setw(4) << setfill('0') << written_count++ << extension;
+			if (!writeOffscreenFrame (writer, filename_stream.str()))
+				break;
+		}
 
-		filename_stream.str("");
-		filename_stream << figure_name << "_" << setw(3) << setfill('0') << series_nr << "-" << setw(4) << setfill('0') << i << ".png";
+		float current_time = (float) i * timestep;
 		scene->setCurrentTime (current_time);
-		QImage image = glWidget->renderContentOffscreen (width, height, render_transparent);
-		image.save (filename_stream.str().c_str(), 0, -1);
-
-		if (doComposite) {
-			string cmd("composite -compose plus ");
-			if (i==0) {
-				cmd="cp "+filename_stream.str()+" "+overlayFilename.str();
-			} else {
-				cmd="composite -compose plus "+filename_stream.str()+" "+overlayFilename.str()+" "+overlayFilename.str();
-			}
-			if (system(cmd.c_str()) == -1) {
-				cerr << "Error occured when running command:" << endl;
-				cerr << "  " << cmd << endl;
-				abort();
-			}
+
+		if (!glWidget->renderOffscreenFrame (width, height, render_transparent)) {
+			cerr << "Error: could not render image " << i << "!" << endl;
+			break;
 		}
+
 		if (pbar.wasCanceled()) {
 			qDebug() << "canceled!";
-			return;
+			break;
 		}
 	}
+
+	while (framebuffer.pending_count > 0) {
+		filename_stream.str("");
+		filename_stream << figure_name << "_" << setw(3) << setfill('0') << series_nr << "-" << setw(4) << setfill('0') << written_count++ << extension;
+		if (!writeOffscreenFrame (writer, filename_stream.str()))
+			break;
+	}
+
+	// frames that were not read after an error
+	framebuffer.discardPending();
+
+	if (!writer.close (overlayFilename.str(), image_format))
+		cerr << "Error: could not write the image series!" << endl;
+
 	pbar.setValue(image_count);
 }
 
+bool MeshupApp::writeOffscreenFrame (ImageSeriesWriter &writer, const std::string &filename) {
+	unsigned char *bgra_pixels = writer.acquirePixels();
+	if (bgra_pixels == NULL)
+		return false;
+
+	if (!glWidget->readOffscreenFrame (bgra_pixels))
+		return false;
+
+	return writer.submitPixels (bgra_pixels, filename);
+}
+
 void MeshupApp::actionRenderVideoAndSaveToFile () {
 	unsigned width;
 	unsigned height;
@@ -1071,31 +1245,73 @@ void MeshupApp::actionRenderVideoAndSaveToFile () {
 	QProgressDialog pbar("Rendering offscreen", "Abort Render", 0, frame_count, this);
 	pbar.setWindowModality(Qt::WindowModal);
 	pbar.setMinimumDuration(0);
-	QVideoEncoder encoder;
-	encoder.createFile(filename, width, height, fps);
-	stringstream filename_stream;
-	QImage image;
+
+	OffscreenFramebuffer &framebuffer = glWidget->offscreen_framebuffer;
+
+	bool gpu_conversion = renderVideoDialog->gpuConversion();
+	glWidget->makeCurrent();
+	if (gpu_conversion && !framebuffer.init (width, height, false, true)) {
+		cerr << "Warning: converting the video frames on the CPU instead." << endl;
+		gpu_conversion = false;
+	}
+
+	// rendering, readback, color conversion and encoding of successive
+	// frames run at the same time
+	VideoExporter exporter;
+	exporter.pixel_format = gpu_conversion ? VideoExporter::PixelFormatYUV420 : VideoExporter::PixelFormatBGRA;
+	if (!exporter.open (filename.toStdString(), width, height, fps, renderVideoDialog->encoderSettings())) {
+		cerr << "Error: could not create video " << filename.toStdString() << "!" << endl;
+		return;
+	}
 
 	for(int i = 0; i <= frame_count; i++) {
 		pbar.setValue(i);
 
+		// hands the older frames to the exporter, which reads them directly
+		// from the mapped pixel buffers
+		glWidget->makeCurrent();
+		if (!exporter.reserveFrame (framebuffer))
+			break;
+
 		float current_time = (float) i * timestep;
 		scene->setCurrentTime (current_time);
 
-		image = glWidget->renderContentOffscreen (width, height, false);
-		encoder.encodeImage(image);
+		if (!glWidget->renderOffscreenFrame (width, height, false, gpu_conversion)) {
+			cerr << "Error: could not render frame " << i << "!" << endl;
+			break;
+		}
 
 		if (pbar.wasCanceled()) {
 			qDebug() << "canceled!";
-			return;
+			break;
 		}
 	}
+
+	// also unmaps the buffers of frames that were not read after an error
+	glWidget->makeCurrent();
+	exporter.finishFrames (framebuffer);
+
 	pbar.setValue(frame_count);
-	for(int i=0;i<7;i++) {
-		encoder.encodeImage(image);
-	}
 
-	encoder.close();
+	// also writes the frames delayed by the encoder
+	if (!exporter.close())
+		cerr << "Error: could not write video " << filename.toStdString() << "!" << endl;
+}
+
+QVideoEncoderSettings MeshupApp::videoEncoderSettings () {
+	return renderVideoDialog->encoderSettings();
+}
+
+void MeshupApp::setVideoEncoderSettings (const QVideoEncoderSettings &settings) {
+	renderVideoDialog->setEncoderSettings (settings);
+}
+
+bool MeshupApp::videoGpuConversion () {
+	return renderVideoDialog->gpuConversion();
+}
+
+void MeshupApp::setVideoGpuConversion (bool gpu_conversion) {
+	renderVideoDialog->setGpuConversion (gpu_conversion);
 }
 
 void MeshupApp::actionCameraMovementSaveToFile() {
@@ -27,6 +27,8 @@ extern "C" {
 }
 
 struct Scene;
+struct CurveBuilder;
+struct ImageSeriesWriter;
 
 class MeshupApp : public QMainWindow, public Ui::MainWindow
 {
@@ -59,14 +61,27 @@ public:
 		
 protected:
 		unsigned int AnimationFrameCount;
+		/// Time since meshup.update() was called
 		QTime updateTime;
+		QTime lastDrawTime;
+		/// Draws the scene once after a redraw was requested
 		QTimer *sceneRefreshTimer;
+		/// Calls meshup.update() while no frames are drawn
+		QTimer *scriptUpdateTimer;
+		/// Polls the curve_builders while curves are computed
+		QTimer *curveUpdateTimer;
 		QTimeLine *timeLine;
 		QLabel *versionLabel;
 
+		/// Minimum time between two frames in milliseconds
 		int glRefreshTime;
+		/// Time between two calls of meshup.update() in milliseconds if
+		/// nothing is drawn
+		int scriptRefreshTime;
 
 		bool playerPaused;
+		/// Computes the curves of the model with the same index
+		std::vector<CurveBuilder*> curve_builders;
 		RenderImageDialog* renderImageDialog;
 		RenderImageSeriesDialog* renderImageSeriesDialog;
 		RenderVideoDialog* renderVideoDialog;
@@ -79,6 +94,10 @@ public slots:
 		void handleSIGUSR1();
 
 		void opengl_initialized();
+		/// Schedules drawing of the scene. Has to be called whenever
+		/// something changed that is visible.
+		void requestRedraw ();
+		void updateScript ();
 		void drawScene ();
 
 		void saveSettings ();
@@ -106,6 +125,9 @@ public slots:
 
 		void animation_loaded();
 		void initialize_curves();
+		void initialize_model_curves (unsigned int model_index);
+		void update_curves();
+		void cancel_curves();
 
 		void timeline_frame_changed (int frame_index);
 		void timeline_set_frame (int frame_index);
@@ -118,7 +140,18 @@ public slots:
 		void actionRenderVideoAndSaveToFile ();
 		void actionCameraMovementSaveToFile ();
 
+		/// Encoder settings of the video export, shown in the render video
+		/// dialog
+		QVideoEncoderSettings videoEncoderSettings ();
+		void setVideoEncoderSettings (const QVideoEncoderSettings &settings);
+		/// Whether the video frames are converted to YUV on the GPU
+		bool videoGpuConversion ();
+		void setVideoGpuConversion (bool gpu_conversion);
+
 	private:
+		/// Reads the oldest pending offscreen frame into the writer
+		bool writeOffscreenFrame (ImageSeriesWriter &writer, const std::string &filename);
+
 		static int sigusr1Fd[2];
 		QSocketNotifier *snUSR1;
 };
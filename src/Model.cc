@@ -22,6 +22,7 @@
 #include <fstream>
 #include <ostream>
 #include <stack>
+#include <sstream>
 #include <limits>
 
 #include <boost/filesystem.hpp>
@@ -35,6 +36,9 @@ extern "C"
 #include "luatables.h"
 
 #include "Curve.h"
+#include "Frustum.h"
+#include "Profiler.h"
+#include "LineBuffer.h"
 #include "Animation.h"
 
 using namespace std;
@@ -225,7 +229,8 @@ void MeshupModel::addSegment (
 		const Vector3f &translate,
 		const Quaternion &rotate,
 		const Vector3f &scale,
-		const Vector3f &mesh_center) {
+		const Vector3f &mesh_center,
+		const Matrix44f &mesh_transform) {
 	Segment segment;
 
 	// cout << "addSegment( " << frame_name << "," << endl
@@ -257,12 +262,36 @@ void MeshupModel::addSegment (
 	}
 
 	segment.mesh = mesh;
+	segment.mesh_transform = mesh_transform;
 	segment.meshcenter = configuration.axes_rotation.transpose() * mesh_center;
 	segment.frame = findFrame ((frame_name).c_str());
 	assert (segment.frame != NULL);
 	segments.push_back (segment);
 }
 
+MeshPtr MeshupModel::findMesh (const std::string &name) {
+	MeshMap::iterator mesh_iter = meshmap.find (name);
+
+	if (mesh_iter == meshmap.end())
+		return NULL;
+
+	return mesh_iter->second;
+}
+
+MeshPtr MeshupModel::addMesh (const std::string &name, MeshVBO &&mesh) {
+	MeshPtr result (new MeshVBO (std::move (mesh)));
+
+	if (optimize_meshes)
+		result->optimize();
+
+	if (!skip_vbo_generation)
+		result->generate_vbo();
+
+	meshmap[name] = result;
+
+	return result;
+}
+
 void MeshupModel::addCurvePoint (
 		const std::string &curve_name,
 		const Vector3f &coords,
@@ -315,6 +344,8 @@ void MeshupModel::resetPoses() {
 }
 
 void MeshupModel::updateFrames() {
+	ProfileScope profile_scope (ProfilePhaseUpdateFrames);
+
 	Matrix44f base_transform (Matrix44f::Identity());
 
 	// check whether the frame transformations are valid
@@ -327,10 +358,40 @@ void MeshupModel::updateFrames() {
 }
 
 void MeshupModel::updateSegments() {
+	ProfileScope profile_scope (ProfilePhaseUpdateSegments);
+
 	MeshupModel::SegmentList::iterator seg_iter = segments.begin();
 
+	Vector3f model_bbox_min (0.f, 0.f, 0.f);
+	Vector3f model_bbox_max (0.f, 0.f, 0.f);
+
 	while (seg_iter != segments.end()) {
-		Vector3f bbox_size (seg_iter->mesh->bbox_max - seg_iter->mesh->bbox_min);
+		// bounding box of the mesh after applying the mesh transform
+		Vector3f bbox_min (seg_iter->mesh->bbox_min);
+		Vector3f bbox_max (seg_iter->mesh->bbox_max);
+
+		if (seg_iter->mesh_transform != Matrix44f::Identity(4,4)) {
+			Vector3f corner_min (seg_iter->mesh->bbox_min);
+			Vector3f corner_max (seg_iter->mesh->bbox_max);
+
+			for (unsigned int i = 0; i < 8; i++) {
+				Vector4f corner (
+						(i & 1) ? corner_max[0] : corner_min[0],
+						(i & 2) ? corner_max[1] : corner_min[1],
+						(i & 4) ? corner_max[2] : corner_min[2],
+						1.f);
+				Vector4f transformed = (corner.transpose() * seg_iter->mesh_transform).transpose();
+
+				for (unsigned int j = 0; j < 3; j++) {
+					if (i == 0 || transformed[j] < bbox_min[j])
+						bbox_min[j] = transformed[j];
+					if (i == 0 || transformed[j] > bbox_max[j])
+						bbox_max[j] = transformed[j];
+				}
+			}
+		}
+
+		Vector3f bbox_size (bbox_max - bbox_min);
 
 		Vector3f scale(1.0f,1.0f,1.0f) ;
 
@@ -348,7 +409,7 @@ void MeshupModel::updateSegments() {
 		Vector3f translate(0.0f,0.0f,0.0f);
 		//only translate with meshcenter if it is defined in json file
 		if (!isnan(seg_iter->meshcenter[0])) {
-				Vector3f center ( seg_iter->mesh->bbox_min + bbox_size * 0.5f);
+				Vector3f center ( bbox_min + bbox_size * 0.5f);
 				translate[0] = -center[0] * scale[0] + seg_iter->meshcenter[0];
 				translate[1] = -center[1] * scale[1] + seg_iter->meshcenter[1];
 				translate[2] = -center[2] * scale[2] + seg_iter->meshcenter[2];
@@ -357,13 +418,26 @@ void MeshupModel::updateSegments() {
 		
 		// we also have to apply the scaling after the transform:
 		seg_iter->gl_matrix = 
-			SimpleMath::GL::ScaleMat44 (scale[0], scale[1], scale[2])
+			seg_iter->mesh_transform
+			* SimpleMath::GL::ScaleMat44 (scale[0], scale[1], scale[2])
 			* seg_iter->rotate.toGLMatrix()
 			* SimpleMath::GL::TranslateMat44 (translate[0], translate[1], translate[2])
 			* seg_iter->frame->pose_transform;
 
+		transform_bounding_box (seg_iter->mesh->bbox_min, seg_iter->mesh->bbox_max, seg_iter->gl_matrix, seg_iter->bbox_min, seg_iter->bbox_max);
+
+		for (unsigned int i = 0; i < 3; i++) {
+			if (seg_iter == segments.begin() || seg_iter->bbox_min[i] < model_bbox_min[i])
+				model_bbox_min[i] = seg_iter->bbox_min[i];
+			if (seg_iter == segments.begin() || seg_iter->bbox_max[i] > model_bbox_max[i])
+				model_bbox_max[i] = seg_iter->bbox_max[i];
+		}
+
 		seg_iter++;
 	}
+
+	bbox_min = model_bbox_min;
+	bbox_max = model_bbox_max;
 }
 
 void MeshupModel::initDefaultFrameTransform() {
@@ -376,6 +450,34 @@ void MeshupModel::initDefaultFrameTransform() {
 	frames_initialized = true;
 }
 
+float calc_projected_mesh_size (
+		const Segment &segment,
+		const Matrix44f &modelview,
+		const Matrix44f &projection,
+		float viewport_height) {
+	const MeshVBO *mesh = segment.mesh;
+	Vector3f center = (mesh->bbox_min + mesh->bbox_max) * 0.5f;
+	float diagonal = (mesh->bbox_max - mesh->bbox_min).norm();
+
+	Matrix44f transformation = segment.gl_matrix * modelview;
+
+	// the rows of the transformation are the transformed axes
+	float scale = 0.f;
+	for (unsigned int i = 0; i < 3; i++) {
+		Vector3f axis (transformation(i,0), transformation(i,1), transformation(i,2));
+		scale = std::max (scale, axis.norm());
+	}
+
+	Vector4f eye_position = (Vector4f (center[0], center[1], center[2], 1.f).transpose() * transformation).transpose();
+	Vector4f clip_position = (eye_position.transpose() * projection).transpose();
+
+	// the camera is inside or close to the mesh
+	if (clip_position[3] <= 1.0e-6f)
+		return std::numeric_limits<float>::max();
+
+	return diagonal * scale * projection(1,1) * 0.5f * viewport_height / clip_position[3];
+}
+
 void MeshupModel::draw() {
 	// save current state of GL_NORMALIZE to properly restore the original
 	// state
@@ -383,9 +485,30 @@ void MeshupModel::draw() {
 	if (!normalize_enabled)
 		glEnable (GL_NORMALIZE);
 
+	// query the matrices once for the culling and LOD selection
+	Matrix44f modelview, projection;
+	GLint viewport[4];
+	glGetFloatv (GL_MODELVIEW_MATRIX, modelview.data());
+	glGetFloatv (GL_PROJECTION_MATRIX, projection.data());
+	glGetIntegerv (GL_VIEWPORT, viewport);
+
+	// skip segments outside of the view volume
+	Frustum frustum (modelview * projection);
+
+	if (!frustum.intersectsBox (bbox_min, bbox_max)) {
+		if (!normalize_enabled)
+			glDisable (GL_NORMALIZE);
+		return;
+	}
+
 	SegmentList::iterator seg_iter = segments.begin();
 
 	while (seg_iter != segments.end()) {
+		if (!frustum.intersectsBox (seg_iter->bbox_min, seg_iter->bbox_max)) {
+			seg_iter++;
+			continue;
+		}
+
 		glPushMatrix();
 
 		glMultMatrixf (seg_iter->gl_matrix.data());
@@ -393,7 +516,13 @@ void MeshupModel::draw() {
 		// drawing
 		glColor3f (seg_iter->color[0], seg_iter->color[1], seg_iter->color[2]);
 
-		seg_iter->mesh->draw(GL_TRIANGLES);
+		MeshVBO *mesh = seg_iter->mesh;
+		if (mesh->lods.size() != 0) {
+			float projected_size = calc_projected_mesh_size (*seg_iter, modelview, projection, viewport[3]);
+			mesh = mesh->selectLOD (projected_size, lod_pixel_error);
+		}
+
+		mesh->draw(GL_TRIANGLES);
 
 		glPopMatrix();
 
@@ -405,158 +534,77 @@ void MeshupModel::draw() {
 		glDisable (GL_NORMALIZE);
 }
 
-void MeshupModel::drawFrameAxes() {
-	// backup the depth test and line width values
-	bool depth_test_enabled = glIsEnabled (GL_DEPTH_TEST);
-	if (depth_test_enabled)
-		glDisable (GL_DEPTH_TEST);
+/** \brief Adds the x, y and z axes (red, green, blue) of the
+ * transformation. */
+static void add_axes (LineBuffer &lines, const Matrix44f &transform, float length) {
+	Vector3f origin (transform(3,0), transform(3,1), transform(3,2));
 
-	bool light_enabled = glIsEnabled (GL_LIGHTING);
-	if (light_enabled)
-		glDisable (GL_LIGHTING);
+	// the rows of the transformation are the transformed axes
+	for (unsigned int i = 0; i < 3; i++) {
+		Vector3f axis (transform(i,0), transform(i,1), transform(i,2));
+		Vector3f color (0.f, 0.f, 0.f);
+		color[i] = 1.f;
 
-	float line_width;
-	glGetFloatv (GL_LINE_WIDTH, &line_width);
+		lines.addLine (origin, origin + axis * length, color);
+	}
+}
 
-	glLineWidth (2.f);
+static Vector3f transform_point (const Vector3f &point, const Matrix44f &transform) {
+	Vector4f result = (Vector4f (point[0], point[1], point[2], 1.f).transpose() * transform).transpose();
+	return Vector3f (result[0], result[1], result[2]);
+}
 
+void MeshupModel::addFrameAxes (LineBuffer &lines, const Matrix44f &transform) {
 	// for the rotation of the axes
 	Matrix44f axes_rotation_matrix (Matrix44f::Identity());
 	axes_rotation_matrix.block<3,3> (0,0) = configuration.axes_rotation;
 
+	lines.setLineWidth (2.f);
+
 	FrameMap::iterator frame_iter = framemap.begin();
 
 	while (frame_iter != framemap.end()) {
-		if (frame_iter->second->name == "ROOT") {
-			frame_iter++;
-			continue;
-		}
-		glPushMatrix();
-
-		Matrix44f transform_matrix = axes_rotation_matrix * frame_iter->second->pose_transform;
-		glMultMatrixf (transform_matrix.data());
-
-		glBegin (GL_LINES);
-		glColor3f (1.f, 0.f, 0.f);
-		glVertex3f (0.f, 0.f, 0.f);
-		glVertex3f (0.1f, 0.f, 0.f);
-		glColor3f (0.f, 1.f, 0.f);
-		glVertex3f (0.f, 0.f, 0.f);
-		glVertex3f (0.f, 0.1f, 0.f);
-		glColor3f (0.f, 0.f, 1.f);
-		glVertex3f (0.f, 0.f, 0.f);
-		glVertex3f (0.f, 0.f, 0.1f);
-		glEnd();
-
-		glPopMatrix();
+		if (frame_iter->second->name != "ROOT")
+			add_axes (lines, axes_rotation_matrix * frame_iter->second->pose_transform * transform, 0.1f);
 
 		frame_iter++;
 	}
-
-	if (depth_test_enabled)
-		glEnable (GL_DEPTH_TEST);
-
-	if (light_enabled)
-		glEnable (GL_LIGHTING);
-
-	glLineWidth (line_width);
 }
 
-void MeshupModel::drawBaseFrameAxes() {
-	// backup the depth test and line width values
-	bool depth_test_enabled = glIsEnabled (GL_DEPTH_TEST);
-	if (depth_test_enabled)
-		glDisable (GL_DEPTH_TEST);
-
-	bool light_enabled = glIsEnabled (GL_LIGHTING);
-	if (light_enabled)
-		glDisable (GL_LIGHTING);
-
-	float line_width;
-	glGetFloatv (GL_LINE_WIDTH, &line_width);
-
-	glLineWidth (2.f);
-
+void MeshupModel::addBaseFrameAxes (LineBuffer &lines, const Matrix44f &transform) {
 	// for the rotation of the axes
 	Matrix44f axes_rotation_matrix (Matrix44f::Identity());
 	axes_rotation_matrix.block<3,3> (0,0) = configuration.axes_rotation;
 
-	glPushMatrix();
-
-	Matrix44f transform_matrix = axes_rotation_matrix * framemap["ROOT"]->pose_transform;
-	glMultMatrixf (transform_matrix.data());
-
-	glBegin (GL_LINES);
-	glColor3f (1.f, 0.f, 0.f);
-	glVertex3f (0.f, 0.f, 0.f);
-	glVertex3f (1.f, 0.f, 0.f);
-	glColor3f (0.f, 1.f, 0.f);
-	glVertex3f (0.f, 0.f, 0.f);
-	glVertex3f (0.f, 1.f, 0.f);
-	glColor3f (0.f, 0.f, 1.f);
-	glVertex3f (0.f, 0.f, 0.f);
-	glVertex3f (0.f, 0.f, 1.f);
-	glEnd();
+	lines.setLineWidth (2.f);
 
-	glPopMatrix();
-
-	if (depth_test_enabled)
-		glEnable (GL_DEPTH_TEST);
-
-	if (light_enabled)
-		glEnable (GL_LIGHTING);
-
-	glLineWidth (line_width);
-}
-
-void MeshupModel::drawCurves() {
-	CurveMap::iterator curve_iter = curvemap.begin();
-	while (curve_iter != curvemap.end()) {
-		curve_iter->second->draw();
-		curve_iter++;
-	}
+	add_axes (lines, axes_rotation_matrix * framemap["ROOT"]->pose_transform * transform, 1.f);
 }
 
-void MeshupModel::drawPoints() {
-	// save current state of GL_NORMALIZE to properly restore the original
-	// state
-	bool normalize_enabled = glIsEnabled (GL_NORMALIZE);
-	if (!normalize_enabled)
-		glEnable (GL_NORMALIZE);
-
-	MeshVBO sphere_mesh = CreateUVSphere (16, 16);
+void MeshupModel::addPoints (
+		LineBuffer &lines,
+		std::vector<Matrix44f> &sphere_transforms,
+		std::vector<Vector4f> &sphere_colors,
+		const Matrix44f &transform) {
+	const float sphere_radius = 0.025f;
 
 	for (unsigned int i = 0; i < points.size(); i++) {
 		Vector3f frame_origin = points[i].frame->getPoseTransformTranslation();
 		Vector3f point_location = points[i].frame->getPoseTransformTranslation() + points[i].frame->getPoseTransformRotation() * points[i].coordinates;
 
-		glColor3fv (points[i].color.data());
+		frame_origin = transform_point (frame_origin, transform);
+		point_location = transform_point (point_location, transform);
 
 		if (points[i].draw_line) {
-			float line_range[2];
-			glGetFloatv (GL_ALIASED_LINE_WIDTH_RANGE, line_range);
-			if (points[i].line_width < line_range[0] || points[i].line_width > line_range[1]) {
-				cerr << "Warning: Only line widths within range [" << line_range[0] << ", " << line_range[1] << "] are supported by the graphics driver! (Point '" << points[i].name << "' has line_width = " << points[i].line_width << endl;
-			}
-			glLineWidth (points[i].line_width);
-			glBegin (GL_LINES);
-			glVertex3fv (frame_origin.data());
-			glVertex3fv (point_location.data());
-			glEnd();
+			lines.setLineWidth (points[i].line_width);
+			lines.addLine (frame_origin, point_location, points[i].color);
 		}
 
-		glPushMatrix();
-		glTranslatef (point_location[0], point_location[1], point_location[2]);
-		glScalef (0.025f, 0.025f, 0.025f);
-	
-		sphere_mesh.draw(GL_TRIANGLES);
-
-		glPopMatrix();
+		sphere_transforms.push_back (
+				SimpleMath::GL::ScaleMat44 (sphere_radius, sphere_radius, sphere_radius)
+				* SimpleMath::GL::TranslateMat44 (point_location[0], point_location[1], point_location[2]));
+		sphere_colors.push_back (Vector4f (points[i].color[0], points[i].color[1], points[i].color[2], 1.f));
 	}
-
-	// disable normalize if it was previously not enabled
-	if (!normalize_enabled)
-		glDisable (GL_NORMALIZE);
 }
 
 string vec3_to_string_no_brackets (const Vector3f &vector) {
@@ -838,6 +886,16 @@ bool MeshupModel::loadModelFromLuaFile (const char* filename, bool strict) {
 
 	configuration.init();
 
+	AnimationSettings default_settings;
+	animation_settings.force_color = model_table["animation_settings"]["force_color"].getDefault(default_settings.force_color);
+	animation_settings.torque_color = model_table["animation_settings"]["torque_color"].getDefault(default_settings.torque_color);
+	animation_settings.force_scale = model_table["animation_settings"]["force_scale"].getDefault(default_settings.force_scale);
+	animation_settings.torque_scale = model_table["animation_settings"]["torque_scale"].getDefault(default_settings.torque_scale);
+	animation_settings.force_transparency = model_table["animation_settings"]["force_transparency"].getDefault(default_settings.force_transparency);
+	animation_settings.torque_transparency = model_table["animation_settings"]["torque_transparency"].getDefault(default_settings.torque_transparency);
+	animation_settings.force_threshold = model_table["animation_settings"]["force_threshold"].getDefault(default_settings.force_threshold);
+	animation_settings.torque_threshold = model_table["animation_settings"]["torque_threshold"].getDefault(default_settings.torque_threshold);
+
 	// initialize the model StateDescriptor. First entry must be the time
 	// info.
 	state_descriptor.clear();
@@ -1048,7 +1106,8 @@ bool MeshupModel::loadModelFromLuaFile (const char* filename, bool strict) {
 			}
 
             // load the mesh or geometry
-            MeshPtr mesh (new MeshVBO);
+            MeshPtr mesh = NULL;
+            Matrix44f mesh_transform (Matrix44f::Identity());
 
             string mesh_filename = model_table["frames"][i]["visuals"][vi]["src"].getDefault<std::string>("");
             bool have_geometry = model_table["frames"][i]["visuals"][vi]["geometry"].exists();
@@ -1057,26 +1116,54 @@ bool MeshupModel::loadModelFromLuaFile (const char* filename, bool strict) {
                 cerr << "Error reading model " << model_filename << ": visual " << vi << " in frame " << i << ": attributes 'src' and 'geometry' are exclusive!" << endl;
                 abort();
             } else if (have_geometry) {
+                // Geometries are created with unit size and shared among all
+                // visuals with the same tessellation. The actual size is
+                // applied by the mesh transform of the segment.
+                ostringstream geometry_name;
+
                 if (model_table["frames"][i]["visuals"][vi]["geometry"]["box"].exists()) {
                     Vector3f dimensions = model_table["frames"][i]["visuals"][vi]["geometry"]["box"]["dimensions"].getDefault (Vector3f (1.f, 1.f, 1.f));
-                    (*mesh) = CreateCuboid(dimensions[0], dimensions[1], dimensions[2]);
+                    mesh_transform = SimpleMath::GL::ScaleMat44(dimensions[0], dimensions[1], dimensions[2]);
+
+                    geometry_name << "#box";
+                    mesh = findMesh (geometry_name.str());
+                    if (mesh == NULL)
+                        mesh = addMesh (geometry_name.str(), CreateCube());
                 } else if (model_table["frames"][i]["visuals"][vi]["geometry"]["sphere"].exists()) {
                     float radius = model_table["frames"][i]["visuals"][vi]["geometry"]["sphere"]["radius"].getDefault (1.f);
                     unsigned int rows = static_cast<unsigned int>(model_table["frames"][i]["visuals"][vi]["geometry"]["sphere"]["rows"].getDefault (16.));
                     unsigned int segments = static_cast<unsigned int>(model_table["frames"][i]["visuals"][vi]["geometry"]["sphere"]["segments"].getDefault (16.));
-                    mesh->join (SimpleMath::GL::ScaleMat44(radius, radius, radius), CreateUVSphere(rows, segments));
+                    mesh_transform = SimpleMath::GL::ScaleMat44(radius, radius, radius);
+
+                    geometry_name << "#sphere:" << rows << ":" << segments;
+                    mesh = findMesh (geometry_name.str());
+                    if (mesh == NULL)
+                        mesh = addMesh (geometry_name.str(), CreateUVSphere(rows, segments));
                 } else if (model_table["frames"][i]["visuals"][vi]["geometry"]["capsule"].exists()) {
                     float radius = model_table["frames"][i]["visuals"][vi]["geometry"]["capsule"]["radius"].getDefault (1.f);
                     float length = model_table["frames"][i]["visuals"][vi]["geometry"]["capsule"]["length"].getDefault (2.f);
                     unsigned int rows = static_cast<unsigned int>(model_table["frames"][i]["visuals"][vi]["geometry"]["capsule"]["rows"].getDefault (16.));
                     unsigned int segments = static_cast<unsigned int>(model_table["frames"][i]["visuals"][vi]["geometry"]["capsule"]["segments"].getDefault (16.));
-                    mesh->join (SimpleMath::GL::RotateMat44(90.f, 1.f, 0.f, 0.f), CreateCapsule(rows, segments, length, radius));
+
+                    // the caps do not scale with the length, therefore capsules
+                    // can only be shared if they have the same proportions
+                    float relative_length = length / radius;
+                    mesh_transform = SimpleMath::GL::ScaleMat44(radius, radius, radius) * SimpleMath::GL::RotateMat44(90.f, 1.f, 0.f, 0.f);
+
+                    geometry_name << "#capsule:" << rows << ":" << segments << ":" << setprecision(numeric_limits<float>::max_digits10) << relative_length;
+                    mesh = findMesh (geometry_name.str());
+                    if (mesh == NULL)
+                        mesh = addMesh (geometry_name.str(), CreateCapsule(rows, segments, relative_length, 1.f));
                 } else if (model_table["frames"][i]["visuals"][vi]["geometry"]["cylinder"].exists()) {
                     float radius = model_table["frames"][i]["visuals"][vi]["geometry"]["cylinder"]["radius"].getDefault (1.f);
                     float length = model_table["frames"][i]["visuals"][vi]["geometry"]["cylinder"]["length"].getDefault (2.f);
-                    unsigned int rows = static_cast<unsigned int>(model_table["frames"][i]["visuals"][vi]["geometry"]["cylinder"]["rows"].getDefault (16.));
                     unsigned int segments = static_cast<unsigned int>(model_table["frames"][i]["visuals"][vi]["geometry"]["cylinder"]["segments"].getDefault (16.));
-                    mesh->join (SimpleMath::GL::ScaleMat44(radius, radius, length) * SimpleMath::GL::RotateMat44(90.f, 1.f, 0.f, 0.f) , CreateCylinder(segments));
+                    mesh_transform = SimpleMath::GL::ScaleMat44(radius, radius, length) * SimpleMath::GL::RotateMat44(90.f, 1.f, 0.f, 0.f);
+
+                    geometry_name << "#cylinder:" << segments;
+                    mesh = findMesh (geometry_name.str());
+                    if (mesh == NULL)
+                        mesh = addMesh (geometry_name.str(), CreateCylinder(segments));
                 } else {
                     vector<LuaKey> keys = model_table["frames"][i]["visuals"][vi]["geometry"].keys();
                     if (keys.size() == 1) {
@@ -1089,14 +1176,14 @@ bool MeshupModel::loadModelFromLuaFile (const char* filename, bool strict) {
                 }
             } else if (mesh_filename != "") {
                 // check whether we have the mesh, if not try to load it
-                MeshMap::iterator mesh_iter = meshmap.find (mesh_filename);
-                if (mesh_iter == meshmap.end()) {
+                mesh = findMesh (mesh_filename);
+                if (mesh == NULL) {
+                    mesh = new MeshVBO;
+
                     // check whether we want to extract a sub object within the obj file
-                    string submesh_name = "";
                     if (mesh_filename.find (':') != string::npos) {
-                        submesh_name = mesh_filename.substr (mesh_filename.find(':') + 1, mesh_filename.size());
-                        mesh_filename = mesh_filename.substr (0, mesh_filename.find(':'));
-                        string mesh_file_location = find_mesh_file_by_name (mesh_filename);
+                        string submesh_name = mesh_filename.substr (mesh_filename.find(':') + 1, mesh_filename.size());
+                        string mesh_file_location = find_mesh_file_by_name (mesh_filename.substr (0, mesh_filename.find(':')));
                         cout << "Loading sub object " << submesh_name << " from file " << mesh_file_location << endl;
                         mesh->loadOBJ(mesh_file_location.c_str(), submesh_name.c_str());
                     } else {
@@ -1105,21 +1192,23 @@ bool MeshupModel::loadModelFromLuaFile (const char* filename, bool strict) {
                         mesh->loadOBJ(mesh_file_location.c_str());
                     }
 
+                    if (optimize_meshes)
+                        mesh->optimize();
+
+                    if (lod_levels > 0)
+                        mesh->generateLODs (lod_levels);
+
                     if (!skip_vbo_generation)
                         mesh->generate_vbo();
 
                     meshmap[mesh_filename] = mesh;
-
-                    mesh_iter = meshmap.find (mesh_filename);
                 }
-
-                mesh = mesh_iter->second;
             } else {
                 cerr << "Error reading model " << model_filename << ": visual " << vi << " in frame " << i << ": neither 'src' nor 'geometry' found!" << endl;
                 abort();
             }
 
-			addSegment (frame_name, mesh, dimensions, color, translate, rotate, scale, mesh_center);
+			addSegment (frame_name, mesh, dimensions, color, translate, rotate, scale, mesh_center, mesh_transform);
 		}
 	}
 
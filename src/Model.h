@@ -30,6 +30,8 @@ typedef Curve* CurvePtr;
 struct Frame;
 typedef Frame* FramePtr;
 
+struct LineBuffer;
+
 /** \brief Searches in various locations for the model. */
 std::string find_model_file_by_name (const std::string &model_name);
 
@@ -101,9 +103,12 @@ struct Segment {
 		meshcenter (1/0.0, 0.f, 0.f),
 		translate (0.f, 0.f, 0.f),
 		rotate (SimpleMath::GL::Quaternion::fromGLRotate (0.f, 1.f, 0.f, 0.f)),
+		mesh_transform (Matrix44f::Identity(4,4)),
 		gl_matrix (Matrix44f::Identity(4,4)),
 		frame (FramePtr()),
-		mesh_filename("")
+		mesh_filename(""),
+		bbox_min (-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()),
+		bbox_max (std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max())
 	{}
 
 	std::string name;
@@ -115,11 +120,22 @@ struct Segment {
 	Vector3f meshcenter;
 	Vector3f translate;
 	SimpleMath::GL::Quaternion rotate;
+	/// Transformation of the (shared) mesh into the local segment geometry,
+	/// e.g. the size of a geometry primitive
+	Matrix44f mesh_transform;
 	Matrix44f gl_matrix;
 	FramePtr frame;
 	std::string mesh_filename;
+	/// Bounding box of the transformed mesh in model coordinates (updated
+	/// by MeshupModel::updateSegments())
+	Vector3f bbox_min;
+	Vector3f bbox_max;
 };
 
+/** \brief Estimates how many pixels the bounding box diagonal of the
+ * segment mesh covers on the screen (used for the LOD selection). */
+float calc_projected_mesh_size (const Segment &segment, const Matrix44f &modelview, const Matrix44f &projection, float viewport_height);
+
 struct Point {
 	Point() :
 		pointIndex(0),
@@ -144,11 +160,41 @@ struct Point {
 	float line_width;
 };
 
+/** \brief Display settings of the model for animated data (forces and
+ * torques), read from the animation_settings table of the model file.
+ */
+struct AnimationSettings {
+	AnimationSettings() :
+		force_color (1.f, 0.f, 0.f),
+		torque_color (0.f, 1.f, 0.f),
+		force_scale (0.002f),
+		torque_scale (0.01f),
+		force_transparency (0.5f),
+		torque_transparency (0.5f),
+		force_threshold (1.0),
+		torque_threshold (0.1)
+	{}
+
+	Vector3f force_color;
+	Vector3f torque_color;
+	float force_scale;
+	float torque_scale;
+	float force_transparency;
+	float torque_transparency;
+	double force_threshold;
+	double torque_threshold;
+};
+
 struct MeshupModel {
 	MeshupModel():
 		model_filename (""),
 		frames_initialized(false),
-		skip_vbo_generation(false)
+		skip_vbo_generation(false),
+		optimize_meshes(true),
+		lod_levels(3),
+		lod_pixel_error(1.f),
+		bbox_min (-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()),
+		bbox_max (std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max())
 	{
 		// create the BASE frame
 		FramePtr base_frame (new (Frame));
@@ -174,6 +220,12 @@ struct MeshupModel {
 		frames_initialized = other.frames_initialized;
 
 		state_descriptor = other.state_descriptor;
+		animation_settings = other.animation_settings;
+		optimize_meshes = other.optimize_meshes;
+		lod_levels = other.lod_levels;
+		lod_pixel_error = other.lod_pixel_error;
+		bbox_min = other.bbox_min;
+		bbox_max = other.bbox_max;
 	}
 
 	MeshupModel& operator= (const MeshupModel& other) {
@@ -193,6 +245,12 @@ struct MeshupModel {
 			frames_initialized = other.frames_initialized;
 	
 			state_descriptor = other.state_descriptor;
+			animation_settings = other.animation_settings;
+			optimize_meshes = other.optimize_meshes;
+			lod_levels = other.lod_levels;
+			lod_pixel_error = other.lod_pixel_error;
+			bbox_min = other.bbox_min;
+			bbox_max = other.bbox_max;
 		}
 		return *this;
 	}
@@ -216,6 +274,9 @@ struct MeshupModel {
 	FrameConfig configuration;
 	/// Maps individual dofs to transformations
 	StateDescriptor state_descriptor;
+	/// Display settings of forces and torques (parsed when loading the
+	/// model)
+	AnimationSettings animation_settings;
 
 	/// Marks whether the frame transformations have to be initialized
 	bool frames_initialized;
@@ -223,6 +284,20 @@ struct MeshupModel {
 	/// Skips vbo generation when adding segments (useful when no OpenGL
 	// available)
 	bool skip_vbo_generation;
+
+	/// Reorders the triangles of loaded OBJ meshes for better vertex cache
+	// utilization and less overdraw
+	bool optimize_meshes;
+
+	/// Number of simplified levels that are created for loaded OBJ meshes
+	unsigned int lod_levels;
+	/// Maximum screen space error (in pixels) when choosing a mesh LOD
+	float lod_pixel_error;
+
+	/// Bounding box of all segments in model coordinates (updated by
+	/// updateSegments())
+	Vector3f bbox_min;
+	Vector3f bbox_max;
 	
 	void addFrame (
 			const std::string &parent_frame_name,
@@ -237,7 +312,13 @@ struct MeshupModel {
 			const Vector3f &translate,
 			const SimpleMath::GL::Quaternion &rotate,
 			const Vector3f &scale,
-			const Vector3f &mesh_center);
+			const Vector3f &mesh_center,
+			const Matrix44f &mesh_transform = Matrix44f::Identity(4,4));
+
+	/// Returns the mesh registered under name in the meshmap or NULL
+	MeshPtr findMesh (const std::string &name);
+	/// Registers a mesh under name in the meshmap and prepares it for drawing
+	MeshPtr addMesh (const std::string &name, MeshVBO &&mesh);
 
 	void addCurvePoint (
 			const std::string &curve_name,
@@ -310,18 +391,34 @@ struct MeshupModel {
 		meshmap.clear();
 		clearCurves();
 		state_descriptor.clear();
+
+		// the options for loading a model are kept
+		bool keep_optimize_meshes = optimize_meshes;
+		unsigned int keep_lod_levels = lod_levels;
+		float keep_lod_pixel_error = lod_pixel_error;
 	
 		*this = MeshupModel();
+
+		optimize_meshes = keep_optimize_meshes;
+		lod_levels = keep_lod_levels;
+		lod_pixel_error = keep_lod_pixel_error;
 	}
 
 	/// Initializes the fixed frame transformations and sets frames_initialized to true
 	void initDefaultFrameTransform();
 
 	void draw();
-	void drawFrameAxes();
-	void drawBaseFrameAxes();
-	void drawCurves();
-	void drawPoints();
+	/// Adds the axes of all frames (transformed by transform) to lines
+	void addFrameAxes (LineBuffer &lines, const Matrix44f &transform);
+	void addBaseFrameAxes (LineBuffer &lines, const Matrix44f &transform);
+	/// Adds the lines to the points to lines and the transformations of
+	/// the spheres that mark the points (for a unit sphere) to
+	/// sphere_transforms
+	void addPoints (
+			LineBuffer &lines,
+			std::vector<Matrix44f> &sphere_transforms,
+			std::vector<Vector4f> &sphere_colors,
+			const Matrix44f &transform);
 
 	bool loadModelFromFile (const char* filename, bool strict = true);
 	void saveModelToFile (const char* filename);
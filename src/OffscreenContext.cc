@@ -0,0 +1,195 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "GL/glew.h"
+
+#include "OffscreenContext.h"
+#include "meshup_config.h"
+
+#include <iostream>
+#include <cstring>
+
+#ifdef MESHUP_USE_EGL
+// no X11 headers as there is no display
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+using namespace std;
+
+OffscreenContext::OffscreenContext() :
+	display (NULL),
+	context (NULL),
+	surface (NULL)
+{}
+
+OffscreenContext::~OffscreenContext() {
+	destroy();
+}
+
+#ifdef MESHUP_USE_EGL
+
+static bool has_extension (const char *extensions, const char *name) {
+	if (extensions == NULL)
+		return false;
+
+	size_t name_length = strlen (name);
+	const char *start = extensions;
+	while ((start = strstr (start, name)) != NULL) {
+		if ((start == extensions || start[-1] == ' ')
+				&& (start[name_length] == ' ' || start[name_length] == '\0'))
+			return true;
+
+		start += name_length;
+	}
+
+	return false;
+}
+
+static EGLDisplay get_display () {
+	const char *client_extensions = eglQueryString (EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = NULL;
+	if (has_extension (client_extensions, "EGL_EXT_platform_base"))
+		get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress ("eglGetPlatformDisplayEXT");
+
+	if (get_platform_display != NULL && has_extension (client_extensions, "EGL_MESA_platform_surfaceless")) {
+		EGLDisplay display = get_platform_display (EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display != EGL_NO_DISPLAY)
+			return display;
+	}
+
+	// e.g. the proprietary NVIDIA driver
+	if (get_platform_display != NULL && has_extension (client_extensions, "EGL_EXT_platform_device")) {
+		PFNEGLQUERYDEVICESEXTPROC query_devices = (PFNEGLQUERYDEVICESEXTPROC) eglGetProcAddress ("eglQueryDevicesEXT");
+
+		EGLDeviceEXT device;
+		EGLint device_count = 0;
+		if (query_devices != NULL && query_devices (1, &device, &device_count) && device_count > 0) {
+			EGLDisplay display = get_platform_display (EGL_PLATFORM_DEVICE_EXT, device, NULL);
+			if (display != EGL_NO_DISPLAY)
+				return display;
+		}
+	}
+
+	return eglGetDisplay (EGL_DEFAULT_DISPLAY);
+}
+
+bool OffscreenContext::init (int width, int height, bool alpha) {
+	destroy();
+
+	EGLDisplay egl_display = get_display();
+	EGLint major, minor;
+	if (egl_display == EGL_NO_DISPLAY || !eglInitialize (egl_display, &major, &minor)) {
+		cerr << "Error: could not initialize EGL!" << endl;
+		return false;
+	}
+	display = egl_display;
+
+	// desktop OpenGL with the compatibility profile (the fixed function
+	// pipeline is used for lines and as fallback)
+	if (!eglBindAPI (EGL_OPENGL_API)) {
+		cerr << "Error: EGL does not support desktop OpenGL!" << endl;
+		destroy();
+		return false;
+	}
+
+	EGLint config_attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint config_count = 0;
+	if (!eglChooseConfig (egl_display, config_attributes, &config, 1, &config_count) || config_count == 0) {
+		cerr << "Error: no suitable EGL config found!" << endl;
+		destroy();
+		return false;
+	}
+
+	EGLContext egl_context = eglCreateContext (egl_display, config, EGL_NO_CONTEXT, NULL);
+	if (egl_context == EGL_NO_CONTEXT) {
+		cerr << "Error: could not create EGL context!" << endl;
+		destroy();
+		return false;
+	}
+	context = egl_context;
+
+	// we only draw into framebuffer objects but without
+	// EGL_KHR_surfaceless_context a surface has to be current
+	EGLSurface egl_surface = EGL_NO_SURFACE;
+	if (!has_extension (eglQueryString (egl_display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+		EGLint surface_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		egl_surface = eglCreatePbufferSurface (egl_display, config, surface_attributes);
+		surface = egl_surface;
+	}
+
+	if (!eglMakeCurrent (egl_display, egl_surface, egl_surface, egl_context)) {
+		cerr << "Error: could not make the EGL context current!" << endl;
+		destroy();
+		return false;
+	}
+
+	// glewInit() also initializes GLX, which fails without a display
+	GLenum err = glewInitNoWindowSystem();
+	if (GLEW_OK != err) {
+		cerr << "Error initializing GLEW: " << glewGetErrorString(err) << endl;
+		destroy();
+		return false;
+	}
+
+	cout << "OpenGL Version : " << (const char*) glGetString (GL_VERSION) << endl;
+	cout << "OpenGL Renderer: " << (const char*) glGetString (GL_RENDERER) << endl;
+
+	if (!framebuffer.init (width, height, alpha)) {
+		destroy();
+		return false;
+	}
+
+	framebuffer.bind();
+
+	return true;
+}
+
+void OffscreenContext::destroy() {
+	if (context != NULL) {
+		framebuffer.destroy();
+
+		eglMakeCurrent (display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext (display, context);
+	}
+
+	if (surface != NULL)
+		eglDestroySurface (display, surface);
+
+	if (display != NULL)
+		eglTerminate (display);
+
+	display = NULL;
+	context = NULL;
+	surface = NULL;
+}
+
+#else
+
+bool OffscreenContext::init (int /* width */, int /* height */, bool /* alpha */) {
+	cerr << "Error: MeshUp was built without EGL, rendering without a window is not supported!" << endl;
+	return false;
+}
+
+void OffscreenContext::destroy() {
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_OFFSCREENCONTEXT_H
+#define MESHUP_OFFSCREENCONTEXT_H
+
+#include "OffscreenFramebuffer.h"
+
+/** \brief OpenGL context that renders into a framebuffer object without a
+ * window or display server.
+ *
+ * The context is created with EGL, preferably on the surfaceless Mesa
+ * platform (also works with the llvmpipe software rasterizer), otherwise
+ * on the first EGL device or the default display. Requires MeshUp to be
+ * built with EGL (MESHUP_USE_EGL).
+ *
+ * Usage:
+ *
+ * \code
+ *	OffscreenContext context;
+ *	if (!context.init (1280, 720))
+ *		return error;
+ *	// draw
+ *	context.readPixels (pixels);
+ * \endcode
+ */
+struct OffscreenContext {
+	OffscreenContext();
+	~OffscreenContext();
+
+	/// Creates the context, makes it current, initializes GLEW and binds
+	/// the framebuffer with the given size. Returns false if any of this
+	/// fails.
+	bool init (int width, int height, bool alpha);
+	/// Frees the framebuffer and the context
+	void destroy();
+
+	/// Bound after init(), the frames are read from it
+	OffscreenFramebuffer framebuffer;
+
+	/// EGLDisplay and EGLContext
+	void *display;
+	void *context;
+	/// Only used if surfaceless contexts are not supported
+	void *surface;
+};
+
+#endif
@@ -0,0 +1,429 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "GL/glew.h"
+
+#include "OffscreenFramebuffer.h"
+
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+// draws a single triangle that covers the viewport
+static const char* yuv_vertex_shader_source =
+	"#version 130\n"
+	"void main() {\n"
+	"	vec2 corner = vec2 (float (gl_VertexID % 2), float (gl_VertexID / 2));\n"
+	"	gl_Position = vec4 (corner * 4.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+// Each fragment computes one byte of the Y, U and V planes stored one after
+// the other with width bytes per texture row. The first height rows hold
+// the luma, each of the remaining rows two rows of U or V, which are the
+// average of 2x2 pixels. Coefficients of BT.601 with limited range.
+static const char* yuv_fragment_shader_source =
+	"#version 130\n"
+	"uniform sampler2D color_texture;\n"
+	"uniform int width;\n"
+	"uniform int height;\n"
+	"out vec4 frag_color;\n"
+	"\n"
+	"// y counts from the top row\n"
+	"vec3 fetch (int x, int y) {\n"
+	"	return texelFetch (color_texture, ivec2 (x, height - 1 - y), 0).rgb;\n"
+	"}\n"
+	"\n"
+	"void main() {\n"
+	"	int x = int (gl_FragCoord.x);\n"
+	"	int y = int (gl_FragCoord.y);\n"
+	"	float value;\n"
+	"\n"
+	"	if (y < height) {\n"
+	"		value = dot (fetch (x, y), vec3 (0.257, 0.504, 0.098)) + 16.0 / 255.0;\n"
+	"	} else {\n"
+	"		int chroma_width = width / 2;\n"
+	"		int plane_size = chroma_width * (height / 2);\n"
+	"		int index = (y - height) * width + x;\n"
+	"		bool is_v = index >= plane_size;\n"
+	"		if (is_v)\n"
+	"			index -= plane_size;\n"
+	"\n"
+	"		int cx = 2 * (index % chroma_width);\n"
+	"		int cy = 2 * (index / chroma_width);\n"
+	"		vec3 rgb = 0.25 * (fetch (cx, cy) + fetch (cx + 1, cy) + fetch (cx, cy + 1) + fetch (cx + 1, cy + 1));\n"
+	"\n"
+	"		if (is_v)\n"
+	"			value = dot (rgb, vec3 (0.439, -0.368, -0.071)) + 128.0 / 255.0;\n"
+	"		else\n"
+	"			value = dot (rgb, vec3 (-0.148, -0.291, 0.439)) + 128.0 / 255.0;\n"
+	"	}\n"
+	"\n"
+	"	frag_color = vec4 (value, 0.0, 0.0, 1.0);\n"
+	"}\n";
+
+static GLuint compile_yuv_shader (GLenum type, const char* source) {
+	GLuint shader_id = glCreateShader (type);
+	glShaderSource (shader_id, 1, &source, NULL);
+	glCompileShader (shader_id);
+
+	GLint status = GL_FALSE;
+	glGetShaderiv (shader_id, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		GLchar log[4096];
+		glGetShaderInfoLog (shader_id, sizeof(log), NULL, log);
+		cerr << "Error compiling YUV conversion shader:" << endl << log << endl;
+
+		glDeleteShader (shader_id);
+		return 0;
+	}
+
+	return shader_id;
+}
+
+OffscreenFramebuffer::OffscreenFramebuffer() :
+	width (0),
+	height (0),
+	alpha (false),
+	yuv (false),
+	pixel_buffer_count (4),
+	pending_count (0),
+	mapped_count (0),
+	framebuffer_id (0),
+	color_texture_id (0),
+	depth_buffer_id (0),
+	yuv_framebuffer_id (0),
+	yuv_texture_id (0),
+	yuv_program_id (0),
+	yuv_vertex_array_id (0),
+	first_pending (0)
+{}
+
+OffscreenFramebuffer::~OffscreenFramebuffer() {
+	destroy();
+}
+
+bool OffscreenFramebuffer::init (int width, int height, bool alpha, bool yuv) {
+	if (framebuffer_id != 0 && width == this->width && height == this->height && alpha == this->alpha && yuv == this->yuv)
+		return true;
+
+	destroy();
+
+	if (!GLEW_VERSION_3_0 && !GLEW_ARB_framebuffer_object) {
+		cerr << "Error: framebuffer objects not supported!" << endl;
+		return false;
+	}
+
+	if (yuv && !GLEW_VERSION_3_0) {
+		cerr << "Error: the YUV conversion requires OpenGL 3.0!" << endl;
+		return false;
+	}
+
+	if (yuv && (width % 2 != 0 || height % 4 != 0)) {
+		cerr << "Error: the YUV conversion requires a width and height that are multiples of 2 and 4!" << endl;
+		return false;
+	}
+
+	this->width = width;
+	this->height = height;
+	this->alpha = alpha;
+	this->yuv = yuv;
+
+	GLint previous_framebuffer;
+	glGetIntegerv (GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+	// a texture such that the YUV conversion can read it
+	glGenTextures (1, &color_texture_id);
+	glBindTexture (GL_TEXTURE_2D, color_texture_id);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D (GL_TEXTURE_2D, 0, alpha ? GL_RGBA8 : GL_RGB8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture (GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers (1, &depth_buffer_id);
+	glBindRenderbuffer (GL_RENDERBUFFER, depth_buffer_id);
+	glRenderbufferStorage (GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer (GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers (1, &framebuffer_id);
+	glBindFramebuffer (GL_FRAMEBUFFER, framebuffer_id);
+	glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture_id, 0);
+	glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer_id);
+
+	GLenum status = glCheckFramebufferStatus (GL_FRAMEBUFFER);
+	glBindFramebuffer (GL_FRAMEBUFFER, previous_framebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		cerr << "Error: could not create a framebuffer of size " << width << "x" << height << "!" << endl;
+		destroy();
+		return false;
+	}
+
+	if (yuv && !initYUVConversion()) {
+		destroy();
+		return false;
+	}
+
+	if (GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object) {
+		pixel_buffer_ids.resize (pixel_buffer_count);
+		glGenBuffers (pixel_buffer_count, &pixel_buffer_ids[0]);
+
+		for (unsigned int i = 0; i < pixel_buffer_count; i++) {
+			glBindBuffer (GL_PIXEL_PACK_BUFFER, pixel_buffer_ids[i]);
+			glBufferData (GL_PIXEL_PACK_BUFFER, frameSize(), NULL, GL_STREAM_READ);
+		}
+		glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+	} else {
+		pixel_copies.resize (pixel_buffer_count, vector<unsigned char> (frameSize()));
+	}
+
+	return true;
+}
+
+bool OffscreenFramebuffer::initYUVConversion() {
+	GLint previous_framebuffer;
+	glGetIntegerv (GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+	glGenTextures (1, &yuv_texture_id);
+	glBindTexture (GL_TEXTURE_2D, yuv_texture_id);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D (GL_TEXTURE_2D, 0, GL_R8, width, height * 3 / 2, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture (GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers (1, &yuv_framebuffer_id);
+	glBindFramebuffer (GL_FRAMEBUFFER, yuv_framebuffer_id);
+	glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, yuv_texture_id, 0);
+
+	GLenum status = glCheckFramebufferStatus (GL_FRAMEBUFFER);
+	glBindFramebuffer (GL_FRAMEBUFFER, previous_framebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		cerr << "Error: could not create the framebuffer of the YUV conversion!" << endl;
+		return false;
+	}
+
+	GLuint vertex_shader_id = compile_yuv_shader (GL_VERTEX_SHADER, yuv_vertex_shader_source);
+	GLuint fragment_shader_id = compile_yuv_shader (GL_FRAGMENT_SHADER, yuv_fragment_shader_source);
+
+	if (vertex_shader_id == 0 || fragment_shader_id == 0) {
+		glDeleteShader (vertex_shader_id);
+		glDeleteShader (fragment_shader_id);
+		return false;
+	}
+
+	yuv_program_id = glCreateProgram();
+	glAttachShader (yuv_program_id, vertex_shader_id);
+	glAttachShader (yuv_program_id, fragment_shader_id);
+	glBindFragDataLocation (yuv_program_id, 0, "frag_color");
+	glLinkProgram (yuv_program_id);
+
+	// the program keeps the shaders alive as long as they are attached
+	glDeleteShader (vertex_shader_id);
+	glDeleteShader (fragment_shader_id);
+
+	GLint link_status = GL_FALSE;
+	glGetProgramiv (yuv_program_id, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE) {
+		GLchar log[4096];
+		glGetProgramInfoLog (yuv_program_id, sizeof(log), NULL, log);
+		cerr << "Error linking YUV conversion shader program:" << endl << log << endl;
+		return false;
+	}
+
+	glUseProgram (yuv_program_id);
+	glUniform1i (glGetUniformLocation (yuv_program_id, "color_texture"), 0);
+	glUniform1i (glGetUniformLocation (yuv_program_id, "width"), width);
+	glUniform1i (glGetUniformLocation (yuv_program_id, "height"), height);
+	glUseProgram (0);
+
+	// the triangle has no vertex attributes but core profiles need a
+	// vertex array object to draw
+	glGenVertexArrays (1, &yuv_vertex_array_id);
+
+	return true;
+}
+
+void OffscreenFramebuffer::bind() {
+	glBindFramebuffer (GL_FRAMEBUFFER, framebuffer_id);
+	glViewport (0, 0, width, height);
+}
+
+void OffscreenFramebuffer::release() {
+	glBindFramebuffer (GL_FRAMEBUFFER, 0);
+}
+
+void OffscreenFramebuffer::convertToYUV() {
+	glPushAttrib (GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT);
+
+	GLint previous_program;
+	glGetIntegerv (GL_CURRENT_PROGRAM, &previous_program);
+
+	glBindFramebuffer (GL_FRAMEBUFFER, yuv_framebuffer_id);
+	glViewport (0, 0, width, height * 3 / 2);
+	glDisable (GL_DEPTH_TEST);
+	glDisable (GL_BLEND);
+	glDisable (GL_CULL_FACE);
+	glDisable (GL_SCISSOR_TEST);
+
+	glActiveTexture (GL_TEXTURE0);
+	glBindTexture (GL_TEXTURE_2D, color_texture_id);
+	glUseProgram (yuv_program_id);
+	glBindVertexArray (yuv_vertex_array_id);
+
+	glDrawArrays (GL_TRIANGLES, 0, 3);
+
+	glBindVertexArray (0);
+	glUseProgram (previous_program);
+	glBindTexture (GL_TEXTURE_2D, 0);
+
+	glPopAttrib();
+}
+
+bool OffscreenFramebuffer::startRead() {
+	if (isFull())
+		return false;
+
+	unsigned int index = (first_pending + pending_count) % pixel_buffer_count;
+
+	GLint previous_framebuffer;
+	glGetIntegerv (GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+	GLenum format = GL_BGRA;
+	if (yuv) {
+		convertToYUV();
+		format = GL_RED;
+	}
+
+	// the rows of the chroma planes are only width/2 bytes
+	glPixelStorei (GL_PACK_ALIGNMENT, yuv ? 1 : 4);
+	glReadBuffer (GL_COLOR_ATTACHMENT0);
+
+	int read_height = yuv ? height * 3 / 2 : height;
+
+	if (pixel_buffer_ids.size() > 0) {
+		// returns immediately, the pixels are copied by the GPU
+		glBindBuffer (GL_PIXEL_PACK_BUFFER, pixel_buffer_ids[index]);
+		glReadPixels (0, 0, width, read_height, format, GL_UNSIGNED_BYTE, NULL);
+		glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+	} else {
+		glReadPixels (0, 0, width, read_height, format, GL_UNSIGNED_BYTE, &pixel_copies[index][0]);
+	}
+
+	if (yuv)
+		glBindFramebuffer (GL_FRAMEBUFFER, previous_framebuffer);
+
+	pending_count++;
+
+	return true;
+}
+
+bool OffscreenFramebuffer::finishRead (unsigned char *pixels) {
+	if (mapped_count > 0)
+		return false;
+
+	const unsigned char *mapped_pixels = mapRead();
+	if (mapped_pixels == NULL)
+		return false;
+
+	memcpy (pixels, mapped_pixels, frameSize());
+	unmapRead();
+
+	return true;
+}
+
+const unsigned char* OffscreenFramebuffer::mapRead() {
+	if (pending_count == 0)
+		return NULL;
+
+	void *pixels = NULL;
+
+	if (pixel_buffer_ids.size() > 0) {
+		glBindBuffer (GL_PIXEL_PACK_BUFFER, pixel_buffer_ids[first_pending]);
+		pixels = glMapBuffer (GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+
+		if (pixels == NULL)
+			cerr << "Error: could not map the pixel buffer!" << endl;
+	} else {
+		pixels = &pixel_copies[first_pending][0];
+	}
+
+	// the frame is skipped if it could not be mapped
+	first_pending = (first_pending + 1) % pixel_buffer_count;
+	pending_count--;
+
+	if (pixels != NULL)
+		mapped_count++;
+
+	return static_cast<const unsigned char*>(pixels);
+}
+
+void OffscreenFramebuffer::unmapRead() {
+	if (mapped_count == 0)
+		return;
+
+	unsigned int index = (first_pending + pixel_buffer_count - mapped_count) % pixel_buffer_count;
+
+	if (pixel_buffer_ids.size() > 0) {
+		glBindBuffer (GL_PIXEL_PACK_BUFFER, pixel_buffer_ids[index]);
+		glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+		glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	mapped_count--;
+}
+
+void OffscreenFramebuffer::discardPending() {
+	while (mapped_count > 0)
+		unmapRead();
+
+	pending_count = 0;
+	first_pending = 0;
+}
+
+void OffscreenFramebuffer::readPixels (unsigned char *bgra_pixels) {
+	glPixelStorei (GL_PACK_ALIGNMENT, 4);
+	glReadBuffer (GL_COLOR_ATTACHMENT0);
+	glReadPixels (0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, bgra_pixels);
+}
+
+void OffscreenFramebuffer::destroy() {
+	// nothing to free if init() was never called (e.g. no context), mapped
+	// buffers are unmapped by deleting them
+	if (pixel_buffer_ids.size() > 0)
+		glDeleteBuffers (pixel_buffer_ids.size(), &pixel_buffer_ids[0]);
+	if (framebuffer_id != 0)
+		glDeleteFramebuffers (1, &framebuffer_id);
+	if (color_texture_id != 0)
+		glDeleteTextures (1, &color_texture_id);
+	if (depth_buffer_id != 0)
+		glDeleteRenderbuffers (1, &depth_buffer_id);
+	if (yuv_framebuffer_id != 0)
+		glDeleteFramebuffers (1, &yuv_framebuffer_id);
+	if (yuv_texture_id != 0)
+		glDeleteTextures (1, &yuv_texture_id);
+	if (yuv_program_id != 0)
+		glDeleteProgram (yuv_program_id);
+	if (yuv_vertex_array_id != 0)
+		glDeleteVertexArrays (1, &yuv_vertex_array_id);
+
+	pixel_buffer_ids.clear();
+	pixel_copies.clear();
+	framebuffer_id = 0;
+	color_texture_id = 0;
+	depth_buffer_id = 0;
+	yuv_framebuffer_id = 0;
+	yuv_texture_id = 0;
+	yuv_program_id = 0;
+	yuv_vertex_array_id = 0;
+	mapped_count = 0;
+	pending_count = 0;
+	first_pending = 0;
+}
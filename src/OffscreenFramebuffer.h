@@ -0,0 +1,139 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_OFFSCREENFRAMEBUFFER_H
+#define MESHUP_OFFSCREENFRAMEBUFFER_H
+
+#include <vector>
+
+/** \brief Framebuffer object with a color and a depth buffer that is kept
+ * over many frames, together with a ring of pixel buffer objects for
+ * asynchronous readback.
+ *
+ * startRead() only queues the copy of the color buffer into the next pixel
+ * buffer object such that the GPU can transfer the pixels while the
+ * following frames are drawn. finishRead() maps the oldest of these buffers
+ * and copies its pixels, which only waits if the transfer is still running.
+ * Without pixel buffer objects the pixels are read immediately into memory.
+ *
+ * Instead of copying them, the pixels can also be used directly in the
+ * mapped buffer: mapRead() maps the oldest pending frame, whose buffer is
+ * only reused after the matching unmapRead().
+ *
+ * If yuv is passed to init(), startRead() first converts the frame in a
+ * shader pass to planar YUV 4:2:0 (BT.601 with limited range, as used by
+ * the video encoder) with the rows from top to bottom. This leaves no color
+ * conversion to the CPU and only transfers 1.5 instead of 4 bytes per
+ * pixel.
+ *
+ * Usage:
+ *
+ * \code
+ *	framebuffer.init (width, height, false);
+ *	for (each frame) {
+ *		if (framebuffer.isFull())
+ *			framebuffer.finishRead (pixels); // oldest frame
+ *		framebuffer.bind();
+ *		draw();
+ *		framebuffer.startRead();
+ *		framebuffer.release();
+ *	}
+ *	while (framebuffer.pending_count > 0)
+ *		framebuffer.finishRead (pixels);
+ * \endcode
+ */
+struct OffscreenFramebuffer {
+	OffscreenFramebuffer();
+	/// Requires the context of init() to be current
+	~OffscreenFramebuffer();
+
+	int width;
+	int height;
+	bool alpha;
+	bool yuv;
+
+	/// Number of frames that can be read asynchronously at the same time
+	unsigned int pixel_buffer_count;
+	/// Frames started with startRead() and not yet finished or mapped
+	unsigned int pending_count;
+	/// Frames mapped with mapRead() and not yet unmapped
+	unsigned int mapped_count;
+
+	/// Creates the buffers for the current context. Does nothing if they
+	/// already exist with the same size and format, otherwise pending
+	/// frames are discarded. The YUV conversion requires OpenGL 3.0 and a
+	/// width and height that are multiples of 2 and 4. Returns false if
+	/// framebuffer objects are not supported or the size is not possible.
+	bool init (int width, int height, bool alpha, bool yuv = false);
+	/// Binds the framebuffer and sets the viewport to its size
+	void bind();
+	/// Binds the default framebuffer of the context
+	void release();
+
+	/// Number of bytes of a frame (8 bit BGRA pixels or the Y, U and V
+	/// planes)
+	unsigned int frameSize() const {
+		if (yuv)
+			return width * height * 3 / 2;
+
+		return width * height * 4;
+	}
+	/// Whether a frame has to be finished or unmapped before the next
+	/// startRead()
+	bool isFull() const {
+		return pending_count + mapped_count == pixel_buffer_count;
+	}
+
+	/// Queues the readback of the bound framebuffer. Fails if isFull().
+	bool startRead();
+	/// Copies the pixels of the oldest pending frame as 8 bit BGRA pixels
+	/// (same layout as the 32 bit formats of QImage) with the rows from
+	/// bottom to top, or as YUV planes. Returns false if no frame is
+	/// pending. Requires that no frame is mapped.
+	bool finishRead (unsigned char *pixels);
+	/// Returns the pixels (see finishRead()) of the oldest pending frame
+	/// without copying them, NULL if no frame is pending. They stay valid
+	/// until unmapRead() and can be read from any thread.
+	const unsigned char* mapRead();
+	/// Unmaps the oldest mapped frame and frees its buffer for startRead()
+	void unmapRead();
+	/// Forgets the pending frames without reading them and unmaps the
+	/// mapped ones
+	void discardPending();
+	/// Reads the BGRA pixels of the bound framebuffer immediately (requires
+	/// that no frames are pending)
+	void readPixels (unsigned char *bgra_pixels);
+
+	void destroy();
+
+	unsigned int framebuffer_id;
+	unsigned int color_texture_id;
+	unsigned int depth_buffer_id;
+
+	/// Target of the YUV conversion: a single channel texture of
+	/// width x 1.5 height texels that has the memory layout of the planes
+	unsigned int yuv_framebuffer_id;
+	unsigned int yuv_texture_id;
+	unsigned int yuv_program_id;
+	unsigned int yuv_vertex_array_id;
+
+	/// Empty if pixel buffer objects are not supported
+	std::vector<unsigned int> pixel_buffer_ids;
+	/// Used instead of the pixel buffer objects if these are not supported
+	std::vector<std::vector<unsigned char> > pixel_copies;
+	/// Index of the buffer of the oldest pending frame, the mapped frames
+	/// come right before it
+	unsigned int first_pending;
+
+	bool initYUVConversion();
+	/// Draws the color texture into the YUV texture
+	void convertToYUV();
+};
+
+#endif
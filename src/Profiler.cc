@@ -0,0 +1,245 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "GL/glew.h"
+
+#include "Profiler.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+using namespace std;
+
+Profiler profiler;
+
+static const char* phase_names[ProfilePhaseCount] = {
+	"frame",
+	"script_update",
+	"animation",
+	"update_frames",
+	"update_segments",
+	"draw_meshes",
+	"draw_curves",
+	"draw_arrows",
+	"shadows",
+	"swap",
+	"readback"
+};
+
+Profiler::Profiler() :
+	enabled (false),
+	show_overlay (false),
+	frame_count (0),
+	gpu_active (false),
+	gpu_supported (-1)
+{
+	clearSample (current);
+}
+
+const char* Profiler::phaseName (ProfilePhase phase) {
+	return phase_names[phase];
+}
+
+void Profiler::clearSample (Sample &sample) {
+	sample.frame = frame_count;
+	for (unsigned int i = 0; i < ProfilePhaseCount; i++) {
+		sample.cpu[i] = 0.f;
+		sample.gpu[i] = -1.f;
+	}
+}
+
+void Profiler::setEnabled (bool enable) {
+	enabled = enable;
+	frame_count = 0;
+	clearSample (current);
+}
+
+void Profiler::beginFrame() {
+	if (!enabled)
+		return;
+
+	clearSample (current);
+	beginPhase (ProfilePhaseFrame, false);
+}
+
+void Profiler::endFrame() {
+	if (!enabled)
+		return;
+
+	endPhase (ProfilePhaseFrame, false);
+
+	unsigned int frame = frame_count;
+	current.frame = frame;
+	history[frame % HistorySize] = current;
+
+	// publish the sample after it was written
+	frame_count = frame + 1;
+
+	clearSample (current);
+}
+
+void Profiler::beginPhase (ProfilePhase phase, bool gpu) {
+	timer_start (&phase_timers[phase]);
+
+	if (!gpu || gpu_active)
+		return;
+
+	if (gpu_supported < 0)
+		gpu_supported = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query) ? 1 : 0;
+
+	if (gpu_supported == 0)
+		return;
+
+	// the slot of this frame was last used QueryLatency frames ago
+	unsigned int frame = frame_count;
+	unsigned int slot = frame % QueryLatency;
+	if (pending_queries[slot].size() != 0 && pending_queries[slot][0].frame != frame)
+		collectQueries (slot);
+
+	if (free_queries.size() == 0) {
+		unsigned int query_id;
+		glGenQueries (1, &query_id);
+		free_queries.push_back (query_id);
+	}
+
+	active_query.id = free_queries.back();
+	active_query.phase = phase;
+	active_query.frame = frame;
+	free_queries.pop_back();
+
+	glBeginQuery (GL_TIME_ELAPSED, active_query.id);
+	gpu_active = true;
+}
+
+void Profiler::endPhase (ProfilePhase phase, bool gpu) {
+	current.cpu[phase] += static_cast<float>(timer_stop (&phase_timers[phase]) * 1.0e3);
+
+	if (!gpu || !gpu_active || active_query.phase != phase)
+		return;
+
+	glEndQuery (GL_TIME_ELAPSED);
+	gpu_active = false;
+
+	pending_queries[active_query.frame % QueryLatency].push_back (active_query);
+}
+
+void Profiler::collectQueries (unsigned int slot) {
+	vector<GPUQuery> &queries = pending_queries[slot];
+
+	for (size_t i = 0; i < queries.size(); i++) {
+		GLuint64 elapsed_ns = 0;
+		glGetQueryObjectui64v (queries[i].id, GL_QUERY_RESULT, &elapsed_ns);
+		free_queries.push_back (queries[i].id);
+
+		// the frame may have been overwritten or the history cleared
+		unsigned int frame = queries[i].frame;
+		if (frame >= frame_count || frame_count - frame > HistorySize)
+			continue;
+
+		Sample &sample = history[frame % HistorySize];
+		if (sample.gpu[queries[i].phase] < 0.f)
+			sample.gpu[queries[i].phase] = 0.f;
+		sample.gpu[queries[i].phase] += static_cast<float>(elapsed_ns * 1.0e-6);
+	}
+
+	queries.clear();
+}
+
+Profiler::Summary Profiler::summarize (unsigned int frames) const {
+	Summary summary;
+
+	unsigned int count = frame_count;
+	frames = min (frames, min (count, HistorySize));
+	summary.frame_count = frames;
+
+	unsigned int gpu_counts[ProfilePhaseCount];
+	for (unsigned int i = 0; i < ProfilePhaseCount; i++) {
+		summary.cpu_average[i] = 0.f;
+		summary.cpu_max[i] = 0.f;
+		summary.gpu_average[i] = 0.f;
+		gpu_counts[i] = 0;
+	}
+
+	for (unsigned int f = count - frames; f < count; f++) {
+		const Sample &sample = history[f % HistorySize];
+
+		for (unsigned int i = 0; i < ProfilePhaseCount; i++) {
+			summary.cpu_average[i] += sample.cpu[i];
+			summary.cpu_max[i] = max (summary.cpu_max[i], sample.cpu[i]);
+
+			if (sample.gpu[i] >= 0.f) {
+				summary.gpu_average[i] += sample.gpu[i];
+				gpu_counts[i]++;
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < ProfilePhaseCount; i++) {
+		if (frames > 0)
+			summary.cpu_average[i] /= frames;
+
+		if (gpu_counts[i] > 0)
+			summary.gpu_average[i] /= gpu_counts[i];
+		else
+			summary.gpu_average[i] = -1.f;
+	}
+
+	return summary;
+}
+
+bool Profiler::writeCSV (const char *filename) const {
+	ofstream csv_file (filename);
+	if (!csv_file) {
+		cerr << "Error: could not write profile to file " << filename << endl;
+		return false;
+	}
+
+	csv_file << "frame";
+	for (unsigned int i = 0; i < ProfilePhaseCount; i++)
+		csv_file << ", " << phase_names[i] << "_cpu_ms";
+	for (unsigned int i = 0; i < ProfilePhaseCount; i++)
+		csv_file << ", " << phase_names[i] << "_gpu_ms";
+	csv_file << endl;
+
+	unsigned int count = frame_count;
+	unsigned int frames = min (count, HistorySize);
+
+	for (unsigned int f = count - frames; f < count; f++) {
+		const Sample &sample = history[f % HistorySize];
+
+		csv_file << sample.frame;
+		for (unsigned int i = 0; i < ProfilePhaseCount; i++)
+			csv_file << ", " << sample.cpu[i];
+		for (unsigned int i = 0; i < ProfilePhaseCount; i++) {
+			csv_file << ", ";
+			if (sample.gpu[i] >= 0.f)
+				csv_file << sample.gpu[i];
+		}
+		csv_file << endl;
+	}
+
+	return true;
+}
+
+void Profiler::destroy() {
+	if (gpu_active)
+		glEndQuery (GL_TIME_ELAPSED);
+	gpu_active = false;
+
+	for (unsigned int i = 0; i < QueryLatency; i++) {
+		for (size_t j = 0; j < pending_queries[i].size(); j++)
+			free_queries.push_back (pending_queries[i][j].id);
+		pending_queries[i].clear();
+	}
+
+	if (free_queries.size() != 0)
+		glDeleteQueries (free_queries.size(), &free_queries[0]);
+	free_queries.clear();
+}
@@ -0,0 +1,162 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_PROFILER_H
+#define MESHUP_PROFILER_H
+
+#include <vector>
+#include <atomic>
+
+#include "timer.h"
+
+/** \brief Parts of a frame that are timed by the Profiler.
+ *
+ * Phases may be nested (e.g. update_frames is part of animation or
+ * draw_meshes part of shadows), the times are inclusive.
+ */
+enum ProfilePhase {
+	ProfilePhaseFrame = 0,
+	ProfilePhaseScriptUpdate,
+	ProfilePhaseAnimation,
+	ProfilePhaseUpdateFrames,
+	ProfilePhaseUpdateSegments,
+	ProfilePhaseDrawMeshes,
+	ProfilePhaseDrawCurves,
+	ProfilePhaseDrawArrows,
+	ProfilePhaseShadows,
+	ProfilePhaseSwap,
+	ProfilePhaseReadback,
+	ProfilePhaseCount
+};
+
+/** \brief Records the CPU and GPU time spent in the phases of the last
+ * HistorySize frames.
+ *
+ * Phases are timed with ProfileScope, which does nothing but check
+ * Profiler::enabled if profiling is disabled. The GPU time is measured
+ * with GL_TIME_ELAPSED queries (if supported) whose results are read
+ * QueryLatency frames later to not stall the pipeline. As these queries
+ * cannot be nested, a GPU phase inside another one is only timed on the
+ * CPU.
+ *
+ * The history is a ring buffer that is only written by the thread that
+ * draws, frame_count tells readers how many samples are valid.
+ *
+ * Usage:
+ *
+ * \code
+ *	profiler.beginFrame();
+ *	{
+ *		ProfileScope scope (ProfilePhaseDrawMeshes, true);
+ *		scene->drawMeshes();
+ *	}
+ *	profiler.endFrame();
+ * \endcode
+ */
+struct Profiler {
+	Profiler();
+
+	static const unsigned int HistorySize = 256;
+	static const unsigned int QueryLatency = 4;
+
+	/// Whether phases are timed
+	bool enabled;
+	/// Whether GLWidget draws the averages on top of the scene
+	bool show_overlay;
+
+	/// Times of one frame in milliseconds (negative if not measured)
+	struct Sample {
+		unsigned int frame;
+		float cpu[ProfilePhaseCount];
+		float gpu[ProfilePhaseCount];
+	};
+
+	/// Average and maximum times over a number of frames in milliseconds
+	/// (negative if not measured)
+	struct Summary {
+		unsigned int frame_count;
+		float cpu_average[ProfilePhaseCount];
+		float cpu_max[ProfilePhaseCount];
+		float gpu_average[ProfilePhaseCount];
+	};
+
+	Sample history[HistorySize];
+	/// Number of finished frames, the last one is stored in
+	/// history[(frame_count - 1) % HistorySize]
+	std::atomic<unsigned int> frame_count;
+
+	/// Enables or disables profiling and clears the history
+	void setEnabled (bool enable);
+
+	void beginFrame();
+	/// Stores the times of the current frame in the history
+	void endFrame();
+
+	void beginPhase (ProfilePhase phase, bool gpu);
+	void endPhase (ProfilePhase phase, bool gpu);
+
+	/// Averages of the last frames (at most HistorySize)
+	Summary summarize (unsigned int frames = 60) const;
+	/// Writes all frames of the history to a CSV file, returns false if
+	/// the file could not be written
+	bool writeCSV (const char *filename) const;
+
+	static const char* phaseName (ProfilePhase phase);
+
+	/// Frees the GPU queries (requires a current GL context)
+	void destroy();
+
+	Sample current;
+	TimerInfo phase_timers[ProfilePhaseCount];
+
+	struct GPUQuery {
+		unsigned int id;
+		ProfilePhase phase;
+		unsigned int frame;
+	};
+
+	/// Queries issued QueryLatency frames ago or more
+	std::vector<GPUQuery> pending_queries[QueryLatency];
+	std::vector<unsigned int> free_queries;
+	/// Query of the currently timed GPU phase
+	GPUQuery active_query;
+	bool gpu_active;
+	/// -1 if unknown, 0 if not supported
+	int gpu_supported;
+
+	void clearSample (Sample &sample);
+	/// Adds the results of the queries of a frame slot to the history
+	void collectQueries (unsigned int slot);
+};
+
+extern Profiler profiler;
+
+/** \brief Adds the time until the end of the scope to a phase of the
+ * profiler. If gpu is true the GPU time is measured too (requires a
+ * current GL context).
+ */
+struct ProfileScope {
+	ProfileScope (ProfilePhase phase, bool gpu = false) :
+		phase (phase),
+		gpu (gpu),
+		active (profiler.enabled) {
+		if (active)
+			profiler.beginPhase (phase, gpu);
+	}
+	~ProfileScope() {
+		if (active)
+			profiler.endPhase (phase, gpu);
+	}
+
+	ProfilePhase phase;
+	bool gpu;
+	bool active;
+};
+
+#endif
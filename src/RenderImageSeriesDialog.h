@@ -11,6 +11,7 @@
 #define RENDERIMAGESERIESDIALOG_H
  
  
+#include "ImageFile.h"
 
 #include "ui_RenderImageSeriesDialog.h"
 
@@ -22,5 +23,14 @@ public:
 			setupUi(this);
 		}
 
+		/// The items of formatComboBox are in the order of ImageFileFormat
+		ImageFileFormat imageFormat() {
+			return static_cast<ImageFileFormat>(formatComboBox->currentIndex());
+		}
+
+		void setImageFormat (ImageFileFormat format) {
+			formatComboBox->setCurrentIndex (format);
+		}
+
 };
 #endif
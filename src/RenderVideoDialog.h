@@ -9,6 +9,8 @@
 #include <QSpinBox>
 #include <QAbstractButton>
 
+#include "QVideoEncoderSettings.h"
+
 class RenderVideoDialog;
 
 #include "ui_RenderVideoDialog.h"
@@ -22,12 +24,69 @@ class RenderVideoDialog : public QDialog, public Ui::RenderVideoDialog {
 			setupUi(this);
 			connect(HeightSpinBox, SIGNAL(valueChanged(int)), this, SLOT(checkValues()));
 			connect(WidthSpinBox, SIGNAL(valueChanged(int)), this, SLOT(checkValues()));
+			connect(codecComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(updateRateControl()));
+			connect(rateControlComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(updateRateControl()));
+			connect(gpuConversionCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateScaler()));
 			checkValues();
+			updateRateControl();
+			updateScaler();
 		}
 		void set_video_lenght(double len) {
 			TimeSpinBox->setValue(len);
 		}
 
+		/// Order of the items in threadTypeComboBox
+		static QVideoEncoderSettings::ThreadType threadTypeAt (int index) {
+			if (index == 1)
+				return QVideoEncoderSettings::ThreadFrame;
+			else if (index == 2)
+				return QVideoEncoderSettings::ThreadSlice;
+
+			return QVideoEncoderSettings::ThreadFrameAndSlice;
+		}
+
+		QVideoEncoderSettings encoderSettings() {
+			QVideoEncoderSettings settings;
+			settings.codec = codecComboBox->currentIndex() == 1 ? QVideoEncoderSettings::CodecMPEG4 : QVideoEncoderSettings::CodecH264;
+			settings.crf = rateControlComboBox->currentIndex() == 0 ? crfSpinBox->value() : -1;
+			settings.bitrate = bitrateSpinBox->value() * 1000;
+			settings.gop = gopSpinBox->value();
+			settings.bframes = bFramesSpinBox->value();
+			settings.threads = threadsSpinBox->value();
+			settings.thread_type = threadTypeAt (threadTypeComboBox->currentIndex());
+			// same order as the items of scalerComboBox
+			settings.scaler = static_cast<QVideoEncoderSettings::Scaler>(scalerComboBox->currentIndex());
+
+			return settings;
+		}
+
+		void setEncoderSettings (const QVideoEncoderSettings &settings) {
+			codecComboBox->setCurrentIndex (settings.codec == QVideoEncoderSettings::CodecMPEG4 ? 1 : 0);
+			rateControlComboBox->setCurrentIndex (settings.crf < 0 ? 1 : 0);
+			if (settings.crf >= 0)
+				crfSpinBox->setValue (settings.crf);
+			bitrateSpinBox->setValue (settings.bitrate / 1000);
+			gopSpinBox->setValue (settings.gop);
+			bFramesSpinBox->setValue (settings.bframes);
+			threadsSpinBox->setValue (settings.threads);
+			for (int i = 0; i < threadTypeComboBox->count(); i++) {
+				if (threadTypeAt (i) == settings.thread_type)
+					threadTypeComboBox->setCurrentIndex (i);
+			}
+			scalerComboBox->setCurrentIndex (settings.scaler);
+			updateRateControl();
+		}
+
+		/// Whether the framebuffer is converted to YUV by a shader instead
+		/// of the scaler
+		bool gpuConversion() {
+			return gpuConversionCheckBox->isChecked();
+		}
+
+		void setGpuConversion (bool gpu_conversion) {
+			gpuConversionCheckBox->setChecked (gpu_conversion);
+		}
+
 	public slots:
 		void checkValues() {
 			QAbstractButton *accept_but;
@@ -46,5 +105,22 @@ class RenderVideoDialog : public QDialog, public Ui::RenderVideoDialog {
 			}
 		}
 
+		/// The constant rate factor is only supported by H.264
+		void updateRateControl() {
+			bool h264 = codecComboBox->currentIndex() == 0;
+			if (!h264)
+				rateControlComboBox->setCurrentIndex(1);
+			rateControlComboBox->setEnabled(h264);
+
+			bool use_crf = rateControlComboBox->currentIndex() == 0;
+			crfSpinBox->setEnabled(use_crf);
+			bitrateSpinBox->setEnabled(!use_crf);
+		}
+
+		/// The scaler is not used if the GPU converts the frames
+		void updateScaler() {
+			scalerComboBox->setEnabled(!gpuConversionCheckBox->isChecked());
+		}
+
 };
 #endif
@@ -3,6 +3,9 @@
 #include "Model.h"
 #include "Animation.h"
 #include "ForcesTorques.h"
+#include "ShaderRenderer.h"
+#include "LineBuffer.h"
+#include "Profiler.h"
 #include "GL/glew.h"
 
 #include <iostream>
@@ -16,13 +19,28 @@ void Scene::setCurrentTime (double t){
 	}
 }
 
-void Scene::drawMeshes() {
+void Scene::drawMeshes(ShaderRenderer *renderer) {
+	ProfileScope profile_scope (ProfilePhaseDrawMeshes, true);
+
 	Vector3f offset_start (0.f, 0.f, 0.f);
 	
 	if (models.size() > 1) {
 		offset_start = - model_displacement * models.size() * 0.5;
 	}
 
+	if (renderer) {
+		renderer->beginFrame();
+
+		Vector3f offset = offset_start;
+		for (unsigned int i = 0; i < models.size(); i++) {
+			offset += model_displacement;
+			renderer->addModel (*models[i], SimpleMath::GL::TranslateMat44 (offset[0], offset[1], offset[2]));
+		}
+
+		renderer->endFrame();
+		return;
+	}
+
 	glPushMatrix();
 	glTranslatef (offset_start[0], offset_start[1], offset_start[2]);
 
@@ -34,79 +52,94 @@ void Scene::drawMeshes() {
 	glPopMatrix();
 }
 
-void Scene::drawBaseFrameAxes(){
-	Vector3f offset_start (0.f, 0.f, 0.f);
+void Scene::drawAxes(bool base_frames) {
+	Vector3f offset (0.f, 0.f, 0.f);
 	
 	if (models.size() > 1) {
-		offset_start = - model_displacement * models.size() * 0.5;
+		offset = - model_displacement * models.size() * 0.5;
 	}
 
-	glPushMatrix();
-	glTranslatef (offset_start[0], offset_start[1], offset_start[2]);
+	line_buffer.clear();
 
 	for (unsigned int i = 0; i < models.size(); i++) {
-		glTranslatef (model_displacement[0], model_displacement[1], model_displacement[2]);
-		models[i]->drawBaseFrameAxes();
+		offset += model_displacement;
+		Matrix44f transform = SimpleMath::GL::TranslateMat44 (offset[0], offset[1], offset[2]);
+
+		if (base_frames)
+			models[i]->addBaseFrameAxes (line_buffer, transform);
+		else
+			models[i]->addFrameAxes (line_buffer, transform);
 	}
 
-	glPopMatrix();
-}
+	// backup the depth test and lighting values
+	bool depth_test_enabled = glIsEnabled (GL_DEPTH_TEST);
+	if (depth_test_enabled)
+		glDisable (GL_DEPTH_TEST);
 
-void Scene::drawFrameAxes(){
-	Vector3f offset_start (0.f, 0.f, 0.f);
-	
-	if (models.size() > 1) {
-		offset_start = - model_displacement * models.size() * 0.5;
-	}
+	bool light_enabled = glIsEnabled (GL_LIGHTING);
+	if (light_enabled)
+		glDisable (GL_LIGHTING);
 
-	glPushMatrix();
-	glTranslatef (offset_start[0], offset_start[1], offset_start[2]);
+	line_buffer.draw();
 
-	for (unsigned int i = 0; i < models.size(); i++) {
-		glTranslatef (model_displacement[0], model_displacement[1], model_displacement[2]);
-		models[i]->drawFrameAxes();
-	}
+	if (depth_test_enabled)
+		glEnable (GL_DEPTH_TEST);
 
-	glPopMatrix();
+	if (light_enabled)
+		glEnable (GL_LIGHTING);
 }
 
-void Scene::drawPoints(){
-	Vector3f offset_start (0.f, 0.f, 0.f);
+void Scene::drawBaseFrameAxes(){
+	drawAxes (true);
+}
+
+void Scene::drawFrameAxes(){
+	drawAxes (false);
+}
+
+void Scene::drawPoints(ShaderRenderer *renderer){
+	Vector3f offset (0.f, 0.f, 0.f);
 	
 	if (models.size() > 1) {
-		offset_start = - model_displacement * models.size() * 0.5;
+		offset = - model_displacement * models.size() * 0.5;
 	}
 
-	glPushMatrix();
-	glTranslatef (offset_start[0], offset_start[1], offset_start[2]);
+	line_buffer.clear();
+	point_transforms.clear();
+	point_colors.clear();
 
 	for (unsigned int i = 0; i < models.size(); i++) {
-		glTranslatef (model_displacement[0], model_displacement[1], model_displacement[2]);
-		models[i]->drawPoints();
+		offset += model_displacement;
+		models[i]->addPoints (line_buffer, point_transforms, point_colors, SimpleMath::GL::TranslateMat44 (offset[0], offset[1], offset[2]));
 	}
 
-	glPopMatrix();
+	line_buffer.draw();
+
+	draw_mesh_instances (&point_mesh, point_transforms, point_colors, renderer);
 }
 
 void Scene::drawCurves(){
-	Vector3f offset_start (0.f, 0.f, 0.f);
+	ProfileScope profile_scope (ProfilePhaseDrawCurves, true);
+
+	Vector3f offset (0.f, 0.f, 0.f);
 	
 	if (models.size() > 1) {
-		offset_start = - model_displacement * models.size() * 0.5;
+		offset = - model_displacement * models.size() * 0.5;
 	}
 
-	glPushMatrix();
-	glTranslatef (offset_start[0], offset_start[1], offset_start[2]);
+	curve_renderer.beginFrame();
 
 	for (unsigned int i = 0; i < models.size(); i++) {
-		glTranslatef (model_displacement[0], model_displacement[1], model_displacement[2]);
-		models[i]->drawCurves();
+		offset += model_displacement;
+		curve_renderer.addModel (*models[i], SimpleMath::GL::TranslateMat44 (offset[0], offset[1], offset[2]));
 	}
 
-	glPopMatrix();
+	curve_renderer.endFrame();
 }
 
-void Scene::drawForces() {
+void Scene::drawForces(ShaderRenderer *renderer) {
+	ProfileScope profile_scope (ProfilePhaseDrawArrows, true);
+
 	Vector3f offset_start (0.f, 0.f, 0.f);
 	
 	if (models.size() > 1) {
@@ -121,18 +154,17 @@ void Scene::drawForces() {
 	glDepthMask(GL_FALSE);
 	glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
 
+	arrow_creator.clearArrows();
+
+	Vector3f offset (0.f, 0.f, 0.f);
 	for (int i = 0; i < forcesTorquesQueue.size(); i++) {
-		glTranslatef (model_displacement[0], model_displacement[1], model_displacement[2]);
-		Matrix33f baseChange = models[i]->configuration.axes_rotation;
-		ArrowList forces = forcesTorquesQueue[i]->getForcesAtTime(current_time);
-		for (int j = 0; j < forces.arrows.size(); j++) {
-			Arrow changed = forces.arrows[j]->createBaseChangedArrow(baseChange);
-			if (changed.direction.norm() > forcesTorquesQueue[i]->force_threshold) {
-				arrow_creator.drawArrow(&arrow_creator.arrow3d, changed, forcesTorquesQueue[i]->force_properties);
-			}
-		}
+		offset += model_displacement;
+		forcesTorquesQueue[i]->getForcesAtTime(current_time, current_arrows);
+		arrow_creator.addArrows (current_arrows, models[i]->configuration.axes_rotation, offset, forcesTorquesQueue[i]->force_threshold, forcesTorquesQueue[i]->force_properties);
 	}
 
+	arrow_creator.drawArrows (&arrow_creator.arrow3d, renderer);
+
 	glDepthMask(GL_TRUE);
 	if (!blend_enabled) {
 		glDisable(GL_BLEND);
@@ -141,7 +173,9 @@ void Scene::drawForces() {
 	glPopMatrix();
 }
 
-void Scene::drawTorques() {
+void Scene::drawTorques(ShaderRenderer *renderer) {
+	ProfileScope profile_scope (ProfilePhaseDrawArrows, true);
+
 	Vector3f offset_start (0.f, 0.f, 0.f);
 	
 	if (models.size() > 1) {
@@ -156,17 +190,17 @@ void Scene::drawTorques() {
 	glDepthMask(GL_FALSE);
 	glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
 
+	arrow_creator.clearArrows();
+
+	Vector3f offset (0.f, 0.f, 0.f);
 	for (int i = 0; i < forcesTorquesQueue.size(); i++) {
-		glTranslatef (model_displacement[0], model_displacement[1], model_displacement[2]);
-		Matrix33f baseChange = models[i]->configuration.axes_rotation;
-		ArrowList torques = forcesTorquesQueue[i]->getTorquesAtTime(current_time);
-		for (int j = 0; j < torques.arrows.size(); j++) {
-			if (torques.arrows[j]->direction.norm() > forcesTorquesQueue[i]->torque_threshold) {
-				arrow_creator.drawArrow(&arrow_creator.circle_arrow3d, torques.arrows[j]->createBaseChangedArrow(baseChange), forcesTorquesQueue[i]->torque_properties);
-			}
-		}
+		offset += model_displacement;
+		forcesTorquesQueue[i]->getTorquesAtTime(current_time, current_arrows);
+		arrow_creator.addArrows (current_arrows, models[i]->configuration.axes_rotation, offset, forcesTorquesQueue[i]->torque_threshold, forcesTorquesQueue[i]->torque_properties);
 	}
 
+	arrow_creator.drawArrows (&arrow_creator.circle_arrow3d, renderer);
+
 	glDepthMask(GL_TRUE);
 	if (!blend_enabled) {
 		glDisable(GL_BLEND);
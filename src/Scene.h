@@ -5,37 +5,59 @@
 
 #include "Math.h"
 #include "Arrow.h"
+#include "LineBuffer.h"
+#include "CurveRenderer.h"
 
 struct Animation;
 struct MeshupModel;
 struct ForcesTorques;
+struct ShaderRenderer;
 
 struct Scene {
 	Scene() :
 		current_time (0.f),
 		longest_animation (0.f),
-		model_displacement (0.f, 0.f, -1.f)
+		model_displacement (0.f, 0.f, -1.f),
+		point_mesh (CreateUVSphere (16, 16))
 	{};
 	float current_time;
 	float longest_animation;
 	Vector3f model_displacement;
 	ArrowCreator arrow_creator;
+	/// Forces or torques at the current time (reused for every model)
+	ArrowList current_arrows;
 	bool drawingForces;
 	bool drawingTorques;
 
+	/// Axes and point lines of the current frame
+	LineBuffer line_buffer;
+	/// Unit sphere that marks the points
+	MeshVBO point_mesh;
+	std::vector<Matrix44f> point_transforms;
+	std::vector<Vector4f> point_colors;
+	/// Draws the curves of all models from a shared buffer
+	CurveRenderer curve_renderer;
+
 	std::vector<Animation*> animations;
 	std::vector<MeshupModel*> models;
 	std::vector<ForcesTorques*> forcesTorquesQueue;
 
 	void setCurrentTime (double t);
 
-	void drawMeshes();
+	/// Draws the meshes of all models using the renderer or the fixed
+	/// function pipeline if renderer is NULL
+	void drawMeshes(ShaderRenderer *renderer = NULL);
+	/// Draws the axes of all frames of all models with a single draw call
+	void drawAxes(bool base_frames);
 	void drawBaseFrameAxes();
 	void drawFrameAxes();
-	void drawPoints();
+	/// Draws the point lines with a single draw call and the point
+	/// spheres with the renderer (if not NULL)
+	void drawPoints(ShaderRenderer *renderer = NULL);
+	/// Draws the curves with one draw call per model (and line width)
 	void drawCurves();
-	void drawForces();
-	void drawTorques();
+	void drawForces(ShaderRenderer *renderer = NULL);
+	void drawTorques(ShaderRenderer *renderer = NULL);
 };
 
 #endif
@@ -0,0 +1,451 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "GL/glew.h"
+
+#include "SceneRenderer.h"
+
+#include <iostream>
+#include <cmath>
+#include <assert.h>
+
+#ifdef __APPLE__
+#include <OpenGL/glu.h>
+#else
+#include <GL/glu.h>
+#endif
+
+#include "Camera.h"
+#include "MeshVBO.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "ShaderRenderer.h"
+#include "ShadowMap.h"
+
+using namespace std;
+
+Vector4f light_ka (0.2f, 0.2f, 0.2f, 1.0f);
+Vector4f light_kd (0.7f, 0.7f, 0.7f, 1.0f);
+Vector4f light_ks (1.0f, 1.0f, 1.0f, 1.0f);
+
+SceneRenderer::SceneRenderer() :
+	scene (NULL),
+	draw_base_axes (false),
+	draw_frame_axes (false),
+	draw_grid (false),
+	draw_floor (true),
+	draw_meshes (true),
+	draw_shadows (false),
+	draw_curves (false),
+	draw_points (true),
+	draw_forces (true),
+	draw_torques (true),
+	white_mode (false),
+	use_shader_renderer (true),
+	shader_renderer (NULL),
+	shadow_map (new ShadowMap()),
+	light_position (0.f, 3.f, 5.f, 1.f),
+	floor_mesh (NULL),
+	floor_white_mode (false),
+	grid_mesh (NULL)
+{}
+
+SceneRenderer::~SceneRenderer() {
+	delete floor_mesh;
+	delete grid_mesh;
+	delete shadow_map;
+	delete shader_renderer;
+}
+
+bool SceneRenderer::initGL() {
+	if (!GLEW_ARB_shadow) {
+		cerr << "Error: ARB_shadow not supported!" << endl;
+		return false;
+	}
+	if (!GLEW_ARB_depth_texture) {
+		cerr << "Error: ARB_depth_texture not supported!" << endl;
+		return false;
+	}
+
+	glMatrixMode (GL_PROJECTION);
+	glLoadIdentity ();
+
+	glMatrixMode (GL_MODELVIEW);
+	glLoadIdentity();
+
+	glShadeModel (GL_SMOOTH);
+	glClearColor (0.f, 0.f, 0.f, 0.f);
+	glColor4f (1.f, 1.f, 1.f, 1.f);
+	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
+
+	glClearDepth(1.0f);
+	glDepthFunc(GL_LEQUAL);
+	glEnable (GL_DEPTH_TEST);
+	
+	//Disabled, to see the flipped vertices in model
+	//glEnable (GL_CULL_FACE);
+
+	glEnable (GL_NORMALIZE);
+
+	glColorMaterial (GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+	glEnable (GL_COLOR_MATERIAL);
+	glMaterialfv(GL_FRONT, GL_SPECULAR, Vector4f (1.f, 1.f, 1.f, 1.f).data());
+	glMaterialf(GL_FRONT, GL_SHININESS, 16.0f);
+
+	// initialize lights
+	glLightfv(GL_LIGHT0, GL_AMBIENT,  light_ka.data());
+	glLightfv(GL_LIGHT0, GL_DIFFUSE,  light_kd.data());
+	glLightfv(GL_LIGHT0, GL_SPECULAR, light_ks.data());
+
+	glLightfv (GL_LIGHT0, GL_POSITION, light_position.data());
+
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+
+	glEnable(GL_DEPTH_CLAMP);
+
+	shader_renderer = new ShaderRenderer();
+	if (!shader_renderer->init()) {
+		delete shader_renderer;
+		shader_renderer = NULL;
+	}
+
+	shadow_map->init();
+
+	return true;
+}
+
+void SceneRenderer::setClearColor (bool transparent) {
+	float alpha = transparent ? 0.f : 1.f;
+
+	if (white_mode) {
+		glClearColor (1.f, 1.f, 1.f, alpha);
+	} else {
+		glClearColor (0.f, 0.f, 0.f, alpha);
+	}
+}
+
+/** Creates the checkers board floor. The color fades to the background
+ * color with the distance from the origin. */
+MeshVBO create_checkers_board_mesh (bool white_mode) {
+	float length = 16.f;
+	int count = 32;
+	float xmin (-length),
+				xmax (length),
+				xstep (fabs (xmin - xmax) / float(count)),
+				zmin (-length),
+				zstep (fabs (xmin -xmax) / float (count));
+
+	float shade_start = 3.;
+	float shade_width = 5.f;
+	float m = 1.f / (shade_width);
+	Vector4f clear_color;
+
+	if (white_mode)
+		clear_color.set (1.f, 1.f, 1.f, 1.f);
+	else
+		clear_color.set (0.f, 0.f, 0., 1.f);
+
+	Vector4f ground_color (0.5f, 0.5f, 0.5f, 1.f);
+	Vector3f normal (0.f, 1.f, 0.f);
+
+	MeshVBO result;
+	result.begin();
+	result.reserve (count * count / 2 * 6, true, true);
+
+	for (int i = 0; i < count; i++) {
+		float x_shift = (i % 2) * xstep;
+		for (int j = 0; j < count; j = j+2) {
+			Vector3f v0 (j * xstep + xmin + x_shift, 0., i * zstep + zmin);
+			Vector3f v1 (j * xstep + xmin + x_shift, 0., (i + 1) * zstep + zmin);
+			Vector3f v2 ((j + 1) * xstep + xmin + x_shift, 0., (i + 1) * zstep + zmin);
+			Vector3f v3 ((j + 1) * xstep + xmin + x_shift, 0., i * zstep + zmin);
+
+			float distance = (v0 * 0.5 + v2 * 0.5).norm();
+			float alpha = 1.;
+
+			if (distance > shade_start) {
+				alpha = 1. - m * (distance - shade_start);
+				if (alpha < 0.f)
+					alpha = 0.f;
+			}
+
+			assert (alpha >= 0.f &&  alpha <= 1.f);
+
+			Vector4f color = (1.f - alpha) * clear_color + ground_color * alpha;
+
+			const Vector3f *quad[6] = { &v0, &v1, &v2, &v0, &v2, &v3 };
+			for (int k = 0; k < 6; k++) {
+				result.addVertex3fv (quad[k]->data());
+				result.addNormalfv (normal.data());
+				result.addColor4fv (color.data());
+			}
+		}
+	}
+
+	result.end();
+
+	return result;
+}
+
+void SceneRenderer::drawFloor(ShaderRenderer *renderer) {
+	if (floor_mesh == NULL || floor_white_mode != white_mode) {
+		delete floor_mesh;
+		floor_mesh = new MeshVBO (create_checkers_board_mesh (white_mode));
+		floor_white_mode = white_mode;
+	}
+
+	glDisable (GL_LIGHTING);
+	glEnable(GL_DEPTH_TEST);
+
+	if (renderer) {
+		renderer->beginFrame();
+		renderer->addInstance (floor_mesh, Matrix44f::Identity(), Vector4f (1.f, 1.f, 1.f, 1.f));
+		renderer->endFrame();
+	} else {
+		floor_mesh->draw (GL_TRIANGLES);
+	}
+
+	glEnable (GL_LIGHTING);
+}
+
+/** Creates the lines of the grid on the floor. */
+MeshVBO create_grid_mesh () {
+	float xmin, xmax, xstep, zmin, zmax, zstep;
+	int i, count;
+
+	xmin = -16;
+	xmax = 16;
+	zmin = -16;
+	zmax = 16;
+
+	count = 32;
+
+	xstep = fabs (xmin - xmax) / (float)count;
+	zstep = fabs (zmin - zmax) / (float)count;
+
+	MeshVBO result;
+	result.begin();
+	result.reserve ((count + 1) * 4, false, true);
+
+	for (i = 0; i <= count; i++) {
+		result.addVertex3f (i * xstep + xmin, 0., zmin);
+		result.addColor3f (0.2f, 0.2f, 0.2f);
+		result.addVertex3f (i * xstep + xmin, 0., zmax);
+		result.addColor3f (0.2f, 0.2f, 0.2f);
+		result.addVertex3f (xmin, 0, i * zstep + zmin);
+		result.addColor3f (0.2f, 0.2f, 0.2f);
+		result.addVertex3f (xmax, 0, i * zstep + zmin);
+		result.addColor3f (0.2f, 0.2f, 0.2f);
+	}
+
+	result.end();
+
+	return result;
+}
+
+void SceneRenderer::drawGrid() {
+	if (grid_mesh == NULL)
+		grid_mesh = new MeshVBO (create_grid_mesh());
+
+	float line_width;
+	glGetFloatv (GL_LINE_WIDTH, &line_width);
+
+	glDisable (GL_LIGHTING);
+	glLineWidth(2.f);
+	grid_mesh->draw (GL_LINES);
+	glLineWidth (line_width);
+	glEnable (GL_LIGHTING);
+}
+
+void SceneRenderer::drawScene() {
+	if (!scene) {
+		return;
+	}
+
+	if (draw_grid) {
+		drawGrid();
+	}
+
+	ShaderRenderer *renderer = NULL;
+	if (use_shader_renderer)
+		renderer = shader_renderer;
+
+	// meshes and floor receive shadows
+	if (renderer && draw_shadows && shadow_map->initialized)
+		renderer->shadow_map = shadow_map;
+
+	if (draw_floor) {
+		drawFloor(renderer);
+	}
+
+	if (draw_meshes) {
+		scene->drawMeshes(renderer);
+	}
+
+	if (renderer)
+		renderer->shadow_map = NULL;
+
+	if (draw_base_axes) {
+		scene->drawBaseFrameAxes();
+	}
+	if (draw_frame_axes) {
+		scene->drawFrameAxes();
+	}
+
+	bool depth_test_enabled = glIsEnabled (GL_DEPTH_TEST);
+	if (depth_test_enabled) {
+		glDisable (GL_DEPTH_TEST);
+	}
+	glDisable (GL_LIGHTING);
+
+	if (draw_forces) {
+		scene->drawForces(renderer);
+	}
+	if (draw_torques) {
+		scene->drawTorques(renderer);
+	}
+	if (draw_points) {
+		scene->drawPoints(renderer);
+	}
+	if (draw_curves) {
+		scene->drawCurves();
+	}
+
+	glEnable (GL_LIGHTING);
+
+	if (depth_test_enabled){
+		glEnable (GL_DEPTH_TEST);
+	}
+}
+
+void SceneRenderer::renderShadowMap (const Camera *camera) {
+	ProfileScope profile_scope (ProfilePhaseShadows, true);
+
+	ShaderRenderer *renderer = NULL;
+	if (use_shader_renderer)
+		renderer = shader_renderer;
+
+	// texture coordinate generation can only use a single cascade
+	if (!renderer)
+		shadow_map->cascade_count = 1;
+
+	// the camera has already been set up
+	Matrix44f camera_view, camera_projection;
+	glGetFloatv (GL_MODELVIEW_MATRIX, camera_view.data());
+	glGetFloatv (GL_PROJECTION_MATRIX, camera_projection.data());
+
+	// all tiles of a large image use the shadow map of the whole view such
+	// that the shadows match at the borders of the tiles
+	if (camera->isTiled())
+		camera_projection = camera_projection * Matrix44f (camera->getTileMatrix().inverse());
+
+	shadow_map->update (camera_view, camera_projection, light_position);
+
+	if (renderer)
+		renderer->shadow_map = NULL;
+
+	// only the meshes cast shadows
+	for (unsigned int i = 0; i < shadow_map->cascade_count; i++) {
+		shadow_map->beginCascade (i);
+		scene->drawMeshes (renderer);
+		shadow_map->endCascade ();
+	}
+}
+
+void SceneRenderer::shadowMapSetupTexGen () {
+	// the eye planes are transformed by the inverse of the current
+	// modelview matrix (the camera view), i.e. they act on world
+	// coordinates
+	Matrix44f texture_matrix = shadow_map->world_to_shadow[0].transpose();
+
+	GLenum coords[4] = { GL_S, GL_T, GL_R, GL_Q };
+	GLenum coord_modes[4] = { GL_TEXTURE_GEN_S, GL_TEXTURE_GEN_T, GL_TEXTURE_GEN_R, GL_TEXTURE_GEN_Q };
+	for (int row_i = 0; row_i < 4; row_i++) {
+		Vector4f row (
+				texture_matrix(row_i,0),
+				texture_matrix(row_i,1),
+				texture_matrix(row_i,2),
+				texture_matrix(row_i,3)
+				);
+		glTexGeni(coords[row_i], GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
+		glTexGenfv(coords[row_i], GL_EYE_PLANE, row.data());
+		glEnable(coord_modes[row_i]);
+	}
+
+	// bind and enable shadow map texture
+	glBindTexture (GL_TEXTURE_2D, shadow_map->texture_id);
+	glEnable (GL_TEXTURE_2D);
+
+	// shadow comparison generates an INTENSITY result
+	glTexParameteri (GL_TEXTURE_2D, GL_DEPTH_TEXTURE_MODE_ARB, GL_INTENSITY);
+
+	// set alpha test to discard false comparisons
+	glAlphaFunc (GL_GEQUAL, 0.99f);
+	glEnable (GL_ALPHA_TEST);
+}
+
+void SceneRenderer::shadowMapCleanup() {
+	// reset the state
+	glDisable (GL_TEXTURE_2D);
+
+	glDisable (GL_TEXTURE_GEN_S);
+	glDisable (GL_TEXTURE_GEN_T);
+	glDisable (GL_TEXTURE_GEN_R);
+	glDisable (GL_TEXTURE_GEN_Q);
+
+	glDisable (GL_LIGHTING);
+	glDisable (GL_ALPHA_TEST);
+}
+
+void SceneRenderer::renderFrame (Camera *camera) {
+	glMatrixMode (GL_MODELVIEW);
+	glLoadIdentity();
+
+	camera->update();
+
+	glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glDisable (GL_CULL_FACE);
+
+	glLightfv(GL_LIGHT0, GL_POSITION, light_position.data());
+	glLightfv(GL_LIGHT0, GL_DIFFUSE,  light_kd.data());
+	glLightfv(GL_LIGHT0, GL_SPECULAR, light_ks.data());
+	glEnable(GL_LIGHT0);	
+	glEnable(GL_LIGHTING);
+
+	if (draw_shadows && scene && shadow_map->initialized) {
+		renderShadowMap (camera);
+	}
+
+	if (draw_shadows && shadow_map->initialized && !(use_shader_renderer && shader_renderer)) {
+		// fixed function fallback: draw with dim light and then draw the
+		// lit areas using the shadow map as alpha test
+		glLightfv(GL_LIGHT0, GL_DIFFUSE,  (light_kd * 0.1f).data());
+		glLightfv(GL_LIGHT0, GL_SPECULAR, Vector4f (0.f, 0.f, 0.f, 0.f).data());
+		drawScene();
+
+		glLightfv(GL_LIGHT0, GL_DIFFUSE,  light_kd.data());
+		glLightfv(GL_LIGHT0, GL_SPECULAR, light_ks.data());
+		shadowMapSetupTexGen();
+		drawScene();
+
+		shadowMapCleanup();
+	} else {
+		drawScene();
+	}
+
+	glDisable(GL_LIGHTING);
+
+	GLenum gl_error = glGetError();
+	if (gl_error != GL_NO_ERROR) {
+		cout << "OpenGL Error: " << gluErrorString(gl_error) << endl;
+		abort();
+	}
+}
@@ -0,0 +1,83 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_SCENERENDERER_H
+#define MESHUP_SCENERENDERER_H
+
+#include "Math.h"
+
+struct Scene;
+struct Camera;
+struct ShaderRenderer;
+struct ShadowMap;
+struct MeshVBO;
+
+/** \brief Draws a Scene with the floor, grid and shadows into the current
+ * OpenGL context.
+ *
+ * Does not depend on Qt such that it can be used by the GLWidget and by
+ * the headless renderer (see HeadlessRender.h). The caller sets up the
+ * context, the viewport and the size of the camera.
+ */
+struct SceneRenderer {
+	SceneRenderer();
+	/// Requires the context of initGL() to be current
+	virtual ~SceneRenderer();
+
+	Scene *scene;
+
+	bool draw_base_axes;
+	bool draw_frame_axes;
+	bool draw_grid;
+	bool draw_floor;
+	bool draw_meshes;
+	bool draw_shadows;
+	bool draw_curves;
+	bool draw_points;
+
+	bool draw_forces;
+	bool draw_torques;
+
+	bool white_mode;
+
+	/// Draw the meshes with the GLSL renderer (if supported)
+	bool use_shader_renderer;
+	/// NULL if shaders are not supported
+	ShaderRenderer *shader_renderer;
+	/// Size and number of cascades can be changed at any time
+	ShadowMap *shadow_map;
+
+	Vector4f light_position;
+
+	/// Initializes the OpenGL state, the shaders and the shadow map (GLEW
+	/// has to be initialized). Returns false if the context lacks required
+	/// features.
+	bool initGL();
+	/// Sets the clear color to the background color
+	void setClearColor (bool transparent);
+	/// Clears the current framebuffer and draws the scene as seen by the
+	/// camera
+	void renderFrame (Camera *camera);
+
+	void drawScene();
+	void drawGrid();
+	void drawFloor(ShaderRenderer *renderer);
+
+	/// Renders the depth of the meshes into the cascades of the shadow map
+	void renderShadowMap (const Camera *camera);
+	void shadowMapSetupTexGen();
+	void shadowMapCleanup();
+
+	MeshVBO *floor_mesh;
+	/// white_mode the floor mesh was created for
+	bool floor_white_mode;
+	MeshVBO *grid_mesh;
+};
+
+#endif
@@ -8,6 +8,8 @@
 #include "Animation.h"
 #include "Model.h"
 #include "Camera.h"
+#include "Profiler.h"
+#include "VideoExporter.h"
 
 #include <errno.h>
 
@@ -198,9 +200,10 @@ void scripting_load (lua_State *L, const int argc, char* argv[]) {
 }
 
 /***
- * Update function that gets called every frame before it is drawn. 
+ * Update function that gets called every frame before it is drawn and
+ * periodically (every 100 ms by default) while no frames are drawn.
  * @function meshup.update(dt)
- * @param dt the elapsed time in seconds since the last drawing update
+ * @param dt the elapsed time in seconds since the last update
 */
 void scripting_update (lua_State *L, float dt) {
 	assert (lua_gettop(L) == 0);
@@ -443,6 +446,8 @@ static int meshup_animation_addRawValues (lua_State *L) {
 	if (animation->duration < values[0])
 		animation->duration = values[0];
 
+	app_ptr->requestRedraw();
+
 	return 0;
 }
 
@@ -471,6 +476,8 @@ static int meshup_animation_setRawValuesAt (lua_State *L) {
 	// TODO: properly check whether values are still ordered in time?
 	if (animation->duration < values[0])
 		animation->duration = values[0];
+
+	app_ptr->requestRedraw();
 	
 	return 0;
 }
@@ -686,6 +693,7 @@ static int meshup_setCurrentTime (lua_State *L) {
 	double time  = luaL_checknumber (L, 1);
 
 	app_ptr->glWidget->scene->setCurrentTime (time);
+	app_ptr->requestRedraw();
 
 	return 0;
 }
@@ -704,6 +712,7 @@ static int meshup_setLightPosition (lua_State *L) {
 	coords[3] = 1.;
 
 	app_ptr->glWidget->light_position = coords;
+	app_ptr->requestRedraw();
 
 	return 0;
 }
@@ -714,7 +723,9 @@ static int meshup_setLightPosition (lua_State *L) {
 // @param width (optional)
 // @param height (optional)
 // @param transparency (optional) whether black should be transparent
-// Makes a screenshot and stores as PNG file.
+// Makes a screenshot and stores as PNG file. Images larger than 2048
+// pixels in either direction are rendered in tiles and can also be
+// written as .tga or .ppm.
 static int meshup_saveScreenshot (lua_State *L) {
 	string filename = luaL_checkstring (L, 1);
 
@@ -751,10 +762,186 @@ static int meshup_setModelDisplacement (lua_State *L) {
 	coords[2] = luaL_checknumber (L, 3);
 
 	app_ptr->scene->model_displacement = coords;
+	app_ptr->requestRedraw();
+
+	return 0;
+}
+
+/// Request drawing of a new frame.
+// @function meshup.requestRedraw
+// MeshUp only draws a frame if something changed. Functions of this
+// module that modify the scene request the redraw themselves, scripts
+// that change anything else in meshup.update() have to call this
+// function.
+static int meshup_requestRedraw (lua_State *L) {
+	app_ptr->requestRedraw();
+
+	return 0;
+}
+
+/// Enable or disable the frame profiler.
+// @function meshup.setProfiling
+// @param enabled whether the phases of each frame are timed
+// @param overlay (optional) whether the averages are shown on top of the
+// scene
+// Enabling the profiler clears all previously recorded frames.
+static int meshup_setProfiling (lua_State *L) {
+	profiler.setEnabled (lua_toboolean (L, 1));
+
+	if (lua_gettop(L) > 1)
+		profiler.show_overlay = lua_toboolean (L, 2);
+
+	app_ptr->requestRedraw();
+
+	return 0;
+}
+
+/// Get the times of the profiled frames.
+// @function meshup.getProfile
+// @param frames (optional) number of recent frames that are averaged
+// (default 60)
+// Returns a table with the number of averaged frames (field frames) and
+// a table for each phase (e.g. draw_meshes, update_frames) with the
+// fields cpu (average), cpu_max and gpu (average, only if measured) in
+// milliseconds.
+static int meshup_getProfile (lua_State *L) {
+	unsigned int frames = 60;
+	if (lua_gettop(L) > 0 && !lua_isnil(L, 1))
+		frames = luaL_checkint (L, 1);
+
+	Profiler::Summary summary = profiler.summarize (frames);
+
+	lua_newtable (L);
+
+	lua_pushnumber (L, summary.frame_count);
+	lua_setfield (L, -2, "frames");
+
+	for (unsigned int i = 0; i < ProfilePhaseCount; i++) {
+		lua_newtable (L);
+
+		lua_pushnumber (L, summary.cpu_average[i]);
+		lua_setfield (L, -2, "cpu");
+		lua_pushnumber (L, summary.cpu_max[i]);
+		lua_setfield (L, -2, "cpu_max");
+
+		if (summary.gpu_average[i] >= 0.f) {
+			lua_pushnumber (L, summary.gpu_average[i]);
+			lua_setfield (L, -2, "gpu");
+		}
+
+		lua_setfield (L, -2, Profiler::phaseName (static_cast<ProfilePhase>(i)));
+	}
+
+	return 1;
+}
+
+/// Write the times of the recorded frames to a CSV file.
+// @function meshup.writeProfile
+// @param filename
+// Contains one line per frame (at most the last 256) with the CPU and
+// GPU time of every phase in milliseconds.
+static int meshup_writeProfile (lua_State *L) {
+	string filename = luaL_checkstring (L, 1);
+
+	if (!profiler.writeCSV (filename.c_str()))
+		luaL_error (L, "Could not write profile to file %s", filename.c_str());
+
+	return 0;
+}
+
+/// Reads the field name of the table at index into value if it is not nil
+static void get_number_field (lua_State *L, int index, const char *name, int &value) {
+	lua_getfield (L, index, name);
+	if (!lua_isnil (L, -1))
+		value = luaL_checkint (L, -1);
+	lua_pop (L, 1);
+}
+
+static void get_number_field (lua_State *L, int index, const char *name, unsigned int &value) {
+	int int_value = value;
+	get_number_field (L, index, name, int_value);
+	if (int_value < 0)
+		luaL_error (L, "Field %s must not be negative", name);
+	value = int_value;
+}
+
+/// Change the encoder settings of the video export.
+// @function meshup.setVideoSettings
+// @param settings table with any of the fields codec ("h264" or
+// "mpeg4"), crf (constant rate factor of H.264 from 0 to 51 or -1 to use
+// the bitrate), bitrate (bits per second), gop (maximal number of frames
+// between keyframes), b_frames, threads (0 for one per core),
+// thread_type ("frame", "slice" or "frame+slice"), scaler (filter of the
+// color conversion: "fast_bilinear", "bilinear", "bicubic" or "point") and
+// gpu_conversion (boolean, converts to YUV in a shader instead)
+// Fields that are not given keep their value. The settings are also used
+// by the render video dialog and saved in the settings file.
+static int meshup_setVideoSettings (lua_State *L) {
+	luaL_checktype (L, 1, LUA_TTABLE);
+
+	QVideoEncoderSettings settings = app_ptr->videoEncoderSettings();
+
+	lua_getfield (L, 1, "codec");
+	if (!lua_isnil (L, -1) && !parse_video_codec (luaL_checkstring (L, -1), settings.codec))
+		luaL_error (L, "Invalid codec '%s' (expected h264 or mpeg4)", lua_tostring (L, -1));
+	lua_pop (L, 1);
+
+	get_number_field (L, 1, "crf", settings.crf);
+	get_number_field (L, 1, "bitrate", settings.bitrate);
+	get_number_field (L, 1, "gop", settings.gop);
+	get_number_field (L, 1, "b_frames", settings.bframes);
+	get_number_field (L, 1, "threads", settings.threads);
+
+	lua_getfield (L, 1, "thread_type");
+	if (!lua_isnil (L, -1) && !parse_video_thread_type (luaL_checkstring (L, -1), settings.thread_type))
+		luaL_error (L, "Invalid thread_type '%s' (expected frame, slice or frame+slice)", lua_tostring (L, -1));
+	lua_pop (L, 1);
+
+	lua_getfield (L, 1, "scaler");
+	if (!lua_isnil (L, -1) && !parse_video_scaler (luaL_checkstring (L, -1), settings.scaler))
+		luaL_error (L, "Invalid scaler '%s' (expected fast_bilinear, bilinear, bicubic or point)", lua_tostring (L, -1));
+	lua_pop (L, 1);
+
+	lua_getfield (L, 1, "gpu_conversion");
+	if (!lua_isnil (L, -1))
+		app_ptr->setVideoGpuConversion (lua_toboolean (L, -1));
+	lua_pop (L, 1);
+
+	app_ptr->setVideoEncoderSettings (settings);
 
 	return 0;
 }
 
+/// Get the encoder settings of the video export.
+// @function meshup.getVideoSettings
+// @return table with the fields described in meshup.setVideoSettings
+static int meshup_getVideoSettings (lua_State *L) {
+	QVideoEncoderSettings settings = app_ptr->videoEncoderSettings();
+
+	lua_newtable (L);
+
+	lua_pushstring (L, video_codec_name (settings.codec));
+	lua_setfield (L, -2, "codec");
+	lua_pushnumber (L, settings.crf);
+	lua_setfield (L, -2, "crf");
+	lua_pushnumber (L, settings.bitrate);
+	lua_setfield (L, -2, "bitrate");
+	lua_pushnumber (L, settings.gop);
+	lua_setfield (L, -2, "gop");
+	lua_pushnumber (L, settings.bframes);
+	lua_setfield (L, -2, "b_frames");
+	lua_pushnumber (L, settings.threads);
+	lua_setfield (L, -2, "threads");
+	lua_pushstring (L, video_thread_type_name (settings.thread_type));
+	lua_setfield (L, -2, "thread_type");
+	lua_pushstring (L, video_scaler_name (settings.scaler));
+	lua_setfield (L, -2, "scaler");
+	lua_pushboolean (L, app_ptr->videoGpuConversion());
+	lua_setfield (L, -2, "gpu_conversion");
+
+	return 1;
+}
+
 static const struct luaL_Reg meshup_f[] = {
 	{ "getCamera", meshup_getCamera},
 	{ "getModel", meshup_getModel},
@@ -766,6 +953,12 @@ static const struct luaL_Reg meshup_f[] = {
 	{ "setLightPosition", meshup_setLightPosition},
 	{ "saveScreenshot", meshup_saveScreenshot},
 	{ "setModelDisplacement", meshup_setModelDisplacement},
+	{ "requestRedraw", meshup_requestRedraw},
+	{ "setProfiling", meshup_setProfiling},
+	{ "getProfile", meshup_getProfile},
+	{ "writeProfile", meshup_writeProfile},
+	{ "setVideoSettings", meshup_setVideoSettings},
+	{ "getVideoSettings", meshup_getVideoSettings},
 	{ NULL, NULL}
 };
 
@@ -0,0 +1,871 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "GL/glew.h"
+
+#include "ShaderRenderer.h"
+#include "ShadowMap.h"
+#include "Model.h"
+#include "Frustum.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+using namespace std;
+
+/// Location of the per instance index attribute of the multi draw path
+static const unsigned int AttributeInstanceIndex = 3;
+
+/// Texture unit of the shadow map
+static const unsigned int ShadowMapTextureUnit = 1;
+
+/// Identifies the content of a MeshArena (0 is never used)
+static unsigned int next_arena_id = 1;
+
+static const char* vertex_shader_source =
+	"#ifdef MULTI_DRAW\n"
+	"uniform samplerBuffer instance_data;\n"
+	"in int instance_index;\n"
+	"#else\n"
+	"struct Instance {\n"
+	"	mat4 modelview;\n"
+	"	vec4 normal_matrix[3];\n"
+	"	vec4 color;\n"
+	"};\n"
+	"\n"
+	"layout(std140) uniform SegmentBlock {\n"
+	"	Instance instances[MAX_INSTANCES];\n"
+	"};\n"
+	"\n"
+	"uniform int instance_offset;\n"
+	"#endif\n"
+	"\n"
+	"uniform mat4 projection;\n"
+	"uniform bool use_vertex_color;\n"
+	"\n"
+	"in vec3 position;\n"
+	"in vec3 normal;\n"
+	"in vec4 color;\n"
+	"\n"
+	"out vec3 eye_position;\n"
+	"out vec3 eye_normal;\n"
+	"out vec4 base_color;\n"
+	"\n"
+	"void main() {\n"
+	"#ifdef MULTI_DRAW\n"
+	"	int index = instance_index * 8;\n"
+	"	mat4 modelview = mat4 (texelFetch (instance_data, index),\n"
+	"			texelFetch (instance_data, index + 1),\n"
+	"			texelFetch (instance_data, index + 2),\n"
+	"			texelFetch (instance_data, index + 3));\n"
+	"	mat3 normal_matrix = mat3 (texelFetch (instance_data, index + 4).xyz,\n"
+	"			texelFetch (instance_data, index + 5).xyz,\n"
+	"			texelFetch (instance_data, index + 6).xyz);\n"
+	"	vec4 instance_color = texelFetch (instance_data, index + 7);\n"
+	"#else\n"
+	"	int index = instance_offset + gl_InstanceID;\n"
+	"	mat4 modelview = instances[index].modelview;\n"
+	"	mat3 normal_matrix = mat3 (instances[index].normal_matrix[0].xyz,\n"
+	"			instances[index].normal_matrix[1].xyz,\n"
+	"			instances[index].normal_matrix[2].xyz);\n"
+	"	vec4 instance_color = instances[index].color;\n"
+	"#endif\n"
+	"\n"
+	"	vec4 p = modelview * vec4 (position, 1.0);\n"
+	"	eye_position = p.xyz;\n"
+	"	eye_normal = normal_matrix * normal;\n"
+	"	base_color = use_vertex_color ? color : instance_color;\n"
+	"	gl_Position = projection * p;\n"
+	"}\n";
+static const char* fragment_shader_source =
+	"uniform bool lighting;\n"
+	"uniform vec4 light_position;\n"
+	"uniform vec4 light_ambient;\n"
+	"uniform vec4 light_diffuse;\n"
+	"uniform vec4 light_specular;\n"
+	"uniform vec4 scene_ambient;\n"
+	"\n"
+	"uniform int shadow_cascade_count;\n"
+	"uniform sampler2DShadow shadow_map;\n"
+	"uniform mat4 shadow_matrices[MAX_SHADOW_CASCADES];\n"
+	"uniform vec4 shadow_split_distances;\n"
+	"\n"
+	"in vec3 eye_position;\n"
+	"in vec3 eye_normal;\n"
+	"in vec4 base_color;\n"
+	"\n"
+	"out vec4 frag_color;\n"
+	"\n"
+	"const float shininess = 16.0;\n"
+	"/// Brightness of shadowed unlit surfaces (e.g. the floor)\n"
+	"const float unlit_shadow = 0.6;\n"
+	"\n"
+	"float shadow_visibility() {\n"
+	"	float depth = -eye_position.z;\n"
+	"	int cascade = 0;\n"
+	"	while (cascade < shadow_cascade_count && depth > shadow_split_distances[cascade])\n"
+	"		cascade++;\n"
+	"\n"
+	"	if (cascade == shadow_cascade_count)\n"
+	"		return 1.0;\n"
+	"\n"
+	"	vec4 coord = shadow_matrices[cascade] * vec4 (eye_position, 1.0);\n"
+	"	return texture (shadow_map, coord.xyz);\n"
+	"}\n"
+	"\n"
+	"void main() {\n"
+	"	float visibility = shadow_visibility();\n"
+	"\n"
+	"	if (!lighting) {\n"
+	"		frag_color = vec4 (base_color.rgb * mix (unlit_shadow, 1.0, visibility), base_color.a);\n"
+	"		return;\n"
+	"	}\n"
+	"\n"
+	"	vec3 n = dot (eye_normal, eye_normal) > 0.0 ? normalize (eye_normal) : vec3 (0.0, 0.0, 1.0);\n"
+	"	vec3 l = light_position.w == 0.0 ? normalize (light_position.xyz) : normalize (light_position.xyz - eye_position);\n"
+	"\n"
+	"	float diffuse = max (dot (n, l), 0.0);\n"
+	"	float specular = 0.0;\n"
+	"	if (diffuse > 0.0)\n"
+	"		specular = pow (max (dot (n, normalize (l + vec3 (0.0, 0.0, 1.0))), 0.0), shininess);\n"
+	"\n"
+	"	vec3 color = (scene_ambient.rgb + light_ambient.rgb + visibility * diffuse * light_diffuse.rgb) * base_color.rgb\n"
+	"		+ visibility * specular * light_specular.rgb;\n"
+	"	frag_color = vec4 (min (color, vec3 (1.0)), base_color.a);\n"
+	"}\n";
+
+static GLuint compile_shader (GLenum type, const char* source, const string &defines) {
+	string header = string("#version 140\n") + defines;
+	const char* sources[2] = { header.c_str(), source };
+
+	GLuint shader_id = glCreateShader (type);
+	glShaderSource (shader_id, 2, sources, NULL);
+	glCompileShader (shader_id);
+
+	GLint status = GL_FALSE;
+	glGetShaderiv (shader_id, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		GLchar log[4096];
+		glGetShaderInfoLog (shader_id, sizeof(log), NULL, log);
+		cerr << "Error compiling " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader:" << endl << log << endl;
+
+		glDeleteShader (shader_id);
+		return 0;
+	}
+
+	return shader_id;
+}
+
+ShaderRenderer::ShaderRenderer() :
+	multi_draw_supported (false),
+	use_multi_draw (true),
+	draw_call_count (0),
+	culled_count (0),
+	shadow_map (NULL),
+	initialized (false),
+	uniform_buffer_id (0),
+	instances_per_block (0),
+	block_stride (0),
+	instance_buffer_id (0),
+	instance_texture_id (0),
+	instance_index_buffer_id (0),
+	instance_index_capacity (0),
+	indirect_buffer_id (0),
+	modelview (Matrix44f::Identity()),
+	projection (Matrix44f::Identity()),
+	viewport_height (1.f)
+{
+}
+
+ShaderRenderer::~ShaderRenderer() {
+	destroy();
+}
+
+bool ShaderRenderer::linkProgram (Program &program, bool multi_draw) {
+	ostringstream defines;
+	defines << "#define MAX_INSTANCES " << instances_per_block << endl;
+	defines << "#define MAX_SHADOW_CASCADES " << ShadowMap::MaxCascades << endl;
+	if (multi_draw)
+		defines << "#define MULTI_DRAW" << endl;
+
+	GLuint vertex_shader_id = compile_shader (GL_VERTEX_SHADER, vertex_shader_source, defines.str());
+	GLuint fragment_shader_id = compile_shader (GL_FRAGMENT_SHADER, fragment_shader_source, defines.str());
+
+	if (vertex_shader_id == 0 || fragment_shader_id == 0) {
+		glDeleteShader (vertex_shader_id);
+		glDeleteShader (fragment_shader_id);
+		return false;
+	}
+
+	program.id = glCreateProgram();
+	glAttachShader (program.id, vertex_shader_id);
+	glAttachShader (program.id, fragment_shader_id);
+
+	glBindAttribLocation (program.id, MeshVBO::AttributePosition, "position");
+	glBindAttribLocation (program.id, MeshVBO::AttributeNormal, "normal");
+	glBindAttribLocation (program.id, MeshVBO::AttributeColor, "color");
+	if (multi_draw)
+		glBindAttribLocation (program.id, AttributeInstanceIndex, "instance_index");
+	glBindFragDataLocation (program.id, 0, "frag_color");
+
+	glLinkProgram (program.id);
+
+	// the program keeps the shaders alive as long as they are attached
+	glDeleteShader (vertex_shader_id);
+	glDeleteShader (fragment_shader_id);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv (program.id, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		GLchar log[4096];
+		glGetProgramInfoLog (program.id, sizeof(log), NULL, log);
+		cerr << "Error linking shader program:" << endl << log << endl;
+
+		glDeleteProgram (program.id);
+		program.id = 0;
+		return false;
+	}
+
+	if (!multi_draw)
+		glUniformBlockBinding (program.id, glGetUniformBlockIndex (program.id, "SegmentBlock"), 0);
+
+	program.projection_location = glGetUniformLocation (program.id, "projection");
+	program.use_vertex_color_location = glGetUniformLocation (program.id, "use_vertex_color");
+	program.instance_offset_location = glGetUniformLocation (program.id, "instance_offset");
+	program.instance_data_location = glGetUniformLocation (program.id, "instance_data");
+	program.lighting_location = glGetUniformLocation (program.id, "lighting");
+	program.light_position_location = glGetUniformLocation (program.id, "light_position");
+	program.light_ambient_location = glGetUniformLocation (program.id, "light_ambient");
+	program.light_diffuse_location = glGetUniformLocation (program.id, "light_diffuse");
+	program.light_specular_location = glGetUniformLocation (program.id, "light_specular");
+	program.scene_ambient_location = glGetUniformLocation (program.id, "scene_ambient");
+	program.shadow_cascade_count_location = glGetUniformLocation (program.id, "shadow_cascade_count");
+	program.shadow_matrices_location = glGetUniformLocation (program.id, "shadow_matrices");
+	program.shadow_split_distances_location = glGetUniformLocation (program.id, "shadow_split_distances");
+
+	// the shadow map always uses its own texture unit such that it never
+	// conflicts with the instance data buffer texture
+	glUseProgram (program.id);
+	glUniform1i (glGetUniformLocation (program.id, "shadow_map"), ShadowMapTextureUnit);
+	glUseProgram (0);
+
+	return true;
+}
+
+bool ShaderRenderer::init() {
+	if (initialized)
+		return true;
+
+	if (!GLEW_VERSION_3_1 || !(GLEW_VERSION_3_3 || GLEW_ARB_vertex_type_2_10_10_10_rev)) {
+		cerr << "Warning: OpenGL 3.3 not supported, using fixed function rendering." << endl;
+		return false;
+	}
+
+	GLint max_block_size = 0;
+	GLint offset_alignment = 1;
+	glGetIntegerv (GL_MAX_UNIFORM_BLOCK_SIZE, &max_block_size);
+	glGetIntegerv (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+
+	instances_per_block = min (static_cast<unsigned int>(max_block_size / sizeof (InstanceData)), 1024u);
+	block_stride = instances_per_block * sizeof (InstanceData);
+	block_stride = ((block_stride + offset_alignment - 1) / offset_alignment) * offset_alignment;
+
+	if (!linkProgram (instanced_program, false))
+		return false;
+
+	glGenBuffers (1, &uniform_buffer_id);
+
+	multi_draw_supported = (GLEW_VERSION_4_0 || GLEW_ARB_draw_indirect)
+		&& (GLEW_VERSION_4_2 || GLEW_ARB_base_instance);
+
+	if (multi_draw_supported && !linkProgram (multi_draw_program, true)) {
+		cerr << "Warning: could not create multi draw shader, using instanced rendering." << endl;
+		multi_draw_supported = false;
+	}
+
+	if (multi_draw_supported) {
+		glGenBuffers (1, &instance_buffer_id);
+		glGenBuffers (1, &instance_index_buffer_id);
+		glGenBuffers (1, &indirect_buffer_id);
+
+		glBindBuffer (GL_TEXTURE_BUFFER, instance_buffer_id);
+		glBufferData (GL_TEXTURE_BUFFER, sizeof (InstanceData), NULL, GL_STREAM_DRAW);
+		glBindBuffer (GL_TEXTURE_BUFFER, 0);
+
+		glGenTextures (1, &instance_texture_id);
+		glBindTexture (GL_TEXTURE_BUFFER, instance_texture_id);
+		glTexBuffer (GL_TEXTURE_BUFFER, GL_RGBA32F, instance_buffer_id);
+		glBindTexture (GL_TEXTURE_BUFFER, 0);
+	}
+
+	initialized = true;
+
+	return true;
+}
+
+void ShaderRenderer::destroy() {
+	if (!initialized)
+		return;
+
+	for (size_t i = 0; i < arenas.size(); i++) {
+		glDeleteVertexArrays (1, &arenas[i].vao_id);
+		glDeleteBuffers (1, &arenas[i].vbo_id);
+		glDeleteBuffers (1, &arenas[i].ibo_id);
+	}
+	arenas.clear();
+
+	if (multi_draw_supported) {
+		glDeleteTextures (1, &instance_texture_id);
+		glDeleteBuffers (1, &instance_buffer_id);
+		glDeleteBuffers (1, &instance_index_buffer_id);
+		glDeleteBuffers (1, &indirect_buffer_id);
+		glDeleteProgram (multi_draw_program.id);
+	}
+
+	glDeleteBuffers (1, &uniform_buffer_id);
+	glDeleteProgram (instanced_program.id);
+
+	uniform_buffer_id = 0;
+	instance_texture_id = 0;
+	instance_buffer_id = 0;
+	instance_index_buffer_id = 0;
+	instance_index_capacity = 0;
+	indirect_buffer_id = 0;
+	instanced_program = Program();
+	multi_draw_program = Program();
+	initialized = false;
+}
+
+void ShaderRenderer::beginFrame() {
+	assert (initialized);
+
+	instances.clear();
+	draw_items.clear();
+
+	GLint viewport[4];
+	glGetFloatv (GL_MODELVIEW_MATRIX, modelview.data());
+	glGetFloatv (GL_PROJECTION_MATRIX, projection.data());
+	glGetIntegerv (GL_VIEWPORT, viewport);
+	viewport_height = viewport[3];
+
+	culled_count = 0;
+}
+
+void ShaderRenderer::addModel (const MeshupModel &model, const Matrix44f &model_transform) {
+	Matrix44f model_modelview = model_transform * modelview;
+
+	// the bounding boxes are in model coordinates
+	Frustum model_frustum (model_modelview * projection);
+	if (!model_frustum.intersectsBox (model.bbox_min, model.bbox_max)) {
+		culled_count += model.segments.size();
+		return;
+	}
+
+	for (MeshupModel::SegmentList::const_iterator seg_iter = model.segments.begin(); seg_iter != model.segments.end(); seg_iter++) {
+		if (!model_frustum.intersectsBox (seg_iter->bbox_min, seg_iter->bbox_max)) {
+			culled_count++;
+			continue;
+		}
+
+		MeshVBO *mesh = seg_iter->mesh;
+		if (mesh->lods.size() != 0) {
+			float projected_size = calc_projected_mesh_size (*seg_iter, model_modelview, projection, viewport_height);
+			mesh = mesh->selectLOD (projected_size, model.lod_pixel_error);
+		}
+
+		addInstance (mesh, seg_iter->gl_matrix * model_transform, Vector4f (seg_iter->color[0], seg_iter->color[1], seg_iter->color[2], 1.f));
+	}
+}
+
+void ShaderRenderer::addInstance (MeshVBO *mesh, const Matrix44f &transform, const Vector4f &color) {
+	// make sure the buffer layout is known
+	if (mesh->vbo_id == 0)
+		mesh->generate_vbo();
+
+	Matrix44f instance_modelview = transform * modelview;
+
+	InstanceData instance;
+
+	if (mesh->buffer_format.position == VertexFormat::PositionShort3) {
+		Matrix44f dequantization = SimpleMath::GL::ScaleMat44 (mesh->position_scale, mesh->position_scale, mesh->position_scale)
+			* SimpleMath::GL::TranslateMat44 (mesh->position_offset[0], mesh->position_offset[1], mesh->position_offset[2]);
+		memcpy (instance.modelview, (dequantization * instance_modelview).data(), sizeof (instance.modelview));
+	} else {
+		memcpy (instance.modelview, instance_modelview.data(), sizeof (instance.modelview));
+	}
+
+	// The normal matrix is the inverse transpose of the rotational part.
+	// Up to the (positive) determinant it is given by the cofactors, i.e.
+	// the cross products of the rows.
+	Vector3f r0 (instance_modelview(0,0), instance_modelview(0,1), instance_modelview(0,2));
+	Vector3f r1 (instance_modelview(1,0), instance_modelview(1,1), instance_modelview(1,2));
+	Vector3f r2 (instance_modelview(2,0), instance_modelview(2,1), instance_modelview(2,2));
+	Vector3f cofactors[3] = { r1.cross (r2), r2.cross (r0), r0.cross (r1) };
+	float sign = r0.dot (cofactors[0]) < 0.f ? -1.f : 1.f;
+
+	for (unsigned int i = 0; i < 3; i++) {
+		instance.normal_matrix[i * 4] = sign * cofactors[i][0];
+		instance.normal_matrix[i * 4 + 1] = sign * cofactors[i][1];
+		instance.normal_matrix[i * 4 + 2] = sign * cofactors[i][2];
+		instance.normal_matrix[i * 4 + 3] = 0.f;
+	}
+
+	memcpy (instance.color, color.data(), sizeof (instance.color));
+
+	DrawItem item;
+	item.mesh = mesh;
+	item.instance = instances.size();
+
+	instances.push_back (instance);
+	draw_items.push_back (item);
+}
+
+void ShaderRenderer::useProgram (const Program &program) {
+	glUseProgram (program.id);
+
+	// lighting state as set up by GLWidget (the light position is
+	// returned in eye coordinates)
+	Vector4f light_position, light_ambient, light_diffuse, light_specular, scene_ambient;
+	glGetLightfv (GL_LIGHT0, GL_POSITION, light_position.data());
+	glGetLightfv (GL_LIGHT0, GL_AMBIENT, light_ambient.data());
+	glGetLightfv (GL_LIGHT0, GL_DIFFUSE, light_diffuse.data());
+	glGetLightfv (GL_LIGHT0, GL_SPECULAR, light_specular.data());
+	glGetFloatv (GL_LIGHT_MODEL_AMBIENT, scene_ambient.data());
+
+	glUniformMatrix4fv (program.projection_location, 1, GL_FALSE, projection.data());
+	glUniform1i (program.lighting_location, glIsEnabled (GL_LIGHTING) && glIsEnabled (GL_LIGHT0));
+	glUniform4fv (program.light_position_location, 1, light_position.data());
+	glUniform4fv (program.light_ambient_location, 1, light_ambient.data());
+	glUniform4fv (program.light_diffuse_location, 1, light_diffuse.data());
+	glUniform4fv (program.light_specular_location, 1, light_specular.data());
+	glUniform4fv (program.scene_ambient_location, 1, scene_ambient.data());
+
+	unsigned int shadow_cascade_count = 0;
+	if (shadow_map && shadow_map->initialized) {
+		shadow_cascade_count = shadow_map->cascade_count;
+
+		float shadow_matrices[ShadowMap::MaxCascades * 16];
+		for (unsigned int i = 0; i < shadow_cascade_count; i++)
+			memcpy (&shadow_matrices[i * 16], shadow_map->eye_to_shadow[i].data(), sizeof (float) * 16);
+
+		glUniformMatrix4fv (program.shadow_matrices_location, shadow_cascade_count, GL_FALSE, shadow_matrices);
+		glUniform4fv (program.shadow_split_distances_location, 1, shadow_map->split_distances);
+
+		glActiveTexture (GL_TEXTURE0 + ShadowMapTextureUnit);
+		glBindTexture (GL_TEXTURE_2D, shadow_map->texture_id);
+		glActiveTexture (GL_TEXTURE0);
+	}
+	glUniform1i (program.shadow_cascade_count_location, shadow_cascade_count);
+}
+
+void ShaderRenderer::endFrame() {
+	draw_call_count = 0;
+
+	if (draw_items.size() == 0)
+		return;
+
+	// group the segments by mesh such that each mesh needs only a single
+	// (instanced) draw
+	sort (draw_items.begin(), draw_items.end());
+
+	if (multi_draw_supported && use_multi_draw)
+		drawMultiDraw();
+	else
+		drawInstanced();
+
+	glUseProgram (0);
+}
+
+void ShaderRenderer::drawInstanced() {
+	size_t block_count = (draw_items.size() + instances_per_block - 1) / instances_per_block;
+	buffer_data.resize (block_count * block_stride);
+
+	for (size_t i = 0; i < draw_items.size(); i++) {
+		size_t offset = (i / instances_per_block) * block_stride + (i % instances_per_block) * sizeof (InstanceData);
+		memcpy (&buffer_data[offset], &instances[draw_items[i].instance], sizeof (InstanceData));
+	}
+
+	glBindBuffer (GL_UNIFORM_BUFFER, uniform_buffer_id);
+	glBufferData (GL_UNIFORM_BUFFER, buffer_data.size(), &buffer_data[0], GL_STREAM_DRAW);
+
+	useProgram (instanced_program);
+
+	MeshVBO *bound_mesh = NULL;
+	size_t first = 0;
+
+	while (first < draw_items.size()) {
+		size_t block = first / instances_per_block;
+
+		if (first % instances_per_block == 0) {
+			glBindBufferRange (GL_UNIFORM_BUFFER, 0, uniform_buffer_id, block * block_stride, instances_per_block * sizeof (InstanceData));
+		}
+
+		MeshVBO *mesh = draw_items[first].mesh;
+
+		size_t last = first + 1;
+		while (last < draw_items.size()
+				&& draw_items[last].mesh == mesh
+				&& last / instances_per_block == block) {
+			last++;
+		}
+
+		if (mesh != bound_mesh) {
+			mesh->bindVertexArray();
+			glUniform1i (instanced_program.use_vertex_color_location, mesh->color_type != 0);
+
+			bound_mesh = mesh;
+		}
+
+		glUniform1i (instanced_program.instance_offset_location, first % instances_per_block);
+
+		if (mesh->buffer_index_count != 0) {
+			glDrawElementsInstanced (GL_TRIANGLES, mesh->buffer_index_count, GL_UNSIGNED_INT, NULL, last - first);
+		} else {
+			glDrawArraysInstanced (GL_TRIANGLES, 0, mesh->buffer_vertex_count, last - first);
+		}
+		draw_call_count++;
+
+		first = last;
+	}
+
+	glBindVertexArray (0);
+	glBindBuffer (GL_UNIFORM_BUFFER, 0);
+}
+
+void ShaderRenderer::drawMultiDraw() {
+	// per instance data in draw order
+	buffer_data.resize (draw_items.size() * sizeof (InstanceData));
+	for (size_t i = 0; i < draw_items.size(); i++) {
+		memcpy (&buffer_data[i * sizeof (InstanceData)], &instances[draw_items[i].instance], sizeof (InstanceData));
+	}
+
+	glBindBuffer (GL_TEXTURE_BUFFER, instance_buffer_id);
+	glBufferData (GL_TEXTURE_BUFFER, buffer_data.size(), &buffer_data[0], GL_STREAM_DRAW);
+	glBindBuffer (GL_TEXTURE_BUFFER, 0);
+
+	if (instance_index_capacity < draw_items.size()) {
+		instance_index_capacity = max (static_cast<unsigned int>(draw_items.size()), 2 * instance_index_capacity);
+
+		vector<unsigned int> instance_indices (instance_index_capacity);
+		for (unsigned int i = 0; i < instance_index_capacity; i++)
+			instance_indices[i] = i;
+
+		glBindBuffer (GL_ARRAY_BUFFER, instance_index_buffer_id);
+		glBufferData (GL_ARRAY_BUFFER, sizeof (unsigned int) * instance_index_capacity, &instance_indices[0], GL_STATIC_DRAW);
+		glBindBuffer (GL_ARRAY_BUFFER, 0);
+	}
+
+	// one command per mesh, collected per arena
+	size_t first = 0;
+	while (first < draw_items.size()) {
+		MeshVBO *mesh = draw_items[first].mesh;
+
+		size_t last = first + 1;
+		while (last < draw_items.size() && draw_items[last].mesh == mesh)
+			last++;
+
+		findArena (mesh).frame_meshes.push_back (mesh);
+
+		first = last;
+	}
+
+	// make sure all meshes of this frame are stored in the arenas
+	for (size_t i = 0; i < arenas.size(); i++) {
+		MeshArena &arena = arenas[i];
+		if (arena.frame_meshes.size() == 0)
+			continue;
+
+		unsigned int live_vertices = 0, live_indices = 0;
+		unsigned int missing_vertices = 0, missing_indices = 0;
+		for (size_t j = 0; j < arena.frame_meshes.size(); j++) {
+			const MeshVBO *mesh = arena.frame_meshes[j];
+			unsigned int index_count = mesh->buffer_index_count != 0 ? mesh->buffer_index_count : mesh->buffer_vertex_count;
+
+			live_vertices += mesh->buffer_vertex_count;
+			live_indices += index_count;
+
+			if (mesh->arena_id != arena.id) {
+				missing_vertices += mesh->buffer_vertex_count;
+				missing_indices += index_count;
+			}
+		}
+
+		if (arena.vertex_count + missing_vertices > arena.vertex_capacity
+				|| arena.index_count + missing_indices > arena.index_capacity) {
+			if (live_vertices * 2 < arena.vertex_count + missing_vertices) {
+				// mostly data of meshes that are not drawn anymore: start over
+				arena.id = next_arena_id++;
+				arena.vertex_count = 0;
+				arena.index_count = 0;
+				reserveArena (arena, live_vertices, live_indices, false);
+			} else {
+				reserveArena (arena, arena.vertex_count + missing_vertices, arena.index_count + missing_indices, true);
+			}
+		}
+
+		for (size_t j = 0; j < arena.frame_meshes.size(); j++) {
+			if (arena.frame_meshes[j]->arena_id != arena.id)
+				uploadToArena (arena, arena.frame_meshes[j]);
+		}
+
+		arena.frame_meshes.clear();
+	}
+
+	first = 0;
+	while (first < draw_items.size()) {
+		MeshVBO *mesh = draw_items[first].mesh;
+
+		size_t last = first + 1;
+		while (last < draw_items.size() && draw_items[last].mesh == mesh)
+			last++;
+
+		DrawCommand command;
+		command.count = mesh->buffer_index_count != 0 ? mesh->buffer_index_count : mesh->buffer_vertex_count;
+		command.instance_count = last - first;
+		command.first_index = mesh->arena_first_index;
+		command.base_vertex = mesh->arena_base_vertex;
+		command.base_instance = first;
+
+		findArena (mesh).commands.push_back (command);
+
+		first = last;
+	}
+
+	commands.clear();
+	for (size_t i = 0; i < arenas.size(); i++) {
+		arenas[i].command_offset = commands.size() * sizeof (DrawCommand);
+		commands.insert (commands.end(), arenas[i].commands.begin(), arenas[i].commands.end());
+	}
+
+	glBindBuffer (GL_DRAW_INDIRECT_BUFFER, indirect_buffer_id);
+	glBufferData (GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof (DrawCommand), &commands[0], GL_STREAM_DRAW);
+
+	useProgram (multi_draw_program);
+
+	glActiveTexture (GL_TEXTURE0);
+	glBindTexture (GL_TEXTURE_BUFFER, instance_texture_id);
+	glUniform1i (multi_draw_program.instance_data_location, 0);
+
+	for (size_t i = 0; i < arenas.size(); i++) {
+		MeshArena &arena = arenas[i];
+		if (arena.commands.size() == 0)
+			continue;
+
+		glBindVertexArray (arena.vao_id);
+		glUniform1i (multi_draw_program.use_vertex_color_location, arena.color_type != 0);
+
+		if (GLEW_AMD_multi_draw_indirect) {
+			glMultiDrawElementsIndirectAMD (GL_TRIANGLES, GL_UNSIGNED_INT, (const GLvoid *) arena.command_offset, arena.commands.size(), 0);
+			draw_call_count++;
+		} else {
+			for (size_t j = 0; j < arena.commands.size(); j++) {
+				glDrawElementsIndirect (GL_TRIANGLES, GL_UNSIGNED_INT, (const GLvoid *) (arena.command_offset + j * sizeof (DrawCommand)));
+				draw_call_count++;
+			}
+		}
+
+		arena.commands.clear();
+	}
+
+	glBindVertexArray (0);
+	glBindTexture (GL_TEXTURE_BUFFER, 0);
+	glBindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+ShaderRenderer::MeshArena& ShaderRenderer::findArena (const MeshVBO *mesh) {
+	for (size_t i = 0; i < arenas.size(); i++) {
+		if (arenas[i].position_type == static_cast<unsigned int>(mesh->buffer_format.position)
+				&& arenas[i].normal_type == mesh->normal_type
+				&& arenas[i].color_type == mesh->color_type) {
+			return arenas[i];
+		}
+	}
+
+	MeshArena arena;
+	arena.id = next_arena_id++;
+	arena.position_type = mesh->buffer_format.position;
+	arena.normal_type = mesh->normal_type;
+	arena.color_type = mesh->color_type;
+	arena.stride = mesh->stride;
+	arena.normal_offset = mesh->normal_offset;
+	arena.color_offset = mesh->color_offset;
+
+	glGenBuffers (1, &arena.vbo_id);
+	glGenBuffers (1, &arena.ibo_id);
+	glGenVertexArrays (1, &arena.vao_id);
+
+	arenas.push_back (arena);
+
+	return arenas.back();
+}
+
+void ShaderRenderer::reserveArena (MeshArena &arena, unsigned int vertex_count, unsigned int index_count, bool keep_content) {
+	const unsigned int min_vertex_capacity = 1 << 16;
+	const unsigned int min_index_capacity = 1 << 18;
+
+	if (vertex_count > arena.vertex_capacity) {
+		unsigned int capacity = max (max (vertex_count, 2 * arena.vertex_capacity), min_vertex_capacity);
+
+		GLuint vbo_id;
+		glGenBuffers (1, &vbo_id);
+		glBindBuffer (GL_COPY_WRITE_BUFFER, vbo_id);
+		glBufferData (GL_COPY_WRITE_BUFFER, capacity * arena.stride, NULL, GL_STATIC_DRAW);
+
+		if (keep_content && arena.vertex_count != 0) {
+			glBindBuffer (GL_COPY_READ_BUFFER, arena.vbo_id);
+			glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, arena.vertex_count * arena.stride);
+			glBindBuffer (GL_COPY_READ_BUFFER, 0);
+		}
+		glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+
+		glDeleteBuffers (1, &arena.vbo_id);
+		arena.vbo_id = vbo_id;
+		arena.vertex_capacity = capacity;
+	}
+
+	if (index_count > arena.index_capacity) {
+		unsigned int capacity = max (max (index_count, 2 * arena.index_capacity), min_index_capacity);
+
+		GLuint ibo_id;
+		glGenBuffers (1, &ibo_id);
+		glBindBuffer (GL_COPY_WRITE_BUFFER, ibo_id);
+		glBufferData (GL_COPY_WRITE_BUFFER, capacity * sizeof (unsigned int), NULL, GL_STATIC_DRAW);
+
+		if (keep_content && arena.index_count != 0) {
+			glBindBuffer (GL_COPY_READ_BUFFER, arena.ibo_id);
+			glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, arena.index_count * sizeof (unsigned int));
+			glBindBuffer (GL_COPY_READ_BUFFER, 0);
+		}
+		glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+
+		glDeleteBuffers (1, &arena.ibo_id);
+		arena.ibo_id = ibo_id;
+		arena.index_capacity = capacity;
+	}
+
+	setupArenaVertexArray (arena);
+}
+
+void ShaderRenderer::setupArenaVertexArray (MeshArena &arena) {
+	glBindVertexArray (arena.vao_id);
+
+	glBindBuffer (GL_ARRAY_BUFFER, arena.vbo_id);
+
+	if (arena.position_type == VertexFormat::PositionShort3)
+		glVertexAttribPointer (MeshVBO::AttributePosition, 3, GL_SHORT, GL_FALSE, arena.stride, NULL);
+	else
+		glVertexAttribPointer (MeshVBO::AttributePosition, 3, GL_FLOAT, GL_FALSE, arena.stride, NULL);
+	glEnableVertexAttribArray (MeshVBO::AttributePosition);
+
+	if (arena.normal_type != 0) {
+		glVertexAttribPointer (MeshVBO::AttributeNormal, arena.normal_type == GL_INT_2_10_10_10_REV ? 4 : 3, arena.normal_type, GL_TRUE, arena.stride, (const GLvoid *) (GLsizeiptr) arena.normal_offset);
+		glEnableVertexAttribArray (MeshVBO::AttributeNormal);
+	}
+
+	if (arena.color_type != 0) {
+		glVertexAttribPointer (MeshVBO::AttributeColor, 4, arena.color_type, GL_TRUE, arena.stride, (const GLvoid *) (GLsizeiptr) arena.color_offset);
+		glEnableVertexAttribArray (MeshVBO::AttributeColor);
+	}
+
+	glBindBuffer (GL_ARRAY_BUFFER, instance_index_buffer_id);
+	glVertexAttribIPointer (AttributeInstanceIndex, 1, GL_UNSIGNED_INT, 0, NULL);
+	glVertexAttribDivisor (AttributeInstanceIndex, 1);
+	glEnableVertexAttribArray (AttributeInstanceIndex);
+
+	glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, arena.ibo_id);
+
+	glBindVertexArray (0);
+	glBindBuffer (GL_ARRAY_BUFFER, 0);
+}
+
+void ShaderRenderer::uploadToArena (MeshArena &arena, MeshVBO *mesh) {
+	assert (mesh->stride == static_cast<GLsizeiptr>(arena.stride));
+
+	mesh->arena_id = arena.id;
+	mesh->arena_base_vertex = arena.vertex_count;
+	mesh->arena_first_index = arena.index_count;
+
+	// copy the data on the GPU as the CPU-side data may have been released
+	glBindBuffer (GL_COPY_READ_BUFFER, mesh->vbo_id);
+	glBindBuffer (GL_COPY_WRITE_BUFFER, arena.vbo_id);
+	glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, arena.vertex_count * arena.stride, mesh->buffer_size);
+	arena.vertex_count += mesh->buffer_vertex_count;
+
+	glBindBuffer (GL_COPY_WRITE_BUFFER, arena.ibo_id);
+
+	if (mesh->buffer_index_count != 0) {
+		glBindBuffer (GL_COPY_READ_BUFFER, mesh->ibo_id);
+		glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, arena.index_count * sizeof (unsigned int), mesh->buffer_index_count * sizeof (unsigned int));
+		arena.index_count += mesh->buffer_index_count;
+	} else {
+		vector<unsigned int> indices (mesh->buffer_vertex_count);
+		for (unsigned int i = 0; i < mesh->buffer_vertex_count; i++)
+			indices[i] = i;
+
+		glBufferSubData (GL_COPY_WRITE_BUFFER, arena.index_count * sizeof (unsigned int), indices.size() * sizeof (unsigned int), &indices[0]);
+		arena.index_count += mesh->buffer_vertex_count;
+	}
+
+	glBindBuffer (GL_COPY_READ_BUFFER, 0);
+	glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+}
+
+void draw_mesh_instances (
+		MeshVBO *mesh,
+		const std::vector<Matrix44f> &transforms,
+		const std::vector<Vector4f> &colors,
+		ShaderRenderer *renderer) {
+	assert (transforms.size() == colors.size());
+
+	if (transforms.size() == 0)
+		return;
+
+	Matrix44f modelview, projection;
+	glGetFloatv (GL_MODELVIEW_MATRIX, modelview.data());
+	glGetFloatv (GL_PROJECTION_MATRIX, projection.data());
+	Frustum frustum (modelview * projection);
+
+	Vector3f bbox_min, bbox_max;
+
+	if (renderer) {
+		renderer->beginFrame();
+		for (size_t i = 0; i < transforms.size(); i++) {
+			transform_bounding_box (mesh->bbox_min, mesh->bbox_max, transforms[i], bbox_min, bbox_max);
+			if (!frustum.intersectsBox (bbox_min, bbox_max))
+				continue;
+
+			renderer->addInstance (mesh, transforms[i], colors[i]);
+		}
+		renderer->endFrame();
+		return;
+	}
+
+	// the transformations may contain a scaling
+	bool normalize_enabled = glIsEnabled (GL_NORMALIZE);
+	if (!normalize_enabled)
+		glEnable (GL_NORMALIZE);
+
+	for (size_t i = 0; i < transforms.size(); i++) {
+		transform_bounding_box (mesh->bbox_min, mesh->bbox_max, transforms[i], bbox_min, bbox_max);
+		if (!frustum.intersectsBox (bbox_min, bbox_max))
+			continue;
+
+		glPushMatrix();
+		glMultMatrixf (transforms[i].data());
+		glColor4f (colors[i][0], colors[i][1], colors[i][2], colors[i][3]);
+		mesh->draw (GL_TRIANGLES);
+		glPopMatrix();
+	}
+
+	if (!normalize_enabled)
+		glDisable (GL_NORMALIZE);
+}
@@ -0,0 +1,252 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_SHADERRENDERER_H
+#define MESHUP_SHADERRENDERER_H
+
+#include <vector>
+#include <cstddef>
+
+#include "Math.h"
+
+struct MeshVBO;
+struct MeshupModel;
+struct ShadowMap;
+
+/** \brief Draws the segments of models using GLSL shaders.
+ *
+ * The matrices and colors of all segments of a frame are collected,
+ * sorted by mesh and uploaded at once. Lighting of GL_LIGHT0 (with the
+ * material used in GLWidget) is evaluated in the fragment shader.
+ *
+ * If indirect drawing is supported (OpenGL 4.2 or ARB_draw_indirect and
+ * ARB_base_instance) the meshes are copied into shared vertex and index
+ * buffers (arenas), one per vertex layout. The whole frame is then drawn
+ * with one glMultiDrawElementsIndirectAMD() call per arena (or a loop of
+ * glDrawElementsIndirect() if AMD_multi_draw_indirect is missing). The
+ * per segment data is read from a buffer texture using the base instance
+ * of each draw command.
+ *
+ * Otherwise the per segment data is stored in a uniform buffer and the
+ * segments that share a mesh are drawn with one instanced draw call
+ * using the vertex array object of the mesh.
+ *
+ * Segments whose bounding box (see MeshupModel::updateSegments()) is
+ * outside of the view volume are skipped. In the shadow pass this is the
+ * volume of the light projection.
+ *
+ * If shadow_map is set the fragment shader looks up the cascade that
+ * contains the fragment and darkens it if it is in shadow.
+ *
+ * Usage:
+ *
+ * \code
+ *	renderer.beginFrame();
+ *	renderer.addModel (model, model_transform);
+ *	renderer.addInstance (mesh, transform, color);
+ *	renderer.endFrame();
+ * \endcode
+ *
+ * The renderer requires OpenGL 3.3 (or 3.1 with
+ * ARB_vertex_type_2_10_10_10_rev). If init() fails the fixed function
+ * path of MeshupModel::draw() has to be used instead.
+ */
+struct ShaderRenderer {
+	ShaderRenderer();
+	~ShaderRenderer();
+
+	/// Compiles the shaders and creates the buffers (requires a current
+	/// GL context). Returns false if not supported.
+	bool init();
+	void destroy();
+
+	/// Reads the matrices, viewport and light state from OpenGL
+	void beginFrame();
+	/// Queues all segments of the model. The model_transform is applied
+	/// before the current modelview matrix.
+	void addModel (const MeshupModel &model, const Matrix44f &model_transform);
+	/// Queues a single mesh. The transform is applied before the current
+	/// modelview matrix.
+	void addInstance (MeshVBO *mesh, const Matrix44f &transform, const Vector4f &color);
+	/// Uploads the segment data and draws all queued segments
+	void endFrame();
+
+	/// Whether indirect drawing is available
+	bool multi_draw_supported;
+	/// Use indirect drawing if supported
+	bool use_multi_draw;
+
+	/// Number of draw calls issued by the last call of endFrame()
+	unsigned int draw_call_count;
+	/// Number of segments skipped by addModel() since beginFrame()
+	/// because they are outside of the view volume
+	unsigned int culled_count;
+
+	/// If not NULL the drawn meshes receive shadows from this shadow map
+	/// (must not be set while rendering into it)
+	const ShadowMap *shadow_map;
+
+	/// Per segment data as laid out in the uniform block (std140) and
+	/// the buffer texture (8 RGBA texels)
+	struct InstanceData {
+		/// Includes the dequantization of the mesh positions
+		float modelview[16];
+		/// Columns of the normal matrix (4th component unused)
+		float normal_matrix[12];
+		float color[4];
+	};
+
+	struct DrawItem {
+		MeshVBO *mesh;
+		unsigned int instance;
+
+		bool operator< (const DrawItem &other) const {
+			if (mesh != other.mesh)
+				return mesh < other.mesh;
+			return instance < other.instance;
+		}
+	};
+
+	/// Layout of the GL indirect draw command
+	struct DrawCommand {
+		unsigned int count;
+		unsigned int instance_count;
+		unsigned int first_index;
+		int base_vertex;
+		unsigned int base_instance;
+	};
+
+	/// Shared vertex and index buffers of all meshes with the same vertex
+	/// layout
+	struct MeshArena {
+		MeshArena() :
+			id (0),
+			position_type (0),
+			normal_type (0),
+			color_type (0),
+			stride (0),
+			normal_offset (0),
+			color_offset (0),
+			vbo_id (0),
+			ibo_id (0),
+			vao_id (0),
+			vertex_capacity (0),
+			vertex_count (0),
+			index_capacity (0),
+			index_count (0),
+			command_offset (0)
+		{}
+
+		/// Changes whenever the content is discarded (see MeshVBO::arena_id)
+		unsigned int id;
+
+		unsigned int position_type;
+		unsigned int normal_type;
+		unsigned int color_type;
+		unsigned int stride;
+		unsigned int normal_offset;
+		unsigned int color_offset;
+
+		unsigned int vbo_id;
+		unsigned int ibo_id;
+		unsigned int vao_id;
+
+		unsigned int vertex_capacity;
+		unsigned int vertex_count;
+		unsigned int index_capacity;
+		unsigned int index_count;
+
+		/// Meshes drawn in the current frame
+		std::vector<MeshVBO*> frame_meshes;
+		std::vector<DrawCommand> commands;
+		/// Offset of the commands in the indirect buffer
+		size_t command_offset;
+	};
+
+	struct Program {
+		Program() :
+			id (0)
+		{}
+
+		unsigned int id;
+
+		int projection_location;
+		int use_vertex_color_location;
+		int instance_offset_location;
+		int instance_data_location;
+		int lighting_location;
+		int light_position_location;
+		int light_ambient_location;
+		int light_diffuse_location;
+		int light_specular_location;
+		int scene_ambient_location;
+		int shadow_cascade_count_location;
+		int shadow_matrices_location;
+		int shadow_split_distances_location;
+	};
+
+	bool initialized;
+
+	Program instanced_program;
+	Program multi_draw_program;
+
+	/// Uniform buffer of the instanced path
+	unsigned int uniform_buffer_id;
+
+	/// Number of instances that fit into the uniform block
+	unsigned int instances_per_block;
+	/// Distance in bytes between consecutive blocks in the buffer
+	unsigned int block_stride;
+
+	/// Buffer texture with the instance data of the multi draw path
+	unsigned int instance_buffer_id;
+	unsigned int instance_texture_id;
+	/// Contains 0, 1, 2, ... and is read per instance to get the index
+	/// of the instance data
+	unsigned int instance_index_buffer_id;
+	unsigned int instance_index_capacity;
+	unsigned int indirect_buffer_id;
+
+	std::vector<MeshArena> arenas;
+
+	Matrix44f modelview;
+	Matrix44f projection;
+	float viewport_height;
+
+	std::vector<InstanceData> instances;
+	std::vector<DrawItem> draw_items;
+	std::vector<unsigned char> buffer_data;
+	std::vector<DrawCommand> commands;
+
+	bool linkProgram (Program &program, bool multi_draw);
+	void useProgram (const Program &program);
+
+	void drawInstanced();
+	void drawMultiDraw();
+
+	MeshArena& findArena (const MeshVBO *mesh);
+	void reserveArena (MeshArena &arena, unsigned int vertex_count, unsigned int index_count, bool keep_content);
+	void setupArenaVertexArray (MeshArena &arena);
+	void uploadToArena (MeshArena &arena, MeshVBO *mesh);
+};
+
+/** \brief Draws the mesh once for every transformation (applied before
+ * the current modelview matrix) and color. Instances outside of the view
+ * volume are skipped.
+ *
+ * If renderer is not NULL all instances are drawn with a single instanced
+ * draw call, otherwise the fixed function pipeline is used.
+ */
+void draw_mesh_instances (
+		MeshVBO *mesh,
+		const std::vector<Matrix44f> &transforms,
+		const std::vector<Vector4f> &colors,
+		ShaderRenderer *renderer);
+
+#endif
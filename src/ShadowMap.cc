@@ -0,0 +1,305 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "GL/glew.h"
+
+#include "ShadowMap.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+using namespace std;
+
+const unsigned int ShadowMap::MaxCascades;
+const unsigned int ShadowMap::MaxSize;
+
+ShadowMap::ShadowMap() :
+	size (2048),
+	cascade_count (1),
+	split_lambda (0.75f),
+	shadow_distance (30.f),
+	caster_distance (20.f),
+	initialized (false),
+	framebuffer_id (0),
+	texture_id (0),
+	texture_size (0),
+	texture_columns (0),
+	texture_rows (0),
+	previous_framebuffer (0)
+{
+	for (unsigned int i = 0; i < MaxCascades; i++) {
+		split_distances[i] = 0.f;
+		light_views[i] = Matrix44f::Identity();
+		light_projections[i] = Matrix44f::Identity();
+		eye_to_shadow[i] = Matrix44f::Identity();
+		world_to_shadow[i] = Matrix44f::Identity();
+	}
+}
+
+ShadowMap::~ShadowMap() {
+	destroy();
+}
+
+bool ShadowMap::init() {
+	if (initialized)
+		return true;
+
+	if (!(GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object) || !GLEW_ARB_depth_texture || !GLEW_ARB_shadow) {
+		cerr << "Warning: framebuffer objects or depth textures not supported, shadows are disabled." << endl;
+		return false;
+	}
+
+	glGenFramebuffers (1, &framebuffer_id);
+	glGenTextures (1, &texture_id);
+
+	initialized = true;
+
+	allocateTexture();
+
+	if (!initialized) {
+		cerr << "Warning: could not create shadow map framebuffer, shadows are disabled." << endl;
+		destroy();
+		return false;
+	}
+
+	return true;
+}
+
+void ShadowMap::destroy() {
+	// nothing to free if init() was never called (e.g. no context)
+	if (framebuffer_id != 0)
+		glDeleteFramebuffers (1, &framebuffer_id);
+	if (texture_id != 0)
+		glDeleteTextures (1, &texture_id);
+
+	framebuffer_id = 0;
+	texture_id = 0;
+	texture_size = 0;
+	texture_columns = 0;
+	texture_rows = 0;
+	initialized = false;
+}
+
+void ShadowMap::allocateTexture() {
+	cascade_count = max (1u, min (cascade_count, MaxCascades));
+
+	unsigned int columns = cascade_count > 1 ? 2 : 1;
+	unsigned int rows = cascade_count > 2 ? 2 : 1;
+
+	GLint max_texture_size = 0;
+	glGetIntegerv (GL_MAX_TEXTURE_SIZE, &max_texture_size);
+
+	unsigned int cascade_size = max (1u, min (size, MaxSize));
+	while (cascade_size * columns > static_cast<unsigned int>(max_texture_size))
+		cascade_size /= 2;
+
+	if (cascade_size == texture_size && columns == texture_columns && rows == texture_rows)
+		return;
+
+	texture_size = cascade_size;
+	texture_columns = columns;
+	texture_rows = rows;
+
+	glBindTexture (GL_TEXTURE_2D, texture_id);
+	glTexImage2D (GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24,
+			texture_size * texture_columns, texture_size * texture_rows,
+			0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+	// linear filtering of the comparison results gives 2x2 percentage
+	// closer filtering
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture (GL_TEXTURE_2D, 0);
+
+	GLint framebuffer = 0;
+	glGetIntegerv (GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+	glBindFramebuffer (GL_FRAMEBUFFER, framebuffer_id);
+	glFramebufferTexture2D (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture_id, 0);
+	glDrawBuffer (GL_NONE);
+	glReadBuffer (GL_NONE);
+
+	if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		initialized = false;
+
+	glBindFramebuffer (GL_FRAMEBUFFER, framebuffer);
+}
+
+void ShadowMap::update (const Matrix44f &camera_view, const Matrix44f &camera_projection, const Vector4f &light_position) {
+	assert (initialized);
+
+	allocateTexture();
+
+	// near and far plane of the camera (row vector convention, i.e. the
+	// transpose of the OpenGL matrix)
+	const Matrix44f &P = camera_projection;
+	float near, far;
+	if (P(3,3) == 0.f) {
+		near = P(3,2) / (P(2,2) - 1.f);
+		far = P(3,2) / (P(2,2) + 1.f);
+	} else {
+		near = (P(3,2) + 1.f) / P(2,2);
+		far = (P(3,2) - 1.f) / P(2,2);
+	}
+
+	// corners of the view frustum in world coordinates
+	Matrix44f ndc_to_world = Matrix44f ((camera_view * camera_projection).inverse()).transpose();
+	Vector3f near_corners[4], far_corners[4];
+	for (unsigned int i = 0; i < 4; i++) {
+		float x = (i & 1) ? 1.f : -1.f;
+		float y = (i & 2) ? 1.f : -1.f;
+
+		Vector4f p_near = ndc_to_world * Vector4f (x, y, -1.f, 1.f);
+		Vector4f p_far = ndc_to_world * Vector4f (x, y, 1.f, 1.f);
+		near_corners[i] = Vector3f (p_near[0], p_near[1], p_near[2]) / p_near[3];
+		far_corners[i] = Vector3f (p_far[0], p_far[1], p_far[2]) / p_far[3];
+	}
+
+	// split distances: blend of logarithmic and uniform distribution
+	float split_near = max (near, 0.05f);
+	float split_far = max (split_near, min (far, shadow_distance));
+	for (unsigned int i = 0; i < cascade_count; i++) {
+		float ratio = static_cast<float>(i + 1) / cascade_count;
+		float log_split = split_near * powf (split_far / split_near, ratio);
+		float uniform_split = split_near + (split_far - split_near) * ratio;
+		split_distances[i] = split_lambda * log_split + (1.f - split_lambda) * uniform_split;
+	}
+
+	// direction of the light rays (the light is assumed to point at the
+	// origin)
+	Vector3f light_dir = Vector3f (-light_position[0], -light_position[1], -light_position[2]);
+	if (light_dir.squaredNorm() == 0.f)
+		light_dir.set (0.f, -1.f, 0.f);
+	light_dir.normalize();
+
+	Vector3f up (0.f, 1.f, 0.f);
+	if (fabs (light_dir.dot (up)) > 0.99f)
+		up.set (1.f, 0.f, 0.f);
+
+	Vector3f side = light_dir.cross (up).normalized();
+	up = side.cross (light_dir);
+
+	Matrix44f camera_view_inverse (camera_view.inverse());
+
+	float slice_start = near;
+	for (unsigned int i = 0; i < cascade_count; i++) {
+		float t0 = (slice_start - near) / (far - near);
+		float t1 = (split_distances[i] - near) / (far - near);
+		slice_start = split_distances[i];
+
+		// bounding sphere of the frustum slice
+		Vector3f corners[8];
+		Vector3f center (0.f, 0.f, 0.f);
+		for (unsigned int j = 0; j < 4; j++) {
+			corners[j] = near_corners[j] + (far_corners[j] - near_corners[j]) * t0;
+			corners[j + 4] = near_corners[j] + (far_corners[j] - near_corners[j]) * t1;
+			center += corners[j] + corners[j + 4];
+		}
+		center = center / 8.f;
+
+		float radius = 0.f;
+		for (unsigned int j = 0; j < 8; j++)
+			radius = max (radius, (corners[j] - center).norm());
+
+		// a constant size avoids flickering when the camera rotates
+		radius = ceilf (radius * 16.f) / 16.f;
+
+		Vector3f eye = center - light_dir * (radius + caster_distance);
+
+		Matrix44f &light_view = light_views[i];
+		light_view = Matrix44f::Identity();
+		for (unsigned int j = 0; j < 3; j++) {
+			light_view(j,0) = side[j];
+			light_view(j,1) = up[j];
+			light_view(j,2) = -light_dir[j];
+		}
+		light_view(3,0) = -side.dot (eye);
+		light_view(3,1) = -up.dot (eye);
+		light_view(3,2) = light_dir.dot (eye);
+
+		float depth_range = 2.f * radius + caster_distance;
+
+		Matrix44f &light_projection = light_projections[i];
+		light_projection.setZero();
+		light_projection(0,0) = 1.f / radius;
+		light_projection(1,1) = 1.f / radius;
+		light_projection(2,2) = -2.f / depth_range;
+		light_projection(3,2) = -1.f;
+		light_projection(3,3) = 1.f;
+
+		// move the projection in whole texels such that the shadow edges
+		// do not flicker when the camera moves
+		Matrix44f light_matrix = light_view * light_projection;
+		float half_size = texture_size * 0.5f;
+		float origin_x = light_matrix(3,0) * half_size;
+		float origin_y = light_matrix(3,1) * half_size;
+		light_projection(3,0) += (floorf (origin_x + 0.5f) - origin_x) / half_size;
+		light_projection(3,1) += (floorf (origin_y + 0.5f) - origin_y) / half_size;
+
+		// clip space to the texture coordinates of the cascade tile
+		float tile_scale_x = 1.f / texture_columns;
+		float tile_scale_y = 1.f / texture_rows;
+		Matrix44f tile_matrix (
+				0.5f * tile_scale_x, 0.f, 0.f, 0.f,
+				0.f, 0.5f * tile_scale_y, 0.f, 0.f,
+				0.f, 0.f, 0.5f, 0.f,
+				(0.5f + (i % texture_columns)) * tile_scale_x, (0.5f + (i / texture_columns)) * tile_scale_y, 0.5f, 1.f);
+
+		world_to_shadow[i] = light_view * light_projection * tile_matrix;
+		eye_to_shadow[i] = camera_view_inverse * world_to_shadow[i];
+	}
+}
+
+void ShadowMap::beginCascade (unsigned int cascade) {
+	assert (initialized && cascade < cascade_count);
+
+	glGetIntegerv (GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+	glGetIntegerv (GL_VIEWPORT, previous_viewport);
+
+	glBindFramebuffer (GL_FRAMEBUFFER, framebuffer_id);
+
+	if (cascade == 0) {
+		glDepthMask (GL_TRUE);
+		glClear (GL_DEPTH_BUFFER_BIT);
+	}
+
+	glViewport ((cascade % texture_columns) * texture_size, (cascade / texture_columns) * texture_size, texture_size, texture_size);
+
+	glMatrixMode (GL_PROJECTION);
+	glPushMatrix();
+	glLoadMatrixf (light_projections[cascade].data());
+
+	glMatrixMode (GL_MODELVIEW);
+	glPushMatrix();
+	glLoadMatrixf (light_views[cascade].data());
+
+	// only depth is needed, the offset avoids self shadowing
+	glColorMask (GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glEnable (GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset (2.f, 4.f);
+}
+
+void ShadowMap::endCascade () {
+	glDisable (GL_POLYGON_OFFSET_FILL);
+	glColorMask (GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	glMatrixMode (GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode (GL_MODELVIEW);
+	glPopMatrix();
+
+	glBindFramebuffer (GL_FRAMEBUFFER, previous_framebuffer);
+	glViewport (previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+}
@@ -0,0 +1,101 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_SHADOWMAP_H
+#define MESHUP_SHADOWMAP_H
+
+#include "Math.h"
+
+/** \brief Cascaded shadow map rendered into a depth texture framebuffer.
+ *
+ * The view frustum of the camera (up to shadow_distance) is split into
+ * cascade_count slices. Each slice gets its own orthographic light
+ * projection which is rendered into one tile of a single depth texture
+ * (cascades are arranged in a 2x2 grid). The tile size can be chosen up to
+ * 4096 texels.
+ *
+ * Usage:
+ *
+ * \code
+ *	shadow_map.update (camera_view, camera_projection, light_position);
+ *	for (unsigned int i = 0; i < shadow_map.cascade_count; i++) {
+ *		shadow_map.beginCascade (i);
+ *		// draw the shadow casters
+ *		shadow_map.endCascade();
+ *	}
+ * \endcode
+ *
+ * The lookup is done in the fragment shader of ShaderRenderer using
+ * eye_to_shadow. Without shaders the first cascade can be used with
+ * fixed function texture coordinate generation (world_to_shadow).
+ */
+struct ShadowMap {
+	ShadowMap();
+	~ShadowMap();
+
+	static const unsigned int MaxCascades = 4;
+	static const unsigned int MaxSize = 4096;
+
+	/// Requested size of each cascade in texels
+	unsigned int size;
+	/// Requested number of cascades (1 to MaxCascades)
+	unsigned int cascade_count;
+	/// Blend between uniform (0) and logarithmic (1) split distances
+	float split_lambda;
+	/// Maximum distance from the camera at which shadows are drawn
+	float shadow_distance;
+	/// Distance behind the view frustum in which objects still cast shadows
+	float caster_distance;
+
+	/// Whether the framebuffer could be created
+	bool initialized;
+
+	unsigned int framebuffer_id;
+	unsigned int texture_id;
+	/// Size of a cascade in the allocated texture
+	unsigned int texture_size;
+	unsigned int texture_columns;
+	unsigned int texture_rows;
+
+	/// Far distances of the cascades (positive distance along the view
+	/// direction)
+	float split_distances[MaxCascades];
+	/// World to light clip space of each cascade
+	Matrix44f light_views[MaxCascades];
+	Matrix44f light_projections[MaxCascades];
+	/// Camera eye coordinates to texture coordinates (including the
+	/// cascade tile)
+	Matrix44f eye_to_shadow[MaxCascades];
+	/// World coordinates to texture coordinates (including the cascade tile)
+	Matrix44f world_to_shadow[MaxCascades];
+
+	/// Creates the framebuffer (requires a current GL context). Returns
+	/// false if framebuffer objects or depth textures are not supported.
+	bool init();
+	void destroy();
+
+	/// Computes the cascades for the camera and the light position (world
+	/// coordinates, treated as a directional light towards the origin if
+	/// w == 1) and (re-)allocates the texture if the size changed.
+	void update (const Matrix44f &camera_view, const Matrix44f &camera_projection, const Vector4f &light_position);
+
+	/// Binds the framebuffer and sets up viewport and matrices for
+	/// rendering the depth of a cascade. The first cascade clears the
+	/// whole texture.
+	void beginCascade (unsigned int cascade);
+	/// Restores the framebuffer, viewport and matrices
+	void endCascade ();
+
+	int previous_framebuffer;
+	int previous_viewport[4];
+
+	void allocateTexture();
+};
+
+#endif
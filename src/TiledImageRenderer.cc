@@ -0,0 +1,171 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "GL/glew.h"
+
+#include "TiledImageRenderer.h"
+#include "SceneRenderer.h"
+#include "Camera.h"
+#include "OffscreenFramebuffer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+TiledImageRenderer::TiledImageRenderer (int tile_size) :
+	tile_size (tile_size),
+	width (0),
+	height (0),
+	tile_width (0),
+	tile_height (0),
+	column_count (0),
+	failed (false),
+	free_strips (2),
+	write_queue (2),
+	current_strip (NULL)
+{}
+
+bool TiledImageRenderer::render (SceneRenderer &renderer, Camera &camera, OffscreenFramebuffer &framebuffer, const std::string &filename, int width, int height, bool alpha, ImageFileFormat format) {
+	// the frames of a running export are not read here
+	if (framebuffer.pending_count > 0 || framebuffer.mapped_count > 0)
+		return false;
+
+	GLint max_texture_size = 0;
+	GLint max_renderbuffer_size = 0;
+	glGetIntegerv (GL_MAX_TEXTURE_SIZE, &max_texture_size);
+	glGetIntegerv (GL_MAX_RENDERBUFFER_SIZE, &max_renderbuffer_size);
+	int size = min (tile_size, static_cast<int>(min (max_texture_size, max_renderbuffer_size)));
+
+	this->width = width;
+	this->height = height;
+	tile_width = min (size, width);
+	tile_height = min (size, height);
+	column_count = (width + tile_width - 1) / tile_width;
+	int row_count = (height + tile_height - 1) / tile_height;
+
+	if (!framebuffer.init (tile_width, tile_height, alpha))
+		return false;
+
+	if (!writer.open (filename, width, height, alpha, format)) {
+		cerr << "Error: could not create " << filename << "!" << endl;
+		return false;
+	}
+
+	cout << "Rendering " << width << "x" << height << " in " << column_count * row_count << " tiles of " << tile_width << "x" << tile_height << " to " << filename << endl;
+
+	strips.assign (free_strips.capacity, vector<unsigned char> (static_cast<size_t>(width) * tile_height * 4));
+	for (unsigned int i = 0; i < strips.size(); i++)
+		free_strips.push (&strips[i][0]);
+
+	failed = false;
+	writing_thread = std::thread (&TiledImageRenderer::write, this);
+
+	int camera_width = camera.width;
+	int camera_height = camera.height;
+	camera.setSize (width, height);
+
+	// the tiles are drawn row by row from the top, each one is finished
+	// once the following ones were drawn
+	int tile_count = column_count * row_count;
+	int finished_count = 0;
+	bool result = true;
+
+	for (int i = 0; result && i < tile_count; i++) {
+		if (framebuffer.isFull() && !finishTile (framebuffer, finished_count++)) {
+			result = false;
+			break;
+		}
+
+		int column = i % column_count;
+		int row = i / column_count;
+
+		// the tiles of the last row and column may reach beyond the image
+		camera.setTile (
+				static_cast<float>(column * tile_width) / width,
+				static_cast<float>(height - (row + 1) * tile_height) / height,
+				static_cast<float>(tile_width) / width,
+				static_cast<float>(tile_height) / height);
+
+		framebuffer.bind();
+		renderer.renderFrame (&camera);
+		framebuffer.startRead();
+	}
+
+	while (result && framebuffer.pending_count > 0) {
+		if (!finishTile (framebuffer, finished_count++))
+			result = false;
+	}
+
+	framebuffer.discardPending();
+	framebuffer.release();
+
+	camera.setTile (0.f, 0.f, 1.f, 1.f);
+	camera.setSize (camera_width, camera_height);
+
+	// the thread writes the queued strips and then stops
+	write_queue.close();
+	writing_thread.join();
+
+	result = writer.close() && result && !failed;
+	if (!result)
+		cerr << "Error: could not write " << filename << "!" << endl;
+
+	strips.clear();
+	current_strip = NULL;
+
+	return result;
+}
+
+bool TiledImageRenderer::finishTile (OffscreenFramebuffer &framebuffer, int tile_index) {
+	int column = tile_index % column_count;
+	int row = tile_index / column_count;
+
+	// waits until the writer is done with the strip
+	if (column == 0 && (failed || !free_strips.pop (current_strip)))
+		return false;
+
+	const unsigned char *pixels = framebuffer.mapRead();
+	if (pixels == NULL)
+		return false;
+
+	int left = column * tile_width;
+	int copy_width = min (tile_width, width - left);
+	int copy_height = min (tile_height, height - row * tile_height);
+
+	// OpenGL stores the bottom row of the tile first, the strip starts
+	// with its top row
+	for (int y = 0; y < copy_height; y++) {
+		const unsigned char *source = pixels + static_cast<size_t>(tile_height - 1 - y) * tile_width * 4;
+		memcpy (current_strip + (static_cast<size_t>(y) * width + left) * 4, source, copy_width * 4);
+	}
+
+	framebuffer.unmapRead();
+
+	if (column == column_count - 1)
+		return write_queue.push (current_strip) && !failed;
+
+	return true;
+}
+
+void TiledImageRenderer::write() {
+	unsigned char *strip;
+	while (write_queue.pop (strip)) {
+		int row_count = min (tile_height, height - writer.row_count);
+
+		// strips after an error are dropped
+		for (int y = 0; !failed && y < row_count; y++) {
+			if (!writer.writeRow (strip + static_cast<size_t>(y) * width * 4))
+				failed = true;
+		}
+
+		free_strips.push (strip);
+	}
+}
@@ -0,0 +1,89 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_TILEDIMAGERENDERER_H
+#define MESHUP_TILEDIMAGERENDERER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "ImageFile.h"
+#include "ImageRowWriter.h"
+#include "BoundedQueue.h"
+
+struct SceneRenderer;
+struct Camera;
+struct OffscreenFramebuffer;
+
+/** \brief Renders images that are larger than a framebuffer, e.g. posters,
+ * in tiles and writes them row by row.
+ *
+ * Each tile is drawn into the same framebuffer of at most tile_size x
+ * tile_size pixels using its part of the view frustum (see
+ * Camera::setTile()). The tiles are read back asynchronously while the
+ * following ones are drawn and copied into a strip of the full image width.
+ * A thread writes the finished strips with an ImageRowWriter while the next
+ * strip is drawn. The memory use therefore only depends on the width of the
+ * image and the tile size (two strips of width x tile_size pixels), never
+ * on the height.
+ *
+ * Usage:
+ *
+ * \code
+ *	TiledImageRenderer tiled_renderer;
+ *	if (tiled_renderer.needsTiles (16000, 9000))
+ *		tiled_renderer.render (renderer, camera, framebuffer, "poster.png", 16000, 9000, false, ImageFilePNG);
+ * \endcode
+ */
+struct TiledImageRenderer {
+	TiledImageRenderer (int tile_size = 2048);
+
+	/// Whether an image of the given size is larger than a single tile
+	bool needsTiles (int width, int height) const {
+		return width > tile_size || height > tile_size;
+	}
+	/// Draws the current scene of the renderer seen by the camera into the
+	/// file. Requires the context of the framebuffer to be current and no
+	/// pending frames in the framebuffer, which is recreated with the size
+	/// of a tile. The size and the tile of the camera are restored
+	/// afterwards. Returns false if the image could not be written. Can
+	/// only be called once.
+	bool render (SceneRenderer &renderer, Camera &camera, OffscreenFramebuffer &framebuffer, const std::string &filename, int width, int height, bool alpha, ImageFileFormat format);
+
+	/// Maximal width and height of a tile, also limited by the maximal
+	/// size of textures and renderbuffers
+	int tile_size;
+
+	int width;
+	int height;
+	int tile_width;
+	int tile_height;
+	int column_count;
+
+	ImageRowWriter writer;
+	/// Set by the writing thread
+	std::atomic<bool> failed;
+
+	std::vector<std::vector<unsigned char> > strips;
+	BoundedQueue<unsigned char*> free_strips;
+	BoundedQueue<unsigned char*> write_queue;
+	/// Strip of the tiles that are currently read back
+	unsigned char *current_strip;
+
+	std::thread writing_thread;
+
+	/// Copies the oldest pending tile into the current strip and passes
+	/// the strip to the writing thread once it is complete
+	bool finishTile (OffscreenFramebuffer &framebuffer, int tile_index);
+	void write();
+};
+
+#endif
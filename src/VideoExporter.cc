@@ -0,0 +1,280 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "VideoExporter.h"
+#include "OffscreenFramebuffer.h"
+
+#include <iostream>
+
+using namespace std;
+
+// each stage holds one item while working on it, the caller and the
+// converter hold one pixel buffer, the converter and the encoder one frame
+VideoExporter::VideoExporter (unsigned int queue_size) :
+	width (0),
+	height (0),
+	pixel_format (PixelFormatBGRA),
+	is_open (false),
+	failed (false),
+	free_pixels (queue_size + 2),
+	conversion_queue (queue_size),
+	released_pixels (queue_size + 2),
+	free_frames (queue_size + 2),
+	encoding_queue (queue_size)
+{}
+
+VideoExporter::~VideoExporter() {
+	close();
+}
+
+bool VideoExporter::open (const std::string &filename, int width, int height, unsigned int fps, const QVideoEncoderSettings &settings) {
+	this->width = width;
+	this->height = height;
+
+	if (!encoder.createFile (QString::fromStdString (filename), width, height, fps, settings))
+		return false;
+
+	for (unsigned int i = 0; i < free_pixels.capacity; i++) {
+		int frame_size = pixel_format == PixelFormatYUV420 ? width * height * 3 / 2 : width * height * 4;
+		pixel_buffers.push_back (new unsigned char[frame_size]);
+		free_pixels.push (pixel_buffers[i]);
+	}
+
+	for (unsigned int i = 0; i < free_frames.capacity; i++) {
+		AVFrame *frame = encoder.allocFrame();
+		if (frame == NULL) {
+			cerr << "Error: could not allocate video frames!" << endl;
+			is_open = true;
+			failed = true;
+			close();
+			return false;
+		}
+		frames.push_back (frame);
+		free_frames.push (frame);
+	}
+
+	is_open = true;
+	conversion_thread = std::thread (&VideoExporter::convert, this);
+	encoding_thread = std::thread (&VideoExporter::encode, this);
+
+	return true;
+}
+
+unsigned char* VideoExporter::acquirePixels() {
+	unsigned char *pixels = NULL;
+
+	if (failed || !free_pixels.pop (pixels))
+		return NULL;
+
+	return pixels;
+}
+
+bool VideoExporter::submitPixels (unsigned char *pixels) {
+	QueuedPixels item = { pixels, false };
+	if (!conversion_queue.push (item))
+		return false;
+
+	return !failed;
+}
+
+bool VideoExporter::submitExternalPixels (const unsigned char *pixels) {
+	QueuedPixels item = { pixels, true };
+	if (!conversion_queue.push (item))
+		return false;
+
+	return !failed;
+}
+
+bool VideoExporter::submitFrame (OffscreenFramebuffer &framebuffer) {
+	const unsigned char *pixels = framebuffer.mapRead();
+	if (pixels == NULL)
+		return false;
+
+	return submitExternalPixels (pixels);
+}
+
+bool VideoExporter::reserveFrame (OffscreenFramebuffer &framebuffer) {
+	while (framebuffer.isFull()) {
+		const unsigned char *pixels;
+
+		if (framebuffer.mapped_count > 0 && released_pixels.tryPop (pixels)) {
+			framebuffer.unmapRead();
+		} else if (framebuffer.pending_count > 1 || (framebuffer.pending_count == 1 && framebuffer.mapped_count == 0)) {
+			// the newest frame keeps transferring while the older ones are
+			// converted
+			if (!submitFrame (framebuffer))
+				return false;
+		} else {
+			// the converter is the slowest stage
+			if (!released_pixels.pop (pixels))
+				return false;
+			framebuffer.unmapRead();
+		}
+	}
+
+	return !failed;
+}
+
+bool VideoExporter::finishFrames (OffscreenFramebuffer &framebuffer) {
+	bool result = true;
+
+	while (framebuffer.pending_count > 0) {
+		if (!submitFrame (framebuffer)) {
+			result = false;
+			break;
+		}
+	}
+
+	// the converter may still read the mapped buffers
+	const unsigned char *pixels;
+	while (framebuffer.mapped_count > 0 && released_pixels.pop (pixels))
+		framebuffer.unmapRead();
+
+	framebuffer.discardPending();
+
+	return result && !failed;
+}
+
+bool VideoExporter::close() {
+	if (!is_open)
+		return false;
+
+	// the threads finish the queued frames and then stop
+	conversion_queue.close();
+	if (conversion_thread.joinable())
+		conversion_thread.join();
+	if (encoding_thread.joinable())
+		encoding_thread.join();
+
+	// also writes the frames delayed by the encoder
+	bool result = encoder.close() && !failed;
+
+	for (unsigned int i = 0; i < pixel_buffers.size(); i++)
+		delete[] pixel_buffers[i];
+	for (unsigned int i = 0; i < frames.size(); i++)
+		QVideoEncoder::releaseFrame (frames[i]);
+
+	pixel_buffers.clear();
+	frames.clear();
+	is_open = false;
+
+	return result;
+}
+
+void VideoExporter::convert() {
+	SwsContext *convert_ctx = NULL;
+
+	QueuedPixels item;
+	while (conversion_queue.pop (item)) {
+		AVFrame *frame;
+		free_frames.pop (frame);
+
+		// frames after an error are dropped
+		bool converted = true;
+		if (!failed && pixel_format == PixelFormatYUV420) {
+			converted = encoder.convertPixels (item.pixels, width, AV_PIX_FMT_YUV420P, frame, &convert_ctx);
+		} else if (!failed) {
+			// starts at the top row, which OpenGL stores last
+			int stride = width * 4;
+			converted = encoder.convertPixels (item.pixels + (height - 1) * stride, -stride, AV_PIX_FMT_BGRA, frame, &convert_ctx);
+		}
+
+		if (!failed && !converted) {
+			cerr << "Error: could not convert a video frame!" << endl;
+			failed = true;
+		}
+
+		if (item.external)
+			released_pixels.push (item.pixels);
+		else
+			free_pixels.push (const_cast<unsigned char*>(item.pixels));
+		encoding_queue.push (frame);
+	}
+
+	sws_freeContext (convert_ctx);
+	encoding_queue.close();
+}
+
+void VideoExporter::encode() {
+	AVFrame *frame;
+	while (encoding_queue.pop (frame)) {
+		if (!failed && encoder.encodeFrame (frame) < 0) {
+			cerr << "Error: could not encode a video frame!" << endl;
+			failed = true;
+		}
+
+		free_frames.push (frame);
+	}
+}
+
+const char* video_codec_name (QVideoEncoderSettings::Codec codec) {
+	if (codec == QVideoEncoderSettings::CodecMPEG4)
+		return "mpeg4";
+
+	return "h264";
+}
+
+bool parse_video_codec (const std::string &name, QVideoEncoderSettings::Codec &codec) {
+	if (name == "h264")
+		codec = QVideoEncoderSettings::CodecH264;
+	else if (name == "mpeg4")
+		codec = QVideoEncoderSettings::CodecMPEG4;
+	else
+		return false;
+
+	return true;
+}
+
+const char* video_thread_type_name (QVideoEncoderSettings::ThreadType thread_type) {
+	if (thread_type == QVideoEncoderSettings::ThreadFrame)
+		return "frame";
+	else if (thread_type == QVideoEncoderSettings::ThreadSlice)
+		return "slice";
+
+	return "frame+slice";
+}
+
+bool parse_video_thread_type (const std::string &name, QVideoEncoderSettings::ThreadType &thread_type) {
+	if (name == "frame")
+		thread_type = QVideoEncoderSettings::ThreadFrame;
+	else if (name == "slice")
+		thread_type = QVideoEncoderSettings::ThreadSlice;
+	else if (name == "frame+slice")
+		thread_type = QVideoEncoderSettings::ThreadFrameAndSlice;
+	else
+		return false;
+
+	return true;
+}
+
+const char* video_scaler_name (QVideoEncoderSettings::Scaler scaler) {
+	if (scaler == QVideoEncoderSettings::ScalerBilinear)
+		return "bilinear";
+	else if (scaler == QVideoEncoderSettings::ScalerBicubic)
+		return "bicubic";
+	else if (scaler == QVideoEncoderSettings::ScalerPoint)
+		return "point";
+
+	return "fast_bilinear";
+}
+
+bool parse_video_scaler (const std::string &name, QVideoEncoderSettings::Scaler &scaler) {
+	if (name == "fast_bilinear")
+		scaler = QVideoEncoderSettings::ScalerFastBilinear;
+	else if (name == "bilinear")
+		scaler = QVideoEncoderSettings::ScalerBilinear;
+	else if (name == "bicubic")
+		scaler = QVideoEncoderSettings::ScalerBicubic;
+	else if (name == "point")
+		scaler = QVideoEncoderSettings::ScalerPoint;
+	else
+		return false;
+
+	return true;
+}
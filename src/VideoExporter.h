@@ -0,0 +1,141 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#ifndef MESHUP_VIDEOEXPORTER_H
+#define MESHUP_VIDEOEXPORTER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "QVideoEncoder.h"
+#include "BoundedQueue.h"
+
+struct OffscreenFramebuffer;
+
+/** \brief Writes rendered frames to a video with the color conversion and
+ * the encoding each running in their own thread.
+ *
+ * The stages are connected by queues of at most queue_size frames such
+ * that the rendering thread only waits if a later stage is slower. The
+ * pixel buffers and the converted frames are allocated once and passed
+ * around through the queues.
+ *
+ * Frames of an OffscreenFramebuffer are passed without any copy: the
+ * converter reads the pixels straight from the mapped pixel buffer object,
+ * which is only unmapped once the frame is converted. If the framebuffer
+ * already converts to YUV on the GPU the converter only copies the planes.
+ *
+ * Usage:
+ *
+ * \code
+ *	VideoExporter exporter;
+ *	exporter.open ("video.mp4", 1280, 720, 25);
+ *	for (each frame) {
+ *		exporter.reserveFrame (framebuffer);
+ *		// draw the frame into framebuffer
+ *		framebuffer.startRead();
+ *	}
+ *	exporter.finishFrames (framebuffer);
+ *	exporter.close();
+ * \endcode
+ *
+ * Pixels from other sources are copied into buffers of the exporter with
+ * acquirePixels() and submitPixels().
+ */
+struct VideoExporter {
+	VideoExporter (unsigned int queue_size = 4);
+	~VideoExporter();
+
+	enum PixelFormat {
+		/// 8 bit BGRA pixels with the rows from bottom to top as read by
+		/// OpenGL
+		PixelFormatBGRA,
+		/// Y, U and V planes of YUV 4:2:0 with the rows from top to bottom
+		/// (see OffscreenFramebuffer)
+		PixelFormatYUV420
+	};
+
+	/// Creates the video file and starts the threads. Can only be called
+	/// once.
+	bool open (const std::string &filename, int width, int height, unsigned int fps, const QVideoEncoderSettings &settings = QVideoEncoderSettings());
+	/// Returns a buffer for the pixels of the next frame, blocks while all
+	/// buffers are in use. Returns NULL after an error.
+	unsigned char* acquirePixels();
+	/// Queues the pixels of an acquired buffer for the conversion and the
+	/// encoding. Returns false after an error.
+	bool submitPixels (unsigned char *pixels);
+	/// Queues pixels that stay owned by the caller, e.g. a mapped pixel
+	/// buffer. They are pushed to released_pixels once they were converted.
+	/// At most queue_size + 2 of them may be in use at the same time.
+	bool submitExternalPixels (const unsigned char *pixels);
+	/// Makes room for the next frame in the ring of the framebuffer: maps
+	/// the oldest pending frames and submits them, and unmaps the converted
+	/// ones, which waits for the converter if all buffers are in use.
+	/// Requires the context of the framebuffer to be current. Returns false
+	/// after an error.
+	bool reserveFrame (OffscreenFramebuffer &framebuffer);
+	/// Submits all pending frames of the framebuffer and waits until all
+	/// of them are converted. Has to be called before the framebuffer is
+	/// used for anything else, also after errors.
+	bool finishFrames (OffscreenFramebuffer &framebuffer);
+	/// Waits until all frames are encoded and closes the file. Returns
+	/// false if any frame could not be written.
+	bool close();
+
+	int width;
+	int height;
+	/// Format of the submitted pixels, set before open()
+	PixelFormat pixel_format;
+	bool is_open;
+	/// Set by the worker threads, frames after an error are dropped
+	std::atomic<bool> failed;
+
+	QVideoEncoder encoder;
+
+	struct QueuedPixels {
+		const unsigned char *pixels;
+		/// Not one of pixel_buffers
+		bool external;
+	};
+
+	/// Pixel buffers that can be acquired
+	BoundedQueue<unsigned char*> free_pixels;
+	BoundedQueue<QueuedPixels> conversion_queue;
+	/// External pixels that were converted, in the order of submission
+	BoundedQueue<const unsigned char*> released_pixels;
+	/// YUV frames that can be converted into
+	BoundedQueue<AVFrame*> free_frames;
+	BoundedQueue<AVFrame*> encoding_queue;
+
+	std::vector<unsigned char*> pixel_buffers;
+	std::vector<AVFrame*> frames;
+
+	std::thread conversion_thread;
+	std::thread encoding_thread;
+
+	/// Maps the oldest pending frame of the framebuffer and submits it
+	bool submitFrame (OffscreenFramebuffer &framebuffer);
+	void convert();
+	void encode();
+};
+
+/// Names of the encoder settings as used in the settings file, by Lua and
+/// on the command line: "h264" or "mpeg4"
+const char* video_codec_name (QVideoEncoderSettings::Codec codec);
+bool parse_video_codec (const std::string &name, QVideoEncoderSettings::Codec &codec);
+/// "frame", "slice" or "frame+slice"
+const char* video_thread_type_name (QVideoEncoderSettings::ThreadType thread_type);
+bool parse_video_thread_type (const std::string &name, QVideoEncoderSettings::ThreadType &thread_type);
+/// "fast_bilinear", "bilinear", "bicubic" or "point"
+const char* video_scaler_name (QVideoEncoderSettings::Scaler scaler);
+bool parse_video_scaler (const std::string &name, QVideoEncoderSettings::Scaler &scaler);
+
+#endif
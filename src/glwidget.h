@@ -16,10 +16,12 @@
 
 #include "Camera.h"
 #include "CameraOperator.h"
+#include "SceneRenderer.h"
+#include "OffscreenFramebuffer.h"
 
-struct Scene;
-
-class GLWidget : public QGLWidget
+/** \brief Shows the scene in the main window, the drawing settings are
+ * inherited from SceneRenderer. */
+class GLWidget : public QGLWidget, public SceneRenderer
 {
 	Q_OBJECT
 
@@ -30,29 +32,25 @@ class GLWidget : public QGLWidget
 		QSize minimumSizeHint() const;
 		QSize sizeHint() const;
 
-		Scene *scene;
-
 		QImage renderContentOffscreen (int image_width, int image_height, bool use_alpha);
+		/// Draws the scene into offscreen_framebuffer and starts reading it
+		/// back asynchronously, converted to YUV planes if yuv is set. If
+		/// all pixel buffers are in use, the oldest frame has to be read
+		/// with readOffscreenFrame() (or mapped) first.
+		bool renderOffscreenFrame (int image_width, int image_height, bool use_alpha, bool yuv = false);
+		/// Copies the oldest pending frame of renderOffscreenFrame() as BGRA
+		/// pixels with the rows from bottom to top
+		bool readOffscreenFrame (unsigned char *bgra_pixels);
+		/// Draws an image larger than a framebuffer in tiles and writes it
+		/// row by row to a .png, .tga or .ppm file (see TiledImageRenderer)
+		bool renderTiledImage (const std::string &filename, int image_width, int image_height, bool use_alpha);
+
+		/// Kept for all offscreen images, recreated if the size changes
+		OffscreenFramebuffer offscreen_framebuffer;
 
 		Camera* cam;
 		Camera** camera;
 
-		bool draw_base_axes;
-		bool draw_frame_axes;
-		bool draw_grid;
-		bool draw_floor;
-		bool draw_meshes;
-		bool draw_shadows;
-		bool draw_curves;
-		bool draw_points;
-
-		bool draw_forces;
-		bool draw_torques;
-
-		bool white_mode;
-
-		Vector4f light_position;
-
 		Vector3f getCameraPoi();
 		Vector3f getCameraEye();
 
@@ -63,11 +61,11 @@ class GLWidget : public QGLWidget
 
 	protected:
 		void update_timer();
-		void drawGrid();
 
 		void initializeGL();
-		void drawScene ();
 		void paintGL();
+		/// Draws the scene, the profiler overlay and swaps the buffers
+		void glDraw();
 		void resizeGL(int width, int height);
 
 		void keyPressEvent (QKeyEvent* event);
@@ -75,12 +73,8 @@ class GLWidget : public QGLWidget
 		void mouseMoveEvent(QMouseEvent *event);
 
 	private:
-		void updateLightingMatrices();
-
-		void shadowMapSetupPass1();
-		void shadowMapSetupPass2();
-		void shadowMapSetupPass3();
-		void shadowMapCleanup();
+		/// Prints the average times of the profiler phases
+		void drawProfilerOverlay();
 
 		QPoint lastMousePos;
 
@@ -119,6 +113,8 @@ class GLWidget : public QGLWidget
 
 	signals:
 		void camera_changed();
+		/// Emitted when a setting changed that requires redrawing
+		void redraw_requested();
 		void start_draw();
 		void toggle_camera_fix(bool status);
 		void opengl_initialized();
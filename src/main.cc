@@ -8,16 +8,27 @@
  */
 
 #include <QApplication>
+#include <QCoreApplication>
 
 #include "MeshupApp.h"
+#include "HeadlessRender.h"
 //#include "glwidget.h"
 
 #include <iostream>
+#include <string>
 
 using namespace std;
 
 int main(int argc, char *argv[])
 {
+	// rendering without a window must not connect to a display server
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "--render") {
+			QCoreApplication app(argc, argv);
+			return render_headless (argc, argv);
+		}
+	}
+
 	setup_unix_signal_handlers();
 	QApplication app(argc, argv);
 	MeshupApp *main_window = new MeshupApp;
@@ -3,6 +3,8 @@
 
 #cmakedefine MESHUP_VERSION_STRING "@MESHUP_VERSION_STRING@"
 #cmakedefine MESHUP_INSTALL_PREFIX "@MESHUP_INSTALL_PREFIX@"
+#cmakedefine MESHUP_USE_EGL
+#cmakedefine MESHUP_USE_PNG
 
  /* _MESHUP_CONFIG_H */
 #endif
@@ -0,0 +1,67 @@
+#include <UnitTest++.h>
+
+#include "Arrow.h"
+#include "SimpleMath/SimpleMathGL.h"
+
+#include <cmath>
+
+using namespace std;
+
+const float ARROW_TEST_PREC = 1.0e-5;
+
+/** Transformation as computed by the former per arrow code using axis and
+ * angle of the rotation.
+ */
+Matrix44f calc_arrow_transform_axis_angle (const Vector3f &position, const Vector3f &direction, float scale) {
+	Vector3f unit_axis_vec (0.f, 1.f, 0.f);
+	Vector3f d = direction.normalized();
+	Vector3f v = unit_axis_vec.cross (d);
+	float angle = acos (min (1.f, max (-1.f, unit_axis_vec.dot (d)))) * 180.f / M_PI;
+
+	if (v.norm() < 0.00001f) {
+		v = angle > 90.f ? Vector3f (1.f, 0.f, 0.f) : unit_axis_vec;
+	}
+	v = v.normalized();
+
+	float total_scale = direction.norm() * scale;
+
+	return SimpleMath::GL::ScaleMat44 (total_scale, total_scale, total_scale)
+		* SimpleMath::GL::RotateMat44 (angle, v[0], v[1], v[2])
+		* SimpleMath::GL::TranslateMat44 (position[0], position[1], position[2]);
+}
+
+TEST ( ArrowTransformMatchesAxisAngle ) {
+	Vector3f directions[] = {
+		Vector3f (1.f, 0.f, 0.f),
+		Vector3f (0.f, 2.f, 0.f),
+		Vector3f (0.f, -3.f, 0.f),
+		Vector3f (0.f, 0.f, 0.5f),
+		Vector3f (1.f, 2.f, 3.f),
+		Vector3f (-0.3f, -1.f, 0.2f),
+		Vector3f (0.2f, -0.1f, -4.f)
+	};
+	Vector3f position (0.5f, -1.f, 2.f);
+
+	for (size_t i = 0; i < sizeof (directions) / sizeof (Vector3f); i++) {
+		Matrix44f expected = calc_arrow_transform_axis_angle (position, directions[i], 0.7f);
+		Matrix44f transform = calc_arrow_transform (position, directions[i], 0.7f);
+
+		CHECK_ARRAY_CLOSE (expected.data(), transform.data(), 16, ARROW_TEST_PREC);
+	}
+}
+
+TEST ( ArrowCreatorAddArrowsThreshold ) {
+	ArrowList arrows;
+	arrows.addArrow (Vector3f (0.f, 0.f, 0.f), Vector3f (0.f, 0.f, 0.1f));
+	arrows.addArrow (Vector3f (1.f, 0.f, 0.f), Vector3f (0.f, 0.f, 2.f));
+
+	ArrowCreator creator;
+	creator.addArrows (arrows, Matrix33f::Identity(), Vector3f (0.f, 1.f, 0.f), 0.5f, ArrowProperties (Vector3f (1.f, 0.f, 0.f), 1.f, 0.5f));
+
+	CHECK_EQUAL (1u, creator.transforms.size());
+	CHECK_EQUAL (1u, creator.colors.size());
+
+	// translation is stored in the last row
+	CHECK_ARRAY_CLOSE (Vector3f (1.f, 1.f, 0.f).data(), &creator.transforms[0].data()[12], 3, ARROW_TEST_PREC);
+	CHECK_CLOSE (0.5f, creator.colors[0][3], ARROW_TEST_PREC);
+}
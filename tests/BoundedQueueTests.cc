@@ -0,0 +1,82 @@
+#include <UnitTest++.h>
+
+#include "BoundedQueue.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+TEST ( BoundedQueueOrder ) {
+	BoundedQueue<int> queue (3);
+
+	CHECK (queue.push (1));
+	CHECK (queue.push (2));
+	CHECK (queue.push (3));
+	CHECK_EQUAL (3u, queue.size());
+
+	int value = 0;
+	CHECK (queue.pop (value));
+	CHECK_EQUAL (1, value);
+	CHECK (queue.pop (value));
+	CHECK_EQUAL (2, value);
+	CHECK (queue.pop (value));
+	CHECK_EQUAL (3, value);
+	CHECK_EQUAL (0u, queue.size());
+}
+
+TEST ( BoundedQueueClose ) {
+	BoundedQueue<int> queue (2);
+
+	queue.push (1);
+	queue.close();
+
+	// remaining items can still be taken after closing
+	int value = 0;
+	CHECK (!queue.push (2));
+	CHECK (queue.pop (value));
+	CHECK_EQUAL (1, value);
+	CHECK (!queue.pop (value));
+}
+
+TEST ( BoundedQueueTryPop ) {
+	BoundedQueue<int> queue (2);
+
+	int value = 0;
+	CHECK (!queue.tryPop (value));
+
+	queue.push (4);
+	queue.push (5);
+	CHECK (queue.tryPop (value));
+	CHECK_EQUAL (4, value);
+
+	// frees a slot for a blocked push
+	CHECK (queue.push (6));
+	CHECK_EQUAL (2u, queue.size());
+}
+
+TEST ( BoundedQueueProducerConsumer ) {
+	BoundedQueue<int> queue (2);
+	const int item_count = 1000;
+
+	thread producer ([&queue] {
+		for (int i = 0; i < item_count; i++)
+			queue.push (i);
+		queue.close();
+	});
+
+	vector<int> values;
+	int value;
+	while (queue.pop (value)) {
+		// the producer is blocked while the queue is full
+		CHECK (queue.size() <= queue.capacity);
+		values.push_back (value);
+	}
+
+	producer.join();
+
+	CHECK_EQUAL (static_cast<size_t>(item_count), values.size());
+	for (int i = 0; i < static_cast<int>(values.size()); i++)
+		CHECK_EQUAL (i, values[i]);
+}
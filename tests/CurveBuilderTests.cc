@@ -0,0 +1,136 @@
+#include <UnitTest++.h>
+
+#include "Model.h"
+#include "Animation.h"
+#include "CurveBuilder.h"
+#include "SimpleMath/SimpleMathGL.h"
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+using namespace SimpleMath::GL;
+
+const float TEST_PREC = 1.0e-5;
+
+struct CurveBuilderFixture {
+	CurveBuilderFixture() {
+		model = MeshupModelPtr (new MeshupModel());
+		model->skip_vbo_generation = true;
+		model->addFrame("ROOT", "UPPERARM", SimpleMath::GL::TranslateMat44 (0.f, 1.f, 0.f));
+		model->addFrame("UPPERARM", "LOWERARM", SimpleMath::GL::TranslateMat44 (0.f, 1.f, 0.f));
+
+		StateInfo time_column;
+		time_column.is_time_column = true;
+
+		StateInfo upperarm_r_z;
+		upperarm_r_z.frame_name = "UPPERARM";
+		upperarm_r_z.axis = StateInfo::AxisTypeZ;
+		upperarm_r_z.type = StateInfo::TransformTypeRotation;
+
+		StateInfo lowerarm_t_x;
+		lowerarm_t_x.frame_name = "LOWERARM";
+		lowerarm_t_x.axis = StateInfo::AxisTypeX;
+		lowerarm_t_x.type = StateInfo::TransformTypeTranslation;
+
+		animation = AnimationPtr (new Animation());
+		animation->state_descriptor.states.push_back (time_column);
+		animation->state_descriptor.states.push_back (upperarm_r_z);
+		animation->state_descriptor.states.push_back (lowerarm_t_x);
+
+		VectorNd value_row (VectorNd::Zero (3));
+		animation->raw_values.push_back (value_row);
+		value_row[0] = 1.f;
+		value_row[1] = 90.f;
+		value_row[2] = 0.5f;
+		animation->raw_values.push_back (value_row);
+		value_row[0] = 2.f;
+		value_row[1] = 45.f;
+		value_row[2] = -0.5f;
+		animation->raw_values.push_back (value_row);
+		animation->duration = 2.f;
+
+		model->updateFrames();
+	}
+	~CurveBuilderFixture() {
+		delete animation;
+		delete model;
+	}
+
+	void waitUntilFinished (CurveBuilder &builder) {
+		while (!builder.finished()) {
+			builder.update (*model);
+			std::this_thread::sleep_for (std::chrono::milliseconds (1));
+		}
+	}
+
+	MeshupModelPtr model;
+	AnimationPtr animation;
+};
+
+TEST_FIXTURE ( CurveBuilderFixture, CurveBuilderMatchesAnimation ) {
+	CurveBuilder builder;
+	builder.start (*model, *animation);
+	waitUntilFinished (builder);
+
+	CHECK_EQUAL (3u, model->curvemap.size());
+
+	CurvePtr curve = model->curvemap["LOWERARM"];
+	CHECK_EQUAL (201u, curve->points.size());
+	CHECK_EQUAL (201u, curve->colors.size());
+
+	for (unsigned int i = 0; i < curve->points.size(); i += 25) {
+		float time = 2.f * static_cast<float>(i) / 200.f;
+		UpdateModelFromAnimation (model, animation, time);
+
+		Vector3f lowerarm_position = model->findFrame ("LOWERARM")->getPoseTransformTranslation();
+		CHECK_ARRAY_CLOSE (lowerarm_position.data(), curve->points[i].data(), 3, TEST_PREC);
+
+		Vector3f upperarm_position = model->findFrame ("UPPERARM")->getPoseTransformTranslation();
+		CHECK_ARRAY_CLOSE (upperarm_position.data(), model->curvemap["UPPERARM"]->points[i].data(), 3, TEST_PREC);
+	}
+}
+
+TEST_FIXTURE ( CurveBuilderFixture, CurveBuilderRefinesCoarseCurve ) {
+	CurveBuilder builder;
+	builder.coarse_sample_count = 5;
+
+	// compute the coarse pass without the background thread
+	builder.start (*model, *animation);
+	builder.cancel();
+
+	CurveBuilder::Result coarse_result;
+	CHECK (builder.computePass (5, coarse_result));
+	CHECK_EQUAL (3u, coarse_result.curves.size());
+	CHECK_EQUAL (5u, coarse_result.curves[0].colors.size());
+
+	CurveBuilder::Result fine_result;
+	CHECK (builder.computePass (9, fine_result));
+
+	// every sample of the coarse pass is also part of the refined one
+	for (unsigned int f = 0; f < coarse_result.curves.size(); f++) {
+		for (unsigned int i = 0; i < 5; i++) {
+			CHECK_ARRAY_CLOSE (coarse_result.curves[f].points[i].data(), fine_result.curves[f].points[2 * i].data(), 3, TEST_PREC);
+		}
+	}
+}
+
+TEST_FIXTURE ( CurveBuilderFixture, CurveBuilderCancel ) {
+	CurveBuilder builder;
+	builder.start (*model, *animation);
+	builder.cancel();
+
+	CHECK (builder.finished());
+	CHECK (!builder.update (*model));
+}
+
+TEST_FIXTURE ( CurveBuilderFixture, CurveBuilderWait ) {
+	CurveBuilder builder;
+	builder.start (*model, *animation);
+	builder.wait();
+
+	CHECK (builder.update (*model));
+	CHECK (builder.finished());
+	CHECK_EQUAL (201u, model->curvemap["LOWERARM"]->points.size());
+}
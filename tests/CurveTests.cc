@@ -0,0 +1,109 @@
+#include <UnitTest++.h>
+
+#include "Curve.h"
+
+#include <cmath>
+
+using namespace std;
+
+const float CURVE_TEST_PREC = 1.0e-5;
+
+/** Densely sampled circle with a radius of 1 */
+struct CurveFixture {
+	CurveFixture() {
+		for (unsigned int i = 0; i <= 4000; i++) {
+			float t = 2.f * static_cast<float>(M_PI) * static_cast<float>(i) / 4000.f;
+			curve.addPointWithColor (cosf(t), sinf(t), 0.f, 1.f, 0.f, 0.f);
+		}
+	}
+
+	Curve curve;
+};
+
+static float distance_to_polyline (const Vector3f &point, const Curve &curve, const Curve::Level &level) {
+	float distance = 1.0e10f;
+
+	for (unsigned int i = 0; i + 1 < level.index_count; i++) {
+		const Vector3f &start = curve.points[curve.indices[level.first_index + i]];
+		const Vector3f &end = curve.points[curve.indices[level.first_index + i + 1]];
+
+		Vector3f direction = end - start;
+		float t = 0.f;
+		if (direction.squaredNorm() > 0.f)
+			t = max (0.f, min (1.f, (point - start).dot (direction) / direction.squaredNorm()));
+
+		distance = min (distance, (point - (start + direction * t)).norm());
+	}
+
+	return distance;
+}
+
+TEST ( CurvePointImportanceStraightLine ) {
+	vector<Vector3f> points;
+	for (unsigned int i = 0; i < 10; i++)
+		points.push_back (Vector3f (static_cast<float>(i), 0.f, 0.f));
+
+	vector<float> importance;
+	compute_point_importance (points, importance);
+
+	CHECK_EQUAL (10u, importance.size());
+	CHECK (importance[0] > 1.0e10f);
+	CHECK (importance[9] > 1.0e10f);
+
+	for (unsigned int i = 1; i < 9; i++)
+		CHECK_CLOSE (0.f, importance[i], CURVE_TEST_PREC);
+}
+
+TEST_FIXTURE ( CurveFixture, CurveLevelsBoundingBox ) {
+	curve.generate_levels();
+
+	CHECK_CLOSE (-1.f, curve.bbox_min[0], CURVE_TEST_PREC);
+	CHECK_CLOSE (-1.f, curve.bbox_min[1], CURVE_TEST_PREC);
+	CHECK_CLOSE (1.f, curve.bbox_max[0], CURVE_TEST_PREC);
+	CHECK_CLOSE (1.f, curve.bbox_max[1], CURVE_TEST_PREC);
+}
+
+TEST_FIXTURE ( CurveFixture, CurveLevelsAreWithinError ) {
+	curve.generate_levels();
+
+	CHECK (curve.levels.size() > 2);
+	CHECK_EQUAL (curve.points.size(), curve.levels[0].index_count);
+	CHECK_EQUAL (0.f, curve.levels[0].error);
+
+	for (unsigned int l = 1; l < curve.levels.size(); l++) {
+		const Curve::Level &level = curve.levels[l];
+
+		CHECK (level.error > curve.levels[l - 1].error);
+		CHECK (level.index_count < curve.levels[l - 1].index_count);
+
+		// end points are always kept
+		CHECK_EQUAL (0u, curve.indices[level.first_index]);
+		CHECK_EQUAL (curve.points.size() - 1, curve.indices[level.first_index + level.index_count - 1]);
+
+		for (unsigned int i = 0; i < curve.points.size(); i += 7) {
+			CHECK (distance_to_polyline (curve.points[i], curve, level) <= level.error + CURVE_TEST_PREC);
+		}
+	}
+}
+
+TEST_FIXTURE ( CurveFixture, CurveSelectLevel ) {
+	curve.generate_levels();
+
+	CHECK_EQUAL (curve.levels[0].first_index, curve.selectLevel (0.f).first_index);
+	CHECK_EQUAL (curve.levels.back().first_index, curve.selectLevel (100.f).first_index);
+
+	const Curve::Level &level = curve.selectLevel (0.01f);
+	CHECK (level.error <= 0.01f);
+	CHECK (level.index_count < curve.points.size() / 10);
+}
+
+TEST ( CurveLevelsOfStaticPoint ) {
+	Curve curve;
+	for (unsigned int i = 0; i < 100; i++)
+		curve.addPointWithColor (1.f, 2.f, 3.f, 1.f, 1.f, 1.f);
+
+	curve.generate_levels();
+
+	CHECK_EQUAL (2u, curve.levels.size());
+	CHECK_EQUAL (2u, curve.levels.back().index_count);
+}
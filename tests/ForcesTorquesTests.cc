@@ -0,0 +1,105 @@
+#include <UnitTest++.h>
+
+#include "ForcesTorques.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+const float FORCES_TEST_PREC = 1.0e-6;
+
+/// Adds a frame with two contacts, the values are offset by value
+void add_frame (ForcesTorques &forces_torques, float time, float value) {
+	VectorNd data (VectorNd::Zero (19));
+	data[0] = time;
+
+	for (int i = 0; i < 2; i++) {
+		data[i * 9 + 1] = value + i;       // position x
+		data[i * 9 + 5] = 10.f * value;    // force y
+		data[i * 9 + 9] = -value;          // torque z
+	}
+
+	forces_torques.addForcesTorques (data);
+}
+
+TEST ( ForcesTorquesStorage ) {
+	ForcesTorques forces_torques (NULL);
+	add_frame (forces_torques, 0.f, 1.f);
+	add_frame (forces_torques, 1.f, 2.f);
+
+	CHECK_EQUAL (2u, forces_torques.contact_count);
+	CHECK_EQUAL (2u, forces_torques.times.size());
+	CHECK_EQUAL (2u * 2u * 3u, forces_torques.forces.size());
+	CHECK_CLOSE (3.f, forces_torques.positions[9], FORCES_TEST_PREC);
+}
+
+TEST ( ForcesTorquesGetIndexAtTime ) {
+	ForcesTorques forces_torques (NULL);
+	add_frame (forces_torques, 0.f, 0.f);
+	add_frame (forces_torques, 0.5f, 0.f);
+	add_frame (forces_torques, 1.f, 0.f);
+
+	CHECK_EQUAL (0u, forces_torques.getIndexAtTime (-1.f));
+	CHECK_EQUAL (0u, forces_torques.getIndexAtTime (0.f));
+	CHECK_EQUAL (1u, forces_torques.getIndexAtTime (0.25f));
+	CHECK_EQUAL (1u, forces_torques.getIndexAtTime (0.5f));
+	CHECK_EQUAL (2u, forces_torques.getIndexAtTime (0.75f));
+	CHECK_EQUAL (2u, forces_torques.getIndexAtTime (2.f));
+}
+
+TEST ( ForcesTorquesInterpolation ) {
+	ForcesTorques forces_torques (NULL);
+	add_frame (forces_torques, 0.f, 1.f);
+	add_frame (forces_torques, 1.f, 2.f);
+	forces_torques.duration = 1.f;
+
+	ArrowList arrows;
+	forces_torques.getForcesAtTime (0.25f, arrows);
+
+	CHECK_EQUAL (2u, arrows.arrows.size());
+	CHECK_ARRAY_CLOSE (Vector3f (2.25f, 0.f, 0.f).data(), arrows.arrows[1].pos.data(), 3, FORCES_TEST_PREC);
+	CHECK_ARRAY_CLOSE (Vector3f (0.f, 12.5f, 0.f).data(), arrows.arrows[1].direction.data(), 3, FORCES_TEST_PREC);
+
+	// the buffer is reused
+	const Arrow *data = &arrows.arrows[0];
+	forces_torques.getTorquesAtTime (2.f, arrows);
+
+	CHECK (data == &arrows.arrows[0]);
+	CHECK_ARRAY_CLOSE (Vector3f (0.f, 0.f, -2.f).data(), arrows.arrows[0].direction.data(), 3, FORCES_TEST_PREC);
+}
+
+TEST ( ForcesTorquesUsesModelAnimationSettings ) {
+	const char *model_filename = "forces_test_model.lua";
+	const char *forces_filename = "forces_test_forces.csv";
+	{
+		ofstream model_file (model_filename);
+		model_file << "return {" << endl
+			<< "  animation_settings = { force_scale = 0.5, torque_threshold = 2.0, force_color = { 0, 0, 1 } }," << endl
+			<< "  frames = {}" << endl
+			<< "}" << endl;
+
+		ofstream forces_file (forces_filename);
+		forces_file << "0, 0, 0, 0, 1, 0, 0, 0, 0, 1" << endl;
+	}
+
+	MeshupModel model;
+	model.skip_vbo_generation = true;
+	model.loadModelFromLuaFile (model_filename);
+
+	CHECK_CLOSE (0.5f, model.animation_settings.force_scale, FORCES_TEST_PREC);
+	CHECK_CLOSE (0.01f, model.animation_settings.torque_scale, FORCES_TEST_PREC);
+
+	// the model file must not be read again
+	remove (model_filename);
+
+	ForcesTorques forces_torques (&model);
+	CHECK (forces_torques.loadFromFile (forces_filename, false));
+
+	CHECK_CLOSE (0.5f, forces_torques.force_properties.scale, FORCES_TEST_PREC);
+	CHECK_CLOSE (2.0, forces_torques.torque_threshold, FORCES_TEST_PREC);
+	CHECK_ARRAY_CLOSE (Vector3f (0.f, 0.f, 1.f).data(), forces_torques.force_properties.color.data(), 3, FORCES_TEST_PREC);
+
+	remove (forces_filename);
+}
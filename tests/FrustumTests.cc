@@ -0,0 +1,72 @@
+#include <UnitTest++.h>
+
+#include "Frustum.h"
+#include "SimpleMath/SimpleMathGL.h"
+
+using namespace std;
+
+const float FRUSTUM_TEST_PREC = 1.0e-5;
+
+/** Camera at (0, 0, 5) looking along the negative z axis. */
+struct FrustumFixture {
+	FrustumFixture() {
+		Matrix44f modelview = SimpleMath::GL::TranslateMat44 (0.f, 0.f, -5.f);
+
+		// gluPerspective (90., 1., 0.1, 10.) in the row vector convention
+		float near = 0.1f;
+		float far = 10.f;
+		Matrix44f projection (
+				1.f, 0.f, 0.f, 0.f,
+				0.f, 1.f, 0.f, 0.f,
+				0.f, 0.f, (far + near) / (near - far), -1.f,
+				0.f, 0.f, 2.f * far * near / (near - far), 0.f);
+
+		frustum.extract (modelview * projection);
+	}
+
+	Frustum frustum;
+};
+
+TEST_FIXTURE ( FrustumFixture, FrustumBoxVisibility ) {
+	CHECK (frustum.intersectsBox (Vector3f (-0.5f, -0.5f, -0.5f), Vector3f (0.5f, 0.5f, 0.5f)));
+
+	// behind the camera and beyond the far plane
+	CHECK (!frustum.intersectsBox (Vector3f (-0.5f, -0.5f, 6.f), Vector3f (0.5f, 0.5f, 7.f)));
+	CHECK (!frustum.intersectsBox (Vector3f (-0.5f, -0.5f, -7.f), Vector3f (0.5f, 0.5f, -6.f)));
+
+	// left of the view and partially inside
+	CHECK (!frustum.intersectsBox (Vector3f (-10.f, -0.5f, -0.5f), Vector3f (-9.f, 0.5f, 0.5f)));
+	CHECK (frustum.intersectsBox (Vector3f (-10.f, -0.5f, -0.5f), Vector3f (0.f, 0.5f, 0.5f)));
+}
+
+TEST_FIXTURE ( FrustumFixture, FrustumSphereVisibility ) {
+	CHECK (frustum.intersectsSphere (Vector3f (0.f, 0.f, 0.f), 0.1f));
+	CHECK (!frustum.intersectsSphere (Vector3f (0.f, 7.f, 0.f), 0.1f));
+	CHECK (frustum.intersectsSphere (Vector3f (0.f, 7.f, 0.f), 3.f));
+}
+
+TEST ( FrustumDefaultAcceptsEverything ) {
+	Frustum frustum;
+
+	CHECK (frustum.intersectsBox (Vector3f (100.f, 100.f, 100.f), Vector3f (101.f, 101.f, 101.f)));
+	CHECK (frustum.intersectsSphere (Vector3f (-100.f, 0.f, 0.f), 1.f));
+}
+
+TEST ( TransformBoundingBoxContainsCorners ) {
+	Vector3f box_min (-1.f, 0.f, 0.5f);
+	Vector3f box_max (2.f, 1.f, 1.5f);
+
+	Matrix44f transform = SimpleMath::GL::ScaleMat44 (2.f, 1.f, 1.f)
+		* SimpleMath::GL::RotateMat44 (90.f, 0.f, 0.f, 1.f)
+		* SimpleMath::GL::TranslateMat44 (1.f, 2.f, 3.f);
+
+	Vector3f result_min, result_max;
+	transform_bounding_box (box_min, box_max, transform, result_min, result_max);
+
+	// the rotation by 90 degrees maps the box onto an axis aligned box
+	Vector3f expected_min (0.f, 0.f, 3.5f);
+	Vector3f expected_max (1.f, 6.f, 4.5f);
+
+	CHECK_ARRAY_CLOSE (expected_min.data(), result_min.data(), 3, FRUSTUM_TEST_PREC);
+	CHECK_ARRAY_CLOSE (expected_max.data(), result_max.data(), 3, FRUSTUM_TEST_PREC);
+}
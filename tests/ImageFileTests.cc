@@ -0,0 +1,96 @@
+#include <UnitTest++.h>
+
+#include "ImageFile.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static string read_file (const char *filename) {
+	ifstream file (filename, ios::binary);
+	stringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+
+TEST ( ImageFileFormatNames ) {
+	ImageFileFormat format = ImageFilePNG;
+
+	CHECK (parse_image_file_format ("tga", format));
+	CHECK_EQUAL (ImageFileTGA, format);
+	CHECK_EQUAL (string ("fast_png"), image_file_format_name (ImageFileFastPNG));
+	CHECK_EQUAL (string (".png"), image_file_extension (ImageFileFastPNG));
+	CHECK_EQUAL (string (".ppm"), image_file_extension (ImageFilePPM));
+	CHECK (!parse_image_file_format ("jpg", format));
+	CHECK_EQUAL (ImageFileTGA, format);
+}
+
+TEST ( ImageFileExtensions ) {
+	ImageFileFormat format = ImageFilePNG;
+
+	CHECK (parse_image_file_extension ("poster.TGA", format));
+	CHECK_EQUAL (ImageFileTGA, format);
+	CHECK (parse_image_file_extension ("frames/image.v2.ppm", format));
+	CHECK_EQUAL (ImageFilePPM, format);
+	CHECK (!parse_image_file_extension ("video.mp4", format));
+	CHECK (!parse_image_file_extension ("png", format));
+	CHECK_EQUAL (ImageFilePPM, format);
+}
+
+TEST ( ImageFileWriteTGA ) {
+	// 2x1 pixels: blue, red
+	unsigned char pixels[] = { 255, 0, 0, 255, 0, 0, 255, 128 };
+	const char *filename = "ImageFileTest.tga";
+
+	CHECK (write_tga (filename, 2, 1, pixels));
+	string content = read_file (filename);
+	remove (filename);
+
+	CHECK_EQUAL (18u + 8u, content.size());
+	CHECK_EQUAL (2, content[2]);
+	CHECK_EQUAL (2, content[12]);
+	CHECK_EQUAL (1, content[14]);
+	CHECK_EQUAL (32, content[16]);
+	CHECK (content.substr (18) == string (reinterpret_cast<char*>(pixels), 8));
+}
+
+TEST ( ImageFileWritePPMFlipsRows ) {
+	// 1x2 pixels, the bottom row (blue) comes first
+	unsigned char pixels[] = { 255, 0, 0, 255, 0, 255, 0, 255 };
+	const char *filename = "ImageFileTest.ppm";
+
+	CHECK (write_ppm (filename, 1, 2, pixels));
+	string content = read_file (filename);
+	remove (filename);
+
+	string header = "P6\n1 2\n255\n";
+	CHECK_EQUAL (header.size() + 6, content.size());
+	CHECK (content.substr (0, header.size()) == header);
+
+	// green on top, then blue, as RGB
+	const char expected[] = { 0, (char) 255, 0, 0, 0, (char) 255 };
+	CHECK (content.substr (header.size()) == string (expected, 6));
+}
+
+TEST ( ImageAccumulatorAddsAndClamps ) {
+	ImageAccumulator accumulator;
+	accumulator.reset (1, 1);
+
+	unsigned char first[] = { 10, 100, 200, 0 };
+	unsigned char second[] = { 20, 100, 100, 255 };
+	accumulator.add (first);
+	accumulator.add (second);
+
+	unsigned char result[4];
+	accumulator.result (result);
+
+	CHECK_EQUAL (2u, accumulator.count);
+	CHECK_EQUAL (30, result[0]);
+	CHECK_EQUAL (200, result[1]);
+	CHECK_EQUAL (255, result[2]);
+	CHECK_EQUAL (255, result[3]);
+}
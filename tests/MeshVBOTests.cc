@@ -0,0 +1,220 @@
+#include <UnitTest++.h>
+
+#include "MeshVBO.h"
+#include "SimpleMath/SimpleMathGL.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+const float TEST_PREC = 1.0e-6;
+
+/** Returns the triangles of a mesh as a sorted list of coordinates so that
+ * the triangle sets of two meshes can be compared independently of the
+ * order of triangles and vertices.
+ */
+vector<vector<float> > get_sorted_triangles (const MeshVBO &mesh) {
+	vector<vector<float> > result;
+
+	size_t count = mesh.indices.size() != 0 ? mesh.indices.size() : mesh.vertices.size();
+	for (size_t i = 0; i < count; i += 3) {
+		vector<float> triangle;
+
+		// rotate the triangle such that it starts with its smallest vertex
+		// (keeps winding order)
+		size_t start = 0;
+		for (size_t j = 1; j < 3; j++) {
+			size_t vi_j = mesh.indices.size() != 0 ? mesh.indices[i + j] : i + j;
+			size_t vi_start = mesh.indices.size() != 0 ? mesh.indices[i + start] : i + start;
+			if (lexicographical_compare (mesh.vertices[vi_j].data(), mesh.vertices[vi_j].data() + 3,
+						mesh.vertices[vi_start].data(), mesh.vertices[vi_start].data() + 3))
+				start = j;
+		}
+
+		for (size_t j = 0; j < 3; j++) {
+			size_t k = i + (start + j) % 3;
+			size_t vi = mesh.indices.size() != 0 ? mesh.indices[k] : k;
+			for (size_t c = 0; c < 3; c++)
+				triangle.push_back (mesh.vertices[vi][c]);
+		}
+
+		result.push_back (triangle);
+	}
+
+	sort (result.begin(), result.end());
+
+	return result;
+}
+
+TEST ( MeshVBOWeldCuboid ) {
+	MeshVBO mesh = CreateCuboid (1.f, 2.f, 3.f);
+
+	CHECK_EQUAL (36u, mesh.vertices.size());
+	CHECK_EQUAL (0u, mesh.indices.size());
+
+	vector<vector<float> > triangles_before = get_sorted_triangles (mesh);
+
+	mesh.weld();
+
+	// each of the 6 faces has its own normal, therefore only vertices within
+	// a face can be shared
+	CHECK_EQUAL (24u, mesh.vertices.size());
+	CHECK_EQUAL (24u, mesh.normals.size());
+	CHECK_EQUAL (36u, mesh.indices.size());
+
+	CHECK (triangles_before == get_sorted_triangles (mesh));
+}
+
+TEST ( MeshVBOCalcACMR ) {
+	MeshVBO mesh = CreateCuboid (1.f, 1.f, 1.f);
+
+	CHECK_CLOSE (3.f, mesh.calcACMR(), TEST_PREC);
+
+	mesh.weld();
+
+	// 24 unique vertices for 12 triangles all fit into the cache
+	CHECK_CLOSE (2.f, mesh.calcACMR(), TEST_PREC);
+}
+
+TEST ( MeshVBOOptimizeSphere ) {
+	MeshVBO mesh = CreateUVSphere (32, 32);
+	vector<vector<float> > triangles_before = get_sorted_triangles (mesh);
+
+	mesh.weld();
+	float acmr_welded = mesh.calcACMR();
+	size_t vertex_count = mesh.vertices.size();
+
+	mesh.optimize();
+
+	CHECK (mesh.calcACMR() <= acmr_welded);
+	CHECK (mesh.calcACMR() < 1.f);
+	CHECK_EQUAL (vertex_count, mesh.vertices.size());
+	CHECK (triangles_before == get_sorted_triangles (mesh));
+
+	// vertices are ordered by first use
+	unsigned int max_index = 0;
+	for (size_t i = 0; i < mesh.indices.size(); i++) {
+		CHECK (mesh.indices[i] <= max_index);
+		if (mesh.indices[i] == max_index)
+			max_index++;
+	}
+}
+
+TEST ( MeshVBOJoinIndexed ) {
+	MeshVBO mesh = CreateCuboid (1.f, 1.f, 1.f);
+	mesh.weld();
+
+	MeshVBO other = CreateCuboid (1.f, 1.f, 1.f);
+	mesh.join (SimpleMath::GL::TranslateMat44 (2.f, 0.f, 0.f), other);
+
+	CHECK_EQUAL (24u + 36u, mesh.vertices.size());
+	CHECK_EQUAL (36u + 36u, mesh.indices.size());
+	CHECK_EQUAL (24u, mesh.indices[36]);
+	CHECK_EQUAL (59u, mesh.indices[71]);
+}
+
+TEST ( MeshVBOGenerateLODs ) {
+	MeshVBO mesh = CreateUVSphere (32, 32);
+	mesh.optimize();
+
+	mesh.generateLODs (3);
+
+	CHECK_EQUAL (3u, mesh.lods.size());
+
+	size_t triangle_count = mesh.indices.size() / 3;
+	float error = 0.f;
+	for (size_t i = 0; i < mesh.lods.size(); i++) {
+		CHECK (mesh.lods[i]->indices.size() / 3 < triangle_count);
+		CHECK (mesh.lods[i]->lod_error > error);
+		CHECK_EQUAL (mesh.lods[i]->vertices.size(), mesh.lods[i]->normals.size());
+
+		triangle_count = mesh.lods[i]->indices.size() / 3;
+		error = mesh.lods[i]->lod_error;
+	}
+
+	// large on screen: full resolution, a single pixel: coarsest level
+	CHECK (mesh.selectLOD (1.0e6f) == &mesh);
+	CHECK (mesh.selectLOD (1.f) == mesh.lods[2]);
+
+	// copies own their levels
+	MeshVBO copy (mesh);
+	CHECK_EQUAL (3u, copy.lods.size());
+	CHECK (copy.lods[0] != mesh.lods[0]);
+}
+
+TEST ( MeshVBOMove ) {
+	MeshVBO mesh = CreateUVSphere (32, 32);
+	mesh.optimize();
+	mesh.generateLODs (2);
+
+	size_t vertex_count = mesh.vertices.size();
+	MeshVBO *first_lod = mesh.lods[0];
+
+	MeshVBO moved (std::move (mesh));
+
+	CHECK_EQUAL (vertex_count, moved.vertices.size());
+	CHECK (moved.lods[0] == first_lod);
+	CHECK_EQUAL (0u, mesh.vertices.size());
+	CHECK_EQUAL (0u, mesh.lods.size());
+
+	MeshVBO assigned;
+	assigned = std::move (moved);
+
+	CHECK_EQUAL (vertex_count, assigned.vertices.size());
+	CHECK (assigned.lods[0] == first_lod);
+	CHECK_EQUAL (0u, moved.lods.size());
+}
+
+TEST ( MeshVBOTransform ) {
+	MeshVBO mesh = CreateCuboid (1.f, 2.f, 3.f);
+
+	mesh.transform (SimpleMath::GL::RotateMat44 (90.f, 0.f, 0.f, 1.f) * SimpleMath::GL::TranslateMat44 (1.f, 0.f, 0.f));
+
+	CHECK_EQUAL (36u, mesh.vertices.size());
+	CHECK_ARRAY_CLOSE (Vector3f (0.f, -0.5f, -1.5f).data(), mesh.bbox_min.data(), 3, 1.0e-5f);
+	CHECK_ARRAY_CLOSE (Vector3f (2.f, 0.5f, 1.5f).data(), mesh.bbox_max.data(), 3, 1.0e-5f);
+
+	for (size_t i = 0; i < mesh.normals.size(); i++)
+		CHECK_CLOSE (1.f, mesh.normals[i].norm(), 1.0e-5f);
+}
+
+TEST ( MeshVBOSourceTracking ) {
+	const char *filename = "meshvbo_test_quad.obj";
+	{
+		ofstream obj_file (filename);
+		obj_file << "v 0 0 0" << endl
+			<< "v 1 0 0" << endl
+			<< "v 1 1 0" << endl
+			<< "v 0 1 0" << endl
+			<< "vn 0 0 1" << endl
+			<< "f 1//1 2//1 3//1" << endl
+			<< "f 1//1 3//1 4//1" << endl;
+	}
+
+	MeshVBO mesh;
+	CHECK (mesh.loadOBJ (filename));
+	CHECK (mesh.source.valid());
+	CHECK_EQUAL (string(filename), mesh.source.filename);
+	CHECK (mesh.resident);
+
+	mesh.optimize (8, false);
+	CHECK (mesh.source.welded);
+	CHECK_EQUAL (8u, mesh.source.optimize_cache_size);
+	CHECK_EQUAL (4u, mesh.vertices.size());
+
+	// modified meshes cannot be restored from the file anymore
+	mesh.center();
+	CHECK (!mesh.source.valid());
+
+	// without a GL buffer there is nothing to release
+	mesh.residency = MeshVBO::ResidencyDropAfterUpload;
+	mesh.releaseCPUData();
+	CHECK (mesh.resident);
+	CHECK_EQUAL (4u, mesh.vertices.size());
+
+	remove (filename);
+}
@@ -0,0 +1,167 @@
+#include <UnitTest++.h>
+
+#include "Model.h"
+#include "LineBuffer.h"
+#include "SimpleMath/SimpleMathGL.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+struct GeometryModelFixture {
+	GeometryModelFixture() {
+		ofstream model_file (filename);
+		model_file << "return {" << endl
+			<< "  frames = {" << endl
+			<< "    {" << endl
+			<< "      name = \"BODY\"," << endl
+			<< "      parent = \"ROOT\"," << endl
+			<< "      visuals = {" << endl
+			<< "        { geometry = { sphere = { radius = 0.5 } } }," << endl
+			<< "        { geometry = { sphere = { radius = 2.0 } } }," << endl
+			<< "        { geometry = { sphere = { radius = 1.0, rows = 8 } } }," << endl
+			<< "        { geometry = { box = { dimensions = { 1, 2, 3 } } } }," << endl
+			<< "        { geometry = { box = { dimensions = { 4, 5, 6 } } } }," << endl
+			<< "        { geometry = { capsule = { radius = 0.1, length = 0.5 } } }," << endl
+			<< "        { geometry = { capsule = { radius = 0.2, length = 1.0 } } }," << endl
+			<< "        { geometry = { cylinder = { radius = 0.1, length = 3.0 } } }," << endl
+			<< "      }" << endl
+			<< "    }" << endl
+			<< "  }" << endl
+			<< "}" << endl;
+		model_file.close();
+
+		model.skip_vbo_generation = true;
+		model.loadModelFromLuaFile (filename);
+		model.updateFrames();
+		model.updateSegments();
+	}
+
+	~GeometryModelFixture() {
+		remove (filename);
+	}
+
+	/// Returns the bounding box size of a segment in frame coordinates
+	Vector3f getSegmentSize (const Segment &segment) {
+		MeshVBO mesh (*segment.mesh);
+		mesh.transform (segment.gl_matrix);
+		return mesh.bbox_max - mesh.bbox_min;
+	}
+
+	static const char* filename;
+	MeshupModel model;
+};
+
+const char* GeometryModelFixture::filename = "geometry_test_model.lua";
+
+TEST_FIXTURE ( GeometryModelFixture, ModelGeometryMeshesAreShared ) {
+	CHECK_EQUAL (8u, model.segments.size());
+
+	// two spheres, one box, one capsule, one cylinder
+	CHECK_EQUAL (5u, model.meshmap.size());
+
+	MeshupModel::SegmentList::iterator seg_iter = model.segments.begin();
+	MeshPtr sphere_mesh = seg_iter->mesh;
+	seg_iter++;
+	CHECK (seg_iter->mesh == sphere_mesh);
+	seg_iter++;
+	CHECK (seg_iter->mesh != sphere_mesh);
+}
+
+TEST_FIXTURE ( GeometryModelFixture, ModelGeometrySizes ) {
+	Vector3f expected_sizes[] = {
+		Vector3f (1.f, 1.f, 1.f),
+		Vector3f (4.f, 4.f, 4.f),
+		Vector3f (2.f, 2.f, 2.f),
+		Vector3f (1.f, 2.f, 3.f),
+		Vector3f (4.f, 5.f, 6.f),
+		Vector3f (0.2f, 0.5f, 0.2f),
+		Vector3f (0.4f, 1.0f, 0.4f),
+		Vector3f (0.2f, 3.0f, 0.2f)
+	};
+
+	unsigned int i = 0;
+	for (MeshupModel::SegmentList::iterator seg_iter = model.segments.begin(); seg_iter != model.segments.end(); seg_iter++, i++) {
+		Vector3f size = getSegmentSize (*seg_iter);
+
+		// tessellated round shapes are slightly smaller than their radius
+		CHECK_ARRAY_CLOSE (expected_sizes[i].data(), size.data(), 3, expected_sizes[i].norm() * 0.05f);
+	}
+}
+
+TEST_FIXTURE ( GeometryModelFixture, ModelSegmentBoundingBoxes ) {
+	for (MeshupModel::SegmentList::iterator seg_iter = model.segments.begin(); seg_iter != model.segments.end(); seg_iter++) {
+		MeshVBO mesh (*seg_iter->mesh);
+		mesh.transform (seg_iter->gl_matrix);
+
+		// the segments are not rotated, i.e. the boxes are exact
+		CHECK_ARRAY_CLOSE (mesh.bbox_min.data(), seg_iter->bbox_min.data(), 3, 1.0e-5f);
+		CHECK_ARRAY_CLOSE (mesh.bbox_max.data(), seg_iter->bbox_max.data(), 3, 1.0e-5f);
+
+		for (unsigned int i = 0; i < 3; i++) {
+			CHECK (model.bbox_min[i] <= seg_iter->bbox_min[i]);
+			CHECK (model.bbox_max[i] >= seg_iter->bbox_max[i]);
+		}
+	}
+
+	// the largest box has dimensions { 4, 5, 6 }
+	Vector3f model_size = model.bbox_max - model.bbox_min;
+	CHECK_ARRAY_CLOSE (Vector3f (4.f, 5.f, 6.f).data(), model_size.data(), 3, 1.0e-5f);
+}
+
+TEST_FIXTURE ( GeometryModelFixture, ModelFrameAxesAndPointLines ) {
+	LineBuffer lines;
+	Matrix44f transform = SimpleMath::GL::TranslateMat44 (0.f, 0.f, -1.f);
+
+	// three axes for the only frame besides ROOT
+	model.addFrameAxes (lines, transform);
+	CHECK_EQUAL (6u, lines.vertexCount());
+	CHECK_EQUAL (1u, lines.ranges.size());
+
+	// the x axis starts at the translated frame origin and is red
+	CHECK_CLOSE (-1.f, lines.vertex_data[2], 1.0e-5f);
+	CHECK_CLOSE (0.1f, lines.vertex_data[6] - lines.vertex_data[0], 1.0e-5f);
+	CHECK_CLOSE (1.f, lines.vertex_data[3], 1.0e-5f);
+	CHECK_CLOSE (0.f, lines.vertex_data[4], 1.0e-5f);
+
+	model.addPoint ("P1", "BODY", Vector3f (1.f, 0.f, 0.f), Vector3f (0.f, 0.f, 1.f), true, 3.f);
+	model.addPoint ("P2", "BODY", Vector3f (0.f, 1.f, 0.f), Vector3f (0.f, 0.f, 1.f), false);
+
+	vector<Matrix44f> sphere_transforms;
+	vector<Vector4f> sphere_colors;
+	model.addPoints (lines, sphere_transforms, sphere_colors, transform);
+
+	// only the first point has a line which has a different width
+	CHECK_EQUAL (8u, lines.vertexCount());
+	CHECK_EQUAL (2u, lines.ranges.size());
+	CHECK_EQUAL (3.f, lines.ranges[1].width);
+
+	CHECK_EQUAL (2u, sphere_transforms.size());
+	CHECK_EQUAL (2u, sphere_colors.size());
+	CHECK_CLOSE (1.f, sphere_transforms[0](3,0), 1.0e-5f);
+	CHECK_CLOSE (-1.f, sphere_transforms[0](3,2), 1.0e-5f);
+}
+
+TEST_FIXTURE ( GeometryModelFixture, ModelKeepsOptimizeMeshesWhenLoading ) {
+	MeshupModel other_model;
+	other_model.skip_vbo_generation = true;
+	other_model.optimize_meshes = false;
+	other_model.loadModelFromFile (filename);
+
+	CHECK_EQUAL (false, other_model.optimize_meshes);
+	CHECK_EQUAL (8u, other_model.segments.size());
+}
+
+TEST_FIXTURE ( GeometryModelFixture, ModelKeepsLODSettingsWhenLoading ) {
+	MeshupModel other_model;
+	other_model.skip_vbo_generation = true;
+	other_model.lod_levels = 0;
+	other_model.lod_pixel_error = 4.f;
+	other_model.loadModelFromFile (filename);
+
+	CHECK_EQUAL (0u, other_model.lod_levels);
+	CHECK_EQUAL (4.f, other_model.lod_pixel_error);
+	CHECK_EQUAL (8u, other_model.segments.size());
+}
@@ -0,0 +1,83 @@
+#include <UnitTest++.h>
+
+#include "Profiler.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace std;
+
+const float PROFILER_TEST_PREC = 1.0e-5;
+
+struct ProfilerFixture {
+	ProfilerFixture() {
+		profiler.setEnabled (true);
+	}
+	~ProfilerFixture() {
+		profiler.setEnabled (false);
+	}
+
+	void addFrame (float script_update_ms) {
+		profiler.beginFrame();
+		profiler.current.cpu[ProfilePhaseScriptUpdate] = script_update_ms;
+		profiler.endFrame();
+	}
+};
+
+TEST_FIXTURE ( ProfilerFixture, ProfilerSummaryAveragesLastFrames ) {
+	addFrame (10.f);
+	addFrame (1.f);
+	addFrame (2.f);
+	addFrame (3.f);
+
+	Profiler::Summary summary = profiler.summarize (3);
+
+	CHECK_EQUAL (3u, summary.frame_count);
+	CHECK_CLOSE (2.f, summary.cpu_average[ProfilePhaseScriptUpdate], PROFILER_TEST_PREC);
+	CHECK_CLOSE (3.f, summary.cpu_max[ProfilePhaseScriptUpdate], PROFILER_TEST_PREC);
+	CHECK (summary.cpu_average[ProfilePhaseFrame] >= 0.f);
+
+	// GPU times were not measured
+	CHECK (summary.gpu_average[ProfilePhaseDrawMeshes] < 0.f);
+}
+
+TEST_FIXTURE ( ProfilerFixture, ProfilerHistoryWrapsAround ) {
+	for (unsigned int i = 0; i < Profiler::HistorySize + 10; i++)
+		addFrame (static_cast<float>(i));
+
+	Profiler::Summary summary = profiler.summarize (Profiler::HistorySize * 2);
+
+	CHECK_EQUAL (Profiler::HistorySize, summary.frame_count);
+	CHECK_CLOSE (static_cast<float>(Profiler::HistorySize + 9), summary.cpu_max[ProfilePhaseScriptUpdate], PROFILER_TEST_PREC);
+	CHECK_CLOSE (static_cast<float>(10 + Profiler::HistorySize + 9) * 0.5f, summary.cpu_average[ProfilePhaseScriptUpdate], 1.0e-3f);
+}
+
+TEST_FIXTURE ( ProfilerFixture, ProfilerDisabledRecordsNothing ) {
+	profiler.setEnabled (false);
+	addFrame (1.f);
+
+	CHECK_EQUAL (0u, profiler.summarize().frame_count);
+}
+
+TEST_FIXTURE ( ProfilerFixture, ProfilerWriteCSV ) {
+	addFrame (1.f);
+	addFrame (2.f);
+
+	CHECK (profiler.writeCSV ("profiler_test.csv"));
+
+	ifstream csv_file ("profiler_test.csv");
+	string line;
+	unsigned int line_count = 0;
+
+	getline (csv_file, line);
+	CHECK_EQUAL (0u, line.find ("frame, frame_cpu_ms, script_update_cpu_ms"));
+	CHECK (line.find ("readback_gpu_ms") != string::npos);
+
+	while (getline (csv_file, line))
+		line_count++;
+
+	CHECK_EQUAL (2u, line_count);
+
+	remove ("profiler_test.csv");
+}
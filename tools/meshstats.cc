@@ -0,0 +1,82 @@
+/*
+ * MeshUp - A visualization tool for multi-body systems based on skeletal
+ * animation and magic.
+ *
+ * Copyright (c) 2012-2018 Martin Felis <martin.felis@iwr.uni-heidelberg.de>
+ *
+ * Licensed under the MIT license. See LICENSE for more details.
+ */
+
+#include "MeshVBO.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+void print_usage (const char* program_name) {
+	cout << "Usage: " << program_name << " [--cache-size <n>] [--no-overdraw] <mesh.obj>[:<object>] ..." << endl
+		<< endl
+		<< "Reports the average cache miss ratio (ACMR) of the given OBJ meshes" << endl
+		<< "before and after vertex cache optimization." << endl;
+}
+
+void print_stats (const char* label, const MeshVBO &mesh, unsigned int cache_size) {
+	cout << "  " << setw(10) << left << label
+		<< " vertices: " << setw(8) << mesh.vertices.size()
+		<< " triangles: " << setw(8) << (mesh.indices.size() != 0 ? mesh.indices.size() : mesh.vertices.size()) / 3
+		<< " ACMR: " << fixed << setprecision(3) << mesh.calcACMR (cache_size)
+		<< endl;
+}
+
+int main (int argc, char* argv[]) {
+	unsigned int cache_size = 16;
+	bool reduce_overdraw = true;
+	int file_count = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp (argv[i], "--cache-size") == 0 && i + 1 < argc) {
+			cache_size = atoi (argv[++i]);
+		} else if (strcmp (argv[i], "--no-overdraw") == 0) {
+			reduce_overdraw = false;
+		} else if (strcmp (argv[i], "--help") == 0 || strcmp (argv[i], "-h") == 0) {
+			print_usage (argv[0]);
+			return 0;
+		} else {
+			string filename = argv[i];
+			string object_name = "";
+
+			if (filename.find (':') != string::npos) {
+				object_name = filename.substr (filename.find (':') + 1);
+				filename = filename.substr (0, filename.find (':'));
+			}
+
+			MeshVBO mesh;
+			if (!mesh.loadOBJ (filename.c_str(), object_name == "" ? NULL : object_name.c_str())) {
+				cerr << "Error: could not load mesh " << argv[i] << endl;
+				return 1;
+			}
+
+			cout << argv[i] << " (cache size " << cache_size << ")" << endl;
+
+			print_stats ("original", mesh, cache_size);
+
+			mesh.weld();
+			print_stats ("welded", mesh, cache_size);
+
+			mesh.optimize (cache_size, reduce_overdraw);
+			print_stats ("optimized", mesh, cache_size);
+
+			file_count++;
+		}
+	}
+
+	if (file_count == 0) {
+		print_usage (argv[0]);
+		return 1;
+	}
+
+	return 0;
+}